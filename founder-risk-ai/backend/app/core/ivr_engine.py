@@ -11,7 +11,10 @@ bureaucracy, and informality - without being a criminal.
 
 from dataclasses import dataclass
 from enum import Enum
-from typing import List, Optional, Tuple
+from typing import Dict, List, Optional, Tuple
+
+from app.core.model_registry import ModelRegistry
+from app.core.tracing import span
 
 
 class FounderClassification(Enum):
@@ -97,6 +100,18 @@ class IVREngine:
     WEIGHT_POPS = 0.15
     WEIGHT_G = -0.30
     
+    # G-factor loadings (antagonistic core)
+    LOADING_PSYCHOPATHY = 0.45
+    LOADING_SADISM = 0.40
+    LOADING_MACH = 0.10
+    LOADING_NARC = 0.05
+    
+    # S_Agency: Mach/Narc residual after removing G, amplified by VEE
+    S_AGENCY_MACH = 0.50
+    S_AGENCY_NARC = 0.50
+    S_AGENCY_G_CONTAMINATION = 0.35
+    S_AGENCY_VEE_AMPLIFICATION = 0.2
+    
     # Thresholds
     G_THRESHOLD_CRITICAL = 0.75
     G_THRESHOLD_HIGH = 0.60
@@ -104,21 +119,33 @@ class IVREngine:
     IVR_THRESHOLD_HIGH = 0.70
     IVR_THRESHOLD_MODERATE = 0.50
     
+    def __init__(self, params: Optional[Dict[str, float]] = None, version: str = "builtin"):
+        """
+        params overrides the class-level weights/thresholds (model registry).
+        Unknown keys are rejected so a typo can't silently serve defaults.
+        """
+        self.version = version
+        for key, value in (params or {}).items():
+            if not key.isupper() or not hasattr(type(self), key):
+                raise ValueError(f"Unknown IVR parameter: {key}")
+            setattr(self, key, float(value))
+    
     def extract_g_factor(self, profile: FounderProfile) -> float:
         """Extract G-factor (antagonistic core)"""
-        g = (0.45 * profile.psychopathy +
-             0.40 * profile.sadism +
-             0.10 * profile.machiavellianism +
-             0.05 * profile.narcissism)
+        g = (self.LOADING_PSYCHOPATHY * profile.psychopathy +
+             self.LOADING_SADISM * profile.sadism +
+             self.LOADING_MACH * profile.machiavellianism +
+             self.LOADING_NARC * profile.narcissism)
         return max(0.0, min(1.0, g))
     
     def calculate_s_agency(self, profile: FounderProfile, g: float) -> float:
         """Calculate S_Agency (Dark Agency)"""
-        raw_agency = 0.50 * profile.machiavellianism + 0.50 * profile.narcissism
-        s_agency = raw_agency - (g * 0.35)
+        raw_agency = (self.S_AGENCY_MACH * profile.machiavellianism +
+                      self.S_AGENCY_NARC * profile.narcissism)
+        s_agency = raw_agency - (g * self.S_AGENCY_G_CONTAMINATION)
         
         # VEE amplifies S_Agency expression
-        s_agency *= (1.0 + profile.vigilance * 0.2)
+        s_agency *= (1.0 + profile.vigilance * self.S_AGENCY_VEE_AMPLIFICATION)
         
         return max(0.0, min(1.0, s_agency))
     
@@ -295,10 +322,11 @@ RECOMMENDATION: Pass on investment. Document concerns for future reference.
         )
 
 
-# Global engine instance
-engine = IVREngine()
+# Global engine instance (hot-reloadable through the model registry)
+registry = ModelRegistry("ivr", lambda params, version: IVREngine(params, version))
 
 
-def assess_founder(profile: FounderProfile) -> IVRResult:
-    """Convenience function for founder assessment"""
-    return engine.assess(profile)
+def assess_founder(profile: FounderProfile) -> Tuple[IVRResult, str]:
+    """Convenience function for founder assessment; also returns the model version used"""
+    with registry.lease() as model, span("engine.ivr", model_version=model.version):
+        return model.engine.assess(profile), model.version
@@ -4,8 +4,22 @@ FastAPI Main Application - Founder Risk Assessment AI
 
 from fastapi import FastAPI
 from fastapi.middleware.cors import CORSMiddleware
+from contextlib import asynccontextmanager
 
 from app.routes import assessments
+from app.core.ivr_engine import registry
+from app.core.tracing import TracedRoute, TracingMiddleware
+
+
+@asynccontextmanager
+async def lifespan(app: FastAPI):
+    """Startup and shutdown events"""
+    # Startup
+    registry.start_watcher()
+    yield
+    # Shutdown
+    registry.stop_watcher()
+
 
 app = FastAPI(
     title="Founder Risk Assessment AI",
@@ -32,7 +46,8 @@ app = FastAPI(
     IVR = 0.35×S_Agency + 0.25×VEE + 0.20×PsyCap + 0.15×POPS - 0.30×G
     ```
     """,
-    version="1.0.0"
+    version="1.0.0",
+    lifespan=lifespan
 )
 
 app.add_middleware(
@@ -42,6 +57,8 @@ app.add_middleware(
     allow_methods=["*"],
     allow_headers=["*"],
 )
+app.add_middleware(TracingMiddleware)
+app.router.route_class = TracedRoute
 
 app.include_router(assessments.router, prefix="/api/v1", tags=["Assessments"])
 
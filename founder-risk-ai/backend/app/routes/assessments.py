@@ -7,8 +7,9 @@ from pydantic import BaseModel, Field
 from typing import List, Optional
 
 from app.core.ivr_engine import FounderProfile, assess_founder, IVRResult
+from app.core.tracing import TracedRoute
 
-router = APIRouter()
+router = APIRouter(route_class=TracedRoute)
 
 
 class FounderInput(BaseModel):
@@ -53,6 +54,9 @@ class AssessmentResponse(BaseModel):
     
     # Narrative for partners
     narrative: str
+    
+    # IVR parameter set that produced this assessment
+    model_version: str
 
 
 class QuickAssessInput(BaseModel):
@@ -91,7 +95,7 @@ async def assess(data: FounderInput):
         corruption_index=data.corruption_index
     )
     
-    result = assess_founder(profile)
+    result, model_version = assess_founder(profile)
     
     return AssessmentResponse(
         founder_name=data.founder_name,
@@ -104,7 +108,8 @@ async def assess(data: FounderInput):
         recommendation=result.recommendation.value,
         confidence=result.confidence,
         risk_flags=result.risk_flags,
-        narrative=result.narrative
+        narrative=result.narrative,
+        model_version=model_version
     )
 
 
@@ -146,7 +151,7 @@ async def quick_assess(data: QuickAssessInput):
         corruption_index=market_chaos * 0.7
     )
     
-    result = assess_founder(profile)
+    result, model_version = assess_founder(profile)
     
     return AssessmentResponse(
         founder_name=data.founder_name,
@@ -159,7 +164,8 @@ async def quick_assess(data: QuickAssessInput):
         recommendation=result.recommendation.value,
         confidence=result.confidence * 0.9,  # Slightly lower for quick
         risk_flags=result.risk_flags,
-        narrative=result.narrative
+        narrative=result.narrative,
+        model_version=model_version
     )
 
 
@@ -179,7 +185,7 @@ async def demo_assessment():
         corruption_index=0.65
     )
     
-    result = assess_founder(profile)
+    result, model_version = assess_founder(profile)
     
     return {
         "founder": "María García",
@@ -190,7 +196,8 @@ async def demo_assessment():
         "classification": result.classification.value,
         "recommendation": result.recommendation.value,
         "risk_flags": result.risk_flags,
-        "narrative": result.narrative
+        "narrative": result.narrative,
+        "model_version": model_version
     }
 
 
@@ -1,4 +1,7 @@
 from fastapi import FastAPI
+from app.tracing import TracedRoute, TracingMiddleware
 app = FastAPI(title="Founder Risk API")
+app.add_middleware(TracingMiddleware)
+app.router.route_class = TracedRoute
 @app.get("/")
 def read_root(): return {"status": "active"}
@@ -0,0 +1,308 @@
+"""
+Distributed tracing (W3C Trace Context)
+
+- TracingMiddleware continues the caller's `traceparent` (or starts a trace),
+  opens the server span and echoes the trace id in `x-trace-id`.
+- TracedRoute splits every request into `validation` and `endpoint` spans.
+- span(name) wraps engine compute.
+- inject(headers) propagates the context on outbound HTTP calls.
+
+Spans are buffered and exported in batches from a background thread to
+TRACE_COLLECTOR_URL (tools/trace_collector.py is the local stand-in). The
+sampling decision is made once at the root (TRACE_SAMPLE_RATIO); unsampled
+requests only pay for a header parse and a context variable.
+"""
+
+import atexit
+import contextvars
+import functools
+import inspect
+import json
+import logging
+import os
+import random
+import threading
+import time
+import urllib.request
+from collections import deque
+from typing import Any, Callable, Dict, List, Optional
+
+from fastapi.routing import APIRoute
+
+logger = logging.getLogger(__name__)
+
+SERVICE_NAME = os.getenv("SERVICE_NAME", "founder-risk-api")
+COLLECTOR_URL = os.getenv("TRACE_COLLECTOR_URL") or None
+SAMPLE_RATIO = float(os.getenv("TRACE_SAMPLE_RATIO", "0.1"))
+EXPORT_INTERVAL = float(os.getenv("TRACE_EXPORT_INTERVAL", "1.0"))
+MAX_BATCH = 512
+MAX_QUEUE = 20_000
+
+
+class Span:
+    __slots__ = ("trace_id", "span_id", "parent_id", "name", "start_ns", "end_ns", "attributes", "status", "_token")
+
+    def __init__(self, trace_id: str, parent_id: Optional[str], name: str):
+        self.trace_id = trace_id
+        self.span_id = "%016x" % random.getrandbits(64)
+        self.parent_id = parent_id
+        self.name = name
+        self.start_ns = time.time_ns()
+        self.end_ns = 0
+        self.attributes: Dict[str, Any] = {}
+        self.status = "ok"
+        self._token = None
+
+    def __enter__(self) -> "Span":
+        self._token = _current.set(TraceContext(self.trace_id, self.span_id, True))
+        return self
+
+    def __exit__(self, exc_type, exc, tb) -> bool:
+        if exc_type is not None:
+            self.status = f"error: {exc_type.__name__}"
+        _current.reset(self._token)
+        self.end()
+        return False
+
+    def set(self, key: str, value: Any) -> None:
+        self.attributes[key] = value
+
+    def end(self) -> None:
+        if not self.end_ns:
+            self.end_ns = time.time_ns()
+            _exporter.enqueue(self)
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            "service": SERVICE_NAME,
+            "trace_id": self.trace_id,
+            "span_id": self.span_id,
+            "parent_id": self.parent_id,
+            "name": self.name,
+            "start_ns": self.start_ns,
+            "duration_us": (self.end_ns - self.start_ns) // 1000,
+            "attributes": self.attributes,
+            "status": self.status,
+        }
+
+
+class _NoopSpan:
+    """Shared stand-in for unsampled work: every call is a no-op"""
+
+    def __enter__(self) -> "_NoopSpan":
+        return self
+
+    def __exit__(self, exc_type, exc, tb) -> bool:
+        return False
+
+    def set(self, key: str, value: Any) -> None:
+        pass
+
+    def end(self) -> None:
+        pass
+
+
+NOOP_SPAN = _NoopSpan()
+
+
+class TraceContext:
+    __slots__ = ("trace_id", "span_id", "sampled")
+
+    def __init__(self, trace_id: str, span_id: Optional[str], sampled: bool):
+        self.trace_id = trace_id
+        self.span_id = span_id
+        self.sampled = sampled
+
+
+_current: contextvars.ContextVar[Optional[TraceContext]] = contextvars.ContextVar("trace_context", default=None)
+
+
+# ----------------------------------------------------------------------
+# Span API
+# ----------------------------------------------------------------------
+def start_span(name: str) -> Any:
+    """Start a child of the current span (caller must end() it)"""
+    ctx = _current.get()
+    if ctx is None or not ctx.sampled:
+        return NOOP_SPAN
+    return Span(ctx.trace_id, ctx.span_id, name)
+
+
+def span(name: str, **attributes: Any) -> Any:
+    """Child span around a block, e.g. `with span("engine.score"):`"""
+    ctx = _current.get()
+    if ctx is None or not ctx.sampled:
+        return NOOP_SPAN
+    s = Span(ctx.trace_id, ctx.span_id, name)
+    if attributes:
+        s.attributes.update(attributes)
+    return s
+
+
+def inject(headers: Optional[Dict[str, str]] = None) -> Dict[str, str]:
+    """Add the current `traceparent` to outbound request headers"""
+    headers = dict(headers or {})
+    ctx = _current.get()
+    if ctx is not None and ctx.span_id is not None:
+        headers["traceparent"] = f"00-{ctx.trace_id}-{ctx.span_id}-{'01' if ctx.sampled else '00'}"
+    return headers
+
+
+_HEX = frozenset("0123456789abcdef")
+
+
+def _is_hex(value: str, length: int) -> bool:
+    return len(value) == length and _HEX.issuperset(value)
+
+
+def parse_traceparent(value: Optional[str]) -> Optional[TraceContext]:
+    """`version-trace_id-parent_id-flags` in lowercase hex; all-zero ids and version ff are invalid"""
+    if not value:
+        return None
+    parts = value.strip().split("-")
+    if len(parts) < 4:
+        return None
+    version, trace_id, parent_id, flags = parts[:4]
+    if not (_is_hex(version, 2) and _is_hex(trace_id, 32) and _is_hex(parent_id, 16) and _is_hex(flags, 2)):
+        return None
+    if version == "ff" or (version == "00" and len(parts) != 4):
+        return None
+    if trace_id == "0" * 32 or parent_id == "0" * 16:
+        return None
+    return TraceContext(trace_id, parent_id, bool(int(flags, 16) & 0x01))
+
+
+# ----------------------------------------------------------------------
+# ASGI middleware + route class
+# ----------------------------------------------------------------------
+class TracingMiddleware:
+    """Pure ASGI middleware (no BaseHTTPMiddleware overhead)"""
+
+    def __init__(self, app):
+        self.app = app
+
+    async def __call__(self, scope, receive, send):
+        if scope["type"] != "http":
+            await self.app(scope, receive, send)
+            return
+
+        parent = None
+        for key, value in scope["headers"]:
+            if key == b"traceparent":
+                parent = parse_traceparent(value.decode("latin-1"))
+                break
+        if parent is None:
+            parent = TraceContext("%032x" % random.getrandbits(128), None, random.random() < SAMPLE_RATIO)
+
+        server = Span(parent.trace_id, parent.span_id, f"{scope['method']} {scope['path']}") if parent.sampled else NOOP_SPAN
+        span_id = server.span_id if parent.sampled else parent.span_id
+        token = _current.set(TraceContext(parent.trace_id, span_id, parent.sampled))
+        trace_header = (b"x-trace-id", parent.trace_id.encode())
+
+        async def send_with_trace(message):
+            if message["type"] == "http.response.start":
+                message.setdefault("headers", [])
+                message["headers"] = list(message["headers"]) + [trace_header]
+                server.set("http.status_code", message["status"])
+            await send(message)
+
+        try:
+            await self.app(scope, receive, send_with_trace)
+        finally:
+            _current.reset(token)
+            server.end()
+
+
+_validation_span: contextvars.ContextVar[Any] = contextvars.ContextVar("validation_span", default=NOOP_SPAN)
+
+
+def _trace_endpoint(endpoint: Callable) -> Callable:
+    """Closes the `validation` span and wraps the endpoint in its own span"""
+    if getattr(endpoint, "__traced__", False):
+        return endpoint  # include_router rebuilds routes from already-wrapped endpoints
+    name = f"endpoint.{endpoint.__name__}"
+
+    if inspect.iscoroutinefunction(endpoint):
+        @functools.wraps(endpoint)
+        async def traced(*args, **kwargs):
+            _validation_span.get().end()
+            with span(name):
+                return await endpoint(*args, **kwargs)
+    else:
+        @functools.wraps(endpoint)
+        def traced(*args, **kwargs):
+            _validation_span.get().end()
+            with span(name):
+                return endpoint(*args, **kwargs)
+    traced.__traced__ = True
+    return traced
+
+
+class TracedRoute(APIRoute):
+    """APIRoute that records request parsing/validation and endpoint time separately"""
+
+    def __init__(self, path: str, endpoint: Callable, **kwargs):
+        super().__init__(path, _trace_endpoint(endpoint), **kwargs)
+
+    def get_route_handler(self) -> Callable:
+        handler = super().get_route_handler()
+
+        async def traced_handler(request):
+            validation = start_span("validation")
+            token = _validation_span.set(validation)
+            try:
+                return await handler(request)
+            finally:
+                validation.end()  # no-op if the endpoint already closed it
+                _validation_span.reset(token)
+
+        return traced_handler
+
+
+# ----------------------------------------------------------------------
+# Batched exporter
+# ----------------------------------------------------------------------
+class BatchExporter:
+    def __init__(self, url: Optional[str]):
+        self.url = url
+        self._queue: deque = deque(maxlen=MAX_QUEUE)  # oldest spans dropped under overload
+        self._thread: Optional[threading.Thread] = None
+        self._lock = threading.Lock()
+
+    def enqueue(self, s: Span) -> None:
+        if self.url is None:
+            return
+        self._queue.append(s)
+        if self._thread is None:
+            self._start()
+
+    def _start(self) -> None:
+        with self._lock:
+            if self._thread is None:
+                self._thread = threading.Thread(target=self._run, name="trace-exporter", daemon=True)
+                self._thread.start()
+                atexit.register(self.flush)  # daemon thread: without this the last batch is lost on shutdown
+
+    def _drain(self) -> List[Dict[str, Any]]:
+        batch = []
+        while self._queue and len(batch) < MAX_BATCH:
+            batch.append(self._queue.popleft().to_dict())
+        return batch
+
+    def flush(self) -> None:
+        while self._queue:
+            batch = self._drain()
+            body = json.dumps({"spans": batch}).encode()
+            req = urllib.request.Request(self.url, data=body, headers={"Content-Type": "application/json"})
+            try:
+                urllib.request.urlopen(req, timeout=2.0).close()
+            except Exception as exc:
+                logger.debug("trace export failed (%d spans dropped): %s", len(batch), exc)
+
+    def _run(self) -> None:
+        while True:
+            time.sleep(EXPORT_INTERVAL)
+            self.flush()
+
+
+_exporter = BatchExporter(COLLECTOR_URL)
@@ -0,0 +1,260 @@
+"""
+Autocorrelación espacial: I de Moran, C de Geary y LISA (Moran local).
+
+Pesos espaciales dispersos en CSR (indptr, indices, weights), normalmente
+k vecinos del KD-tree estandarizados por filas. El retardo espacial Wz se
+calcula con np.add.reduceat sobre los nnz, sin matrices densas.
+
+Inferencia por permutaciones con flujos Philox (app/core/rng.py), así el
+resultado es idéntico con 1 o N hilos:
+
+- Global: lotes de permutaciones de z repartidos en el pool; cada lote usa
+  su propio carril `thread` del flujo del trabajo. Moran y Geary comparten
+  las permutaciones.
+- Local (permutación condicional): z_i queda fijo y a sus vecinos se les
+  asignan valores al azar del resto. Como en PySAL (crand), se sortea una
+  sola matriz de índices sin reemplazo (permutaciones × k_max) sobre n-1
+  valores que reutilizan todas las observaciones (excluyendo a la propia i,
+  ver lisa()).
+"""
+
+from dataclasses import dataclass, replace
+from typing import Dict, Optional
+
+import numpy as np
+
+from app.core.rng import stream
+from app.core.spatial_index import KDTree, _expand
+from app.core.work_pool import get_pool
+
+# Etiquetas de cuadrante LISA (convención PySAL); 0 = no significativo
+QUADRANTS = {1: "HH", 2: "LH", 3: "LL", 4: "HL"}
+
+
+@dataclass
+class SpatialWeights:
+    indptr: np.ndarray
+    indices: np.ndarray
+    weights: np.ndarray
+    # Orden espacial de las regiones (el del KD-tree); si existe, las
+    # permutaciones globales trabajan en ese orden y los accesos a vecinos caen cerca en memoria
+    order: Optional[np.ndarray] = None
+
+    @property
+    def n(self) -> int:
+        return self.indptr.size - 1
+
+    @property
+    def s0(self) -> float:
+        return float(self.weights.sum())
+
+    @property
+    def cardinalities(self) -> np.ndarray:
+        return np.diff(self.indptr)
+
+    @classmethod
+    def from_neighbors(cls, idx: np.ndarray, weights: Optional[np.ndarray] = None,
+                       row_standardize: bool = True) -> "SpatialWeights":
+        """Listas (n, k) de vecinos (p.ej. KDTree.knn_self o las del GWR) -> CSR."""
+        n, k = idx.shape
+        w = np.ones((n, k)) if weights is None else np.asarray(weights, dtype=np.float64)
+        if row_standardize:
+            w = w / w.sum(axis=1, keepdims=True)
+        return cls(np.arange(0, n * k + 1, k), np.ascontiguousarray(idx, dtype=np.int64).ravel(), w.ravel())
+
+    @classmethod
+    def knn(cls, coords: np.ndarray, k: int = 8) -> "SpatialWeights":
+        tree = KDTree(coords)
+        return replace(cls.from_neighbors(tree.knn_self(k)[1]), order=tree.order)
+
+    def localized(self) -> "SpatialWeights":
+        """Los mismos pesos con las regiones renumeradas según `order`."""
+        if self.order is None:
+            return self
+        inverse = np.empty(self.n, dtype=np.int64)
+        inverse[self.order] = np.arange(self.n)
+        edges = _expand(np.stack([self.indptr[:-1][self.order], self.indptr[1:][self.order]], axis=1))
+        indptr = np.concatenate([[0], np.cumsum(self.cardinalities[self.order])])
+        return SpatialWeights(indptr, inverse[self.indices[edges]], self.weights[edges])
+
+    def lag(self, z: np.ndarray) -> np.ndarray:
+        """Wz sobre el último eje: un vector (n,) o un lote (b, n)."""
+        card = self.cardinalities
+        if card.size and (card == card[0]).all():
+            # k vecinos fijos (caso KNN): reshape en lugar de reduceat
+            k = int(card[0])
+            gathered = z[..., self.indices.reshape(self.n, k)]
+            return (gathered * self.weights.reshape(self.n, k)).sum(axis=-1)
+        contrib = z[..., self.indices] * self.weights
+        out = np.zeros(z.shape)
+        has = card > 0
+        out[..., has] = np.add.reduceat(contrib, self.indptr[:-1][has], axis=-1)
+        return out
+
+    def cross(self, Ut: np.ndarray, rows: int = 2048) -> np.ndarray:
+        """
+        uᵀWu para cada columna de un lote (n, b).
+
+        Con k fijo se acumula columna de vecinos a columna de vecinos con
+        np.take por filas (cada acceso trae b valores contiguos), en bloques
+        de `rows` regiones para que los temporales quepan en caché.
+        """
+        card = self.cardinalities
+        if not (card.size and (card == card[0]).all()):
+            return (Ut * self.lag(Ut.T).T).sum(axis=0, dtype=np.float64)
+        k = int(card[0])
+        idx = self.indices.reshape(self.n, k)
+        weights = self.weights.reshape(self.n, k).astype(Ut.dtype)
+        out = np.zeros(Ut.shape[1])
+        acc = np.empty((min(rows, self.n), Ut.shape[1]), dtype=Ut.dtype)
+        tmp = np.empty_like(acc)
+        for start in range(0, self.n, rows):
+            stop = min(start + rows, self.n)
+            a, t = acc[:stop - start], tmp[:stop - start]
+            np.take(Ut, idx[start:stop, 0], axis=0, out=a)
+            a *= weights[start:stop, 0, None]
+            for j in range(1, k):
+                np.take(Ut, idx[start:stop, j], axis=0, out=t)
+                t *= weights[start:stop, j, None]
+                a += t
+            a *= Ut[start:stop]
+            out += a.sum(axis=0, dtype=np.float64)
+        return out
+
+    def padded(self):
+        """Vecinos y pesos rellenados a (n, k_max) con peso 0 (para la permutación condicional)."""
+        card = self.cardinalities
+        k_max = int(card.max(initial=0))
+        rows = np.repeat(np.arange(self.n), card)
+        cols = np.arange(self.indices.size) - np.repeat(self.indptr[:-1], card)
+        idx = np.zeros((self.n, k_max), dtype=np.int64)
+        w = np.zeros((self.n, k_max))
+        idx[rows, cols] = self.indices
+        w[rows, cols] = self.weights
+        return idx, w
+
+
+def _standardize(y: np.ndarray) -> np.ndarray:
+    y = np.asarray(y, dtype=np.float64)
+    return y - y.mean()
+
+
+def _pseudo_p(sim: np.ndarray, observed: np.ndarray, axis: int) -> np.ndarray:
+    """p de una cola en la dirección del observado: (extremos + 1) / (permutaciones + 1)."""
+    perms = sim.shape[axis]
+    larger = (sim >= np.expand_dims(observed, axis)).sum(axis=axis)
+    larger = np.where(perms - larger < larger, perms - larger, larger)
+    return (larger + 1.0) / (perms + 1.0)
+
+
+def global_tests(y: np.ndarray, w: SpatialWeights, permutations: int = 9999, job: str = "global",
+                 batch: int = 64) -> Dict[str, dict]:
+    """
+    I de Moran y C de Geary con las mismas permutaciones.
+
+    Con u = z permutado, Moran usa uᵀWu y Geary su desarrollo
+    Σ w_ij (u_i - u_j)² = Σ u_i² r_i + Σ u_j² c_j - 2 uᵀWu (r, c: sumas por
+    fila y columna), así cada permutación cuesta un solo retardo espacial.
+    Las permutaciones van en float32 (el estadístico observado, en float64)
+    y en el orden espacial de `w` si lo tiene: el estadístico no depende de
+    la numeración de las regiones.
+    """
+    z = _standardize(y)
+    if w.order is not None:
+        z, w = z[w.order], w.localized()
+    n, s0 = w.n, w.s0
+    m2 = z @ z
+    r = np.bincount(np.repeat(np.arange(n), w.cardinalities), weights=w.weights, minlength=n)
+    c = np.bincount(w.indices, weights=w.weights, minlength=n)
+
+    def statistics(Ut: np.ndarray):
+        # Ut: lote (n, b) de vectores permutados
+        cross = w.cross(Ut)
+        sq = (Ut * Ut).astype(np.float64)
+        num = r @ sq + c @ sq - 2.0 * cross
+        return n / s0 * cross / m2, (n - 1) * num / (2.0 * s0 * m2)
+
+    observed_i, observed_c = (float(s[0]) for s in statistics(z[:, None]))
+    out = {
+        "moran": {"I": float(observed_i), "expected": -1.0 / (n - 1)},
+        "geary": {"C": float(observed_c), "expected": 1.0},
+    }
+    if not permutations:
+        return out
+
+    z32 = z.astype(np.float32)
+
+    def run(b: int):
+        count = min(batch, permutations - b * batch)
+        rng = stream(job, thread=b)
+        U = np.empty((count, n), dtype=np.float32)
+        for j in range(count):
+            U[j] = z32[rng.permutation(n)]
+        return statistics(np.ascontiguousarray(U.T))
+
+    parts = get_pool().map(run, range(-(-permutations // batch)))
+    for key, name, sims in (("moran", "I", np.concatenate([p[0] for p in parts])),
+                            ("geary", "C", np.concatenate([p[1] for p in parts]))):
+        observed = out[key][name]
+        out[key].update({
+            "p_sim": float(_pseudo_p(sims, np.array(observed), 0)),
+            "z_sim": float((observed - sims.mean()) / sims.std()),
+            "permutations": permutations,
+        })
+    return out
+
+
+def lisa(y: np.ndarray, w: SpatialWeights, permutations: int = 9999, alpha: float = 0.05,
+         job: str = "lisa", block: int = 256) -> Dict[str, np.ndarray]:
+    """
+    I local por observación, p por permutación condicional y cuadrante de clúster significativo.
+
+    Los índices compartidos se sortean sobre {0..n-2}; para la observación i
+    el valor i se sustituye por n-1, una biyección con {0..n-1} menos {i}. Así el
+    retardo permutado de todo un bloque es W_bloque · z[rids]ᵀ (una
+    multiplicación de matrices) más una corrección en las pocas posiciones
+    donde rids == i.
+    """
+    z = _standardize(y)
+    n = w.n
+    m2 = (z @ z) / n
+    lag = w.lag(z)
+    local_i = z * lag / m2
+
+    idx, weights = w.padded()
+    k_max = idx.shape[1]
+    p_sim = np.ones(n)
+    if permutations and k_max:
+        rng = stream(job)
+        rids = np.stack([rng.choice(n - 1, k_max, replace=False) for _ in range(permutations)])
+        z_rids_t = np.ascontiguousarray(z[rids].T)  # (k_max, permutaciones)
+        # Posiciones (permutación, vecino) de cada valor sorteado, para la corrección rids == i
+        flat = rids.ravel()
+        by_value = np.argsort(flat, kind="stable")
+        bounds = np.searchsorted(flat[by_value], np.arange(n + 1))
+
+        def run(start: int) -> None:
+            rows = np.arange(start, min(start + block, n))
+            perm_lag = weights[rows] @ z_rids_t
+            hits = by_value[bounds[rows[0]]:bounds[rows[-1] + 1]]
+            if hits.size:
+                p, t = np.divmod(hits, k_max)
+                i = flat[hits] - rows[0]
+                np.add.at(perm_lag, (i, p), weights[rows[i], t] * (z[n - 1] - z[rows[i]]))
+            sims = perm_lag * (z[rows] / m2)[:, None]
+            p_sim[rows] = _pseudo_p(sims, local_i[rows], 1)
+
+        get_pool().map(run, range(0, n, block))
+
+    quadrant = np.where(z > 0, np.where(lag > 0, 1, 4), np.where(lag > 0, 2, 3))
+    cluster = np.where(p_sim < alpha, quadrant, 0)
+    return {"I": local_i, "p_sim": p_sim, "quadrant": quadrant, "cluster": cluster}
+
+
+def diagnostics(y: np.ndarray, w: SpatialWeights, permutations: int = 999, alpha: float = 0.05,
+                job: str = "autocorrelation") -> dict:
+    """Resumen global + recuento de clústeres LISA (para respuestas JSON)."""
+    local = lisa(y, w, permutations, alpha, job=f"{job}:lisa")
+    clusters = {name: int((local["cluster"] == code).sum()) for code, name in QUADRANTS.items()}
+    clusters["not_significant"] = int((local["cluster"] == 0).sum())
+    return {**global_tests(y, w, permutations, job=f"{job}:global"), "lisa_clusters": clusters}
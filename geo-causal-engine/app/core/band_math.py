@@ -0,0 +1,234 @@
+"""
+Álgebra de bandas: NDVI y LST a partir de las bandas crudas de la escena.
+
+Sustituye a los promedios precalculados (p.ej. en Google Earth Engine). Cada
+tesela se lee una sola vez y en la misma pasada se calcula:
+
+    rojo/NIR   -> reflectancia -> NDVI
+    térmica    -> radiancia -> temperatura de brillo -> LST (corrección por emisividad)
+                  (nivel 2: ST_B10 ya es LST y solo se escala)
+    QA_PIXEL   -> máscara de nubes/sombra/cirros/relleno
+    NDVI + LST -> estrés ambiental (SpatialStressCalculator.stress_kernel)
+
+Los únicos arrays del tamaño de la escena son las salidas que se pidan
+explícitamente (escritas tesela a tesela); el resumen de la escena se
+reduce a partir de sumas parciales por tesela.
+"""
+
+import os
+from dataclasses import dataclass
+from typing import Dict, Iterable, Optional
+
+import numpy as np
+
+from app.core.raster_io import Window, create_raster, open_raster, tiles
+from app.core.spatial_metrics import SpatialStressCalculator
+from app.core.warp import align
+from app.core.work_pool import get_pool
+
+# Constante de segunda radiación, h*c/k_B en µm·K
+RHO_UM_K = 14388.0
+
+# QA_PIXEL con el bit de relleno: lo que una banda QA remuestreada no cubre queda enmascarado
+QA_FILL = 1
+
+
+@dataclass(frozen=True)
+class Calibration:
+    """
+    Coeficientes de calibración radiométrica de un producto concreto (LANDSAT_L1, LANDSAT_L2).
+
+    Con `k1` la banda térmica escalada es radiancia y se invierte Planck; sin él
+    ya es temperatura en K. `surface_temperature` indica que esa temperatura ya
+    es LST (corregida por emisividad) y no se vuelve a corregir.
+    """
+    reflectance_mult: float
+    reflectance_add: float
+    thermal_mult: float
+    thermal_add: float
+    k1: Optional[float] = None
+    k2: Optional[float] = None
+    surface_temperature: bool = False
+    wavelength_um: float = 10.895
+    # Bits de QA_PIXEL que invalidan el píxel: relleno(0), nube dilatada(1), cirros(2), nube(3), sombra(4)
+    qa_mask_bits: int = 0b11111
+    nodata: Optional[float] = 0
+
+
+# Landsat 8/9 Collection 2 nivel 1: reflectancia TOA (B4, B5) y radiancia de B10 con K1/K2 del MTL
+LANDSAT_L1 = Calibration(2.0e-5, -0.1, 3.342e-4, 0.1, k1=774.8853, k2=1321.0789)
+# Nivel 2: reflectancia de superficie (SR_B4, SR_B5) y temperatura de superficie ST_B10 en K
+LANDSAT_L2 = Calibration(2.75e-5, -0.2, 0.00341802, 149.0, surface_temperature=True)
+CALIBRATIONS = {"L1": LANDSAT_L1, "L2": LANDSAT_L2}
+
+# Emisividad por umbrales de NDVI (Sobrino et al., 2004)
+NDVI_SOIL, NDVI_VEG = 0.2, 0.5
+EMISSIVITY_WATER, EMISSIVITY_SOIL, EMISSIVITY_VEG = 0.991, 0.973, 0.99
+
+
+@dataclass
+class Scene:
+    red: str
+    nir: str
+    thermal: str
+    qa: Optional[str] = None
+    calibration: Calibration = LANDSAT_L2
+
+
+def ndvi_kernel(red: np.ndarray, nir: np.ndarray, out: np.ndarray) -> None:
+    """NDVI in-place sobre reflectancias ya escaladas; fuera de [-1, 1] o sin señal queda NaN."""
+    denom = nir + red
+    np.subtract(nir, red, out=out)
+    with np.errstate(divide="ignore", invalid="ignore"):
+        out /= denom
+    out[(denom <= 0) | (np.abs(out) > 1)] = np.nan
+
+
+def emissivity(ndvi: np.ndarray) -> np.ndarray:
+    """Emisividad de superficie a partir de la fracción de vegetación Pv = ((NDVI - s) / (v - s))^2."""
+    pv = np.clip((ndvi - NDVI_SOIL) / (NDVI_VEG - NDVI_SOIL), 0.0, 1.0)
+    pv *= pv
+    eps = 0.004 * pv + 0.986
+    eps[ndvi < NDVI_SOIL] = EMISSIVITY_SOIL
+    eps[ndvi > NDVI_VEG] = EMISSIVITY_VEG
+    eps[ndvi < 0] = EMISSIVITY_WATER
+    return eps
+
+
+def lst_kernel(thermal: np.ndarray, ndvi: np.ndarray, cal: Calibration, out: np.ndarray) -> None:
+    """LST en °C: T_B / (1 + (λ·T_B / ρ)·ln ε) - 273.15, con T_B la temperatura de brillo."""
+    np.multiply(thermal, cal.thermal_mult, out=out)
+    out += cal.thermal_add
+    if cal.surface_temperature:
+        out -= 273.15
+        return
+    if cal.k1 is not None:
+        with np.errstate(divide="ignore", invalid="ignore"):
+            np.divide(cal.k1, out, out=out)
+            out += 1.0
+            np.log(out, out=out)
+            np.divide(cal.k2, out, out=out)
+    scale = np.log(emissivity(ndvi))
+    scale *= out
+    scale *= cal.wavelength_um / RHO_UM_K
+    scale += 1.0
+    out /= scale
+    out -= 273.15
+
+
+def valid_mask(bands: Iterable[np.ndarray], qa: Optional[np.ndarray], cal: Calibration) -> np.ndarray:
+    valid = np.ones(next(iter(bands)).shape, dtype=bool) if qa is None else (qa & cal.qa_mask_bits) == 0
+    if cal.nodata is not None:
+        for band in bands:
+            valid &= band != cal.nodata
+    return valid
+
+
+class SceneStressProcessor:
+    """Escena cruda -> NDVI, LST y estrés en una pasada por teselas de filas en el pool compartido."""
+
+    TILE_ROWS = SpatialStressCalculator.TILE_ROWS
+    OUTPUTS = ("stress", "ndvi", "lst")
+
+    def __init__(self, scene: Scene):
+        self.scene = scene
+        self.cal = scene.calibration
+        self.red = self.nir = self.thermal = self.qa = None
+        try:
+            self.red = open_raster(scene.red)
+            self.nir = open_raster(scene.nir)
+            self.thermal = open_raster(scene.thermal)
+            self.qa = open_raster(scene.qa) if scene.qa else None
+            self.shape = self.red.shape
+            # Bandas en otra rejilla o CRS (térmica a 100 m, otra escena...): se remuestrean al vuelo a la del rojo
+            self.nir = align(self.nir, self.red, "bilinear", self.cal.nodata)
+            self.thermal = align(self.thermal, self.red, "bilinear", self.cal.nodata)
+            if self.qa is not None:
+                self.qa = align(self.qa, self.red, "nearest", QA_FILL)
+        except BaseException:
+            self.close()  # una banda ilegible o sin CRS común no deja abiertas las anteriores
+            raise
+
+    def close(self) -> None:
+        for band in (self.red, self.nir, self.thermal, self.qa):
+            if band is not None:
+                band.close()
+
+    def tile(self, window: Window) -> Dict[str, np.ndarray]:
+        """Todas las capas de una tesela; los píxeles enmascarados quedan NaN."""
+        cal = self.cal
+        red_dn, nir_dn, thermal_dn = self.red.read(window), self.nir.read(window), self.thermal.read(window)
+        valid = valid_mask((red_dn, nir_dn, thermal_dn), self.qa.read(window) if self.qa else None, cal)
+
+        red = red_dn.astype(np.float32)
+        red *= cal.reflectance_mult
+        red += cal.reflectance_add
+        nir = nir_dn.astype(np.float32)
+        nir *= cal.reflectance_mult
+        nir += cal.reflectance_add
+
+        ndvi = np.empty(red.shape, dtype=np.float32)
+        ndvi_kernel(red, nir, ndvi)
+        lst = red  # el buffer de rojo ya no se usa: se reutiliza para la LST
+        lst_kernel(thermal_dn, ndvi, cal, lst)
+        valid &= np.isfinite(ndvi) & np.isfinite(lst)
+        ndvi[~valid] = np.nan
+        lst[~valid] = np.nan
+
+        stress = nir  # ídem con el NIR
+        SpatialStressCalculator.stress_kernel(ndvi, lst, stress)
+        return {"stress": stress, "ndvi": ndvi, "lst": lst, "valid": valid}
+
+    def run(self, out_dir: Optional[str] = None, outputs: Iterable[str] = ("stress",)) -> dict:
+        """
+        Procesa la escena completa. Devuelve medias sobre píxeles válidos y,
+        si se indica `out_dir`, escribe las capas pedidas como rásters.
+        """
+        outputs = tuple(outputs) if out_dir else ()
+        unknown = set(outputs) - set(self.OUTPUTS)
+        if unknown:
+            raise ValueError(f"Salidas desconocidas: {sorted(unknown)}")
+        writers = {
+            name: create_raster(os.path.join(out_dir, f"{name}.npy"), self.shape, np.float32,
+                                self.red.transform, self.red.crs, float("nan"))
+            for name in outputs
+        }
+
+        def run_tile(window: Window) -> np.ndarray:
+            layers = self.tile(window)
+            for name, writer in writers.items():
+                writer.write(window, layers[name])
+            valid = layers["valid"]
+            return np.array([
+                valid.sum(),
+                layers["ndvi"].sum(where=valid, dtype=np.float64),
+                layers["lst"].sum(where=valid, dtype=np.float64),
+                layers["stress"].sum(where=valid, dtype=np.float64),
+            ])
+
+        try:
+            totals = np.sum(get_pool().map(run_tile, tiles(self.shape, self.TILE_ROWS)), axis=0)
+        finally:
+            for writer in writers.values():
+                writer.close()
+
+        pixels = self.shape[0] * self.shape[1]
+        valid = int(totals[0])
+        mean = (lambda s: round(float(s / valid), 4)) if valid else (lambda s: None)
+        return {
+            "pixels": pixels,
+            "valid_pixels": valid,
+            "masked_fraction": round(1.0 - valid / pixels, 4),
+            "ndvi_mean": mean(totals[1]),
+            "lst_mean_celsius": mean(totals[2]),
+            "stress_mean": mean(totals[3]),
+            "outputs": {name: writer.path for name, writer in writers.items()},
+        }
+
+
+def derive_scene(scene: Scene, out_dir: Optional[str] = None, outputs: Iterable[str] = ("stress",)) -> dict:
+    processor = SceneStressProcessor(scene)
+    try:
+        return processor.run(out_dir, outputs)
+    finally:
+        processor.close()
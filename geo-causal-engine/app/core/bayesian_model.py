@@ -1,18 +1,41 @@
 import numpy as np
+from typing import Dict, Optional
+
+from app.core.model_registry import ModelRegistry
 
 class PoliticalInferenceEngine:
     """
     Motor de Inferencia Causal que cruza variables geográficas (estrés ambiental)
     con variables psicométricas (Big Five) para calcular invariantes políticos.
     """
+
+    # Coeficientes de las ecuaciones estructurales (versionables vía registro)
+    NATION_CONSCIENTIOUSNESS_WEIGHT = 1.5
+    NATION_STRESS_WEIGHT = 0.5
+    NATION_EXTRAVERSION_WEIGHT = 1.0
+    PATRIA_EXTRAVERSION_WEIGHT = 1.5
+    PATRIA_STRESS_WEIGHT = 0.8
+    PATRIA_CONSCIENTIOUSNESS_WEIGHT = 1.0
+
+    def __init__(self, params: Optional[Dict[str, float]] = None, version: str = "builtin"):
+        # Los parámetros desconocidos se rechazan: un error tipográfico no debe servir los valores por defecto
+        self.version = version
+        for key, value in (params or {}).items():
+            if not key.isupper() or not hasattr(type(self), key):
+                raise ValueError(f"Parámetro desconocido del modelo político: {key}")
+            setattr(self, key, float(value))
     
-    @staticmethod
-    def calculate_synthesis(conscientiousness: float, extraversion: float, env_stress: float) -> dict:
+    def scores(self, conscientiousness, extraversion, env_stress):
+        """Puntuaciones (nación, patria); escalares o arrays (p.ej. una tesela del mapa)."""
         # Ecuación 1: La institucionalidad (Nación) requiere orden y manejo racional del estrés
-        nation_score = (conscientiousness * 1.5) + (env_stress * 0.5) - extraversion
+        nation_score = (conscientiousness * self.NATION_CONSCIENTIOUSNESS_WEIGHT) + (env_stress * self.NATION_STRESS_WEIGHT) - extraversion * self.NATION_EXTRAVERSION_WEIGHT
         
         # Ecuación 2: El caudillismo (Patria) se alimenta del gregarismo y reacciona emocionalmente al estrés
-        patria_score = (extraversion * 1.5) + (env_stress * 0.8) - conscientiousness
+        patria_score = (extraversion * self.PATRIA_EXTRAVERSION_WEIGHT) + (env_stress * self.PATRIA_STRESS_WEIGHT) - conscientiousness * self.PATRIA_CONSCIENTIOUSNESS_WEIGHT
+        return nation_score, patria_score
+
+    def calculate_synthesis(self, conscientiousness: float, extraversion: float, env_stress: float) -> dict:
+        nation_score, patria_score = self.scores(conscientiousness, extraversion, env_stress)
         
         # Normalización matemática (Softmax)
         total = np.exp(nation_score) + np.exp(patria_score)
@@ -29,3 +52,7 @@ class PoliticalInferenceEngine:
             "probability_patria": round(float(prob_patria), 4),
             "dominant_structure": dominant_structure
         }
+
+
+# Instancia global (recargable en caliente mediante el registro de modelos)
+registry = ModelRegistry("political", lambda params, version: PoliticalInferenceEngine(params, version))
@@ -0,0 +1,605 @@
+"""
+Lectura de GeoTIFF/COG por bloques con caché local compartida.
+
+Los motores vuelven a leer los mismos bloques de una escena en cada
+petición (estrés, teselas, zonal...). Aquí el TIFF se lee bloque a bloque
+con un lector mínimo de IFDs (TIFF y BigTIFF, teselas o tiras, sin
+compresión o deflate, predictores 2 y 3, vistas generales) y cada bloque
+decodificado se guarda en una caché compartida por todo el proceso:
+
+    clave = (fichero, nivel de vista general, índice de bloque)
+
+- Memoria: LRU acotado en bytes (GEO_COG_CACHE_MB).
+- Disco (GEO_COG_CACHE_DIR, GEO_COG_DISK_MB): un .npy por bloque; sobrevive
+  a reinicios y lo comparten los trabajos. Un acierto en disco se copia al
+  LRU de memoria, que así cuenta solo bytes residentes de verdad.
+
+La identidad del fichero incluye tamaño y mtime (ETag o Last-Modified en
+HTTP): un fichero reescrito no reutiliza bloques viejos. Si el servidor no
+envía ni ETag ni Last-Modified no hay forma de saberlo: esos ficheros no
+usan el disco y su identidad vale solo para el proceso. Los bloques que faltan se
+piden con lecturas de rango agrupadas (rangos contiguos o separados por
+menos de COALESCE_GAP se leen de una vez), y según la dirección en que
+avanzan las ventanas se precarga en segundo plano la siguiente fila o
+columna de bloques. Una consulta repetida sobre la misma región no toca
+el ráster.
+
+Compresiones no soportadas (LZW, JPEG, ZSTD...) o transforms con rotación
+lanzan UnsupportedTiff y open_raster recurre a rasterio.
+"""
+
+import hashlib
+import os
+import struct
+import sys
+import threading
+import urllib.request
+import uuid
+import zlib
+from collections import OrderedDict
+from concurrent.futures import wait
+from dataclasses import dataclass
+from typing import Callable, Dict, List, Optional, Sequence, Tuple
+
+import numpy as np
+
+from app.core.raster_io import GeoTransform, Window
+from app.core.work_pool import get_pool
+
+HEADER_BYTES = 1 << 16
+
+# Tamaños de los tipos TIFF (código -> formato struct)
+TYPES = {1: "B", 2: "s", 3: "H", 4: "I", 5: "II", 6: "b", 7: "B", 8: "h", 9: "i", 10: "ii",
+         11: "f", 12: "d", 13: "I", 16: "Q", 17: "q", 18: "Q"}
+
+NEW_SUBFILE_TYPE = 254
+IMAGE_WIDTH, IMAGE_LENGTH, BITS_PER_SAMPLE, COMPRESSION = 256, 257, 258, 259
+STRIP_OFFSETS, SAMPLES_PER_PIXEL, ROWS_PER_STRIP, STRIP_BYTE_COUNTS = 273, 277, 278, 279
+PLANAR_CONFIG, PREDICTOR = 284, 317
+TILE_WIDTH, TILE_LENGTH, TILE_OFFSETS, TILE_BYTE_COUNTS = 322, 323, 324, 325
+SAMPLE_FORMAT = 339
+MODEL_PIXEL_SCALE, MODEL_TIEPOINT, MODEL_TRANSFORMATION = 33550, 33922, 34264
+GEO_KEY_DIRECTORY, GDAL_NODATA = 34735, 42113
+
+DEFLATE = (8, 32946)
+
+PROCESS_TOKEN = uuid.uuid4().hex  # identidad de fuentes sin validador: no sobrevive al proceso
+
+
+class UnsupportedTiff(ValueError):
+    """El fichero es válido pero este lector no lo cubre: se usa rasterio."""
+
+
+# ----------------------------------------------------------------------
+# Fuentes de bytes
+# ----------------------------------------------------------------------
+
+class LocalSource:
+    COALESCE_GAP = 1 << 16
+    persistent = True  # la identidad (tamaño, mtime) detecta reescrituras: puede usar la caché en disco
+
+    def __init__(self, path: str):
+        self.path = path
+        self._fd = os.open(path, os.O_RDONLY)
+        st = os.fstat(self._fd)
+        self.size = st.st_size
+        self.identity = f"{os.path.realpath(path)}:{st.st_size}:{st.st_mtime_ns}"
+
+    def read(self, offset: int, length: int) -> bytes:
+        return os.pread(self._fd, length, offset)
+
+    def close(self) -> None:
+        os.close(self._fd)
+
+
+class HttpSource:
+    # En HTTP cada petición cuesta una ida y vuelta: compensa leer huecos más grandes
+    COALESCE_GAP = 1 << 20
+
+    def __init__(self, url: str):
+        self.path = url
+        head = urllib.request.urlopen(urllib.request.Request(url, method="HEAD"), timeout=30)
+        self.size = int(head.headers.get("Content-Length", 0))
+        validator = head.headers.get("ETag") or head.headers.get("Last-Modified")
+        self.persistent = validator is not None
+        self.identity = f"{url}:{validator or PROCESS_TOKEN}:{self.size}"
+
+    def read(self, offset: int, length: int) -> bytes:
+        request = urllib.request.Request(self.path, headers={"Range": f"bytes={offset}-{offset + length - 1}"})
+        with urllib.request.urlopen(request, timeout=60) as response:
+            return response.read()
+
+    def close(self) -> None:
+        pass
+
+
+def open_source(path: str):
+    return HttpSource(path) if path.startswith(("http://", "https://")) else LocalSource(path)
+
+
+def coalesce(ranges: Sequence[Tuple[int, int]], gap: int) -> List[Tuple[int, int, List[int]]]:
+    """Agrupa rangos (offset, longitud) cercanos: [(inicio, fin, posiciones de los rangos originales)]."""
+    groups: List[Tuple[int, int, List[int]]] = []
+    for i in sorted(range(len(ranges)), key=lambda i: ranges[i][0]):
+        start, end = ranges[i][0], ranges[i][0] + ranges[i][1]
+        if groups and start - groups[-1][1] <= gap:
+            groups[-1] = (groups[-1][0], max(groups[-1][1], end), groups[-1][2] + [i])
+        else:
+            groups.append((start, end, [i]))
+    return groups
+
+
+# ----------------------------------------------------------------------
+# Estructura del TIFF
+# ----------------------------------------------------------------------
+
+@dataclass
+class Level:
+    """Una resolución: la imagen completa (nivel 0) o una vista general."""
+    width: int
+    height: int
+    block_width: int
+    block_height: int
+    offsets: np.ndarray
+    byte_counts: np.ndarray
+    dtype: np.dtype
+    samples: int
+    planar: int
+    compression: int
+    predictor: int
+
+    @property
+    def blocks_across(self) -> int:
+        return -(-self.width // self.block_width)
+
+    @property
+    def blocks_down(self) -> int:
+        return -(-self.height // self.block_height)
+
+
+class _Header:
+    """IFDs del fichero; la cabecera de un COG cabe en los primeros KB, el resto se pide bajo demanda."""
+
+    def __init__(self, source):
+        self.source = source
+        self.buffer = source.read(0, HEADER_BYTES)
+        order = self.buffer[:2]
+        if order not in (b"II", b"MM"):
+            raise UnsupportedTiff(f"{source.path}: no es un TIFF")
+        self.endian = "<" if order == b"II" else ">"
+        magic = self.unpack("H", 2)[0]
+        if magic == 42:
+            self.big, self.first = False, self.unpack("I", 4)[0]
+        elif magic == 43:
+            self.big, self.first = True, self.unpack("Q", 8)[0]
+        else:
+            raise UnsupportedTiff(f"{source.path}: versión TIFF desconocida {magic}")
+
+    def bytes(self, offset: int, length: int) -> bytes:
+        if offset + length <= len(self.buffer):
+            return self.buffer[offset:offset + length]
+        return self.source.read(offset, length)
+
+    def unpack(self, fmt: str, offset: int) -> tuple:
+        fmt = self.endian + fmt
+        return struct.unpack(fmt, self.bytes(offset, struct.calcsize(fmt)))
+
+    def ifds(self):
+        offset = self.first
+        count_fmt, entry, size = ("Q", 20, 8) if self.big else ("H", 12, 4)
+        while offset:
+            n = self.unpack(count_fmt, offset)[0]
+            base = offset + struct.calcsize(count_fmt)
+            raw = self.bytes(base, n * entry + size)
+            tags = {}
+            for i in range(n):
+                e = raw[i * entry:(i + 1) * entry]
+                tag, typ = struct.unpack(self.endian + "HH", e[:4])
+                count = struct.unpack(self.endian + ("Q" if self.big else "I"), e[4:4 + size])[0]
+                if typ not in TYPES:
+                    continue
+                fmt = TYPES[typ] if typ != 2 else "s"
+                nbytes = struct.calcsize(self.endian + fmt) * count
+                data = e[4 + size:] if nbytes <= size else self.bytes(
+                    struct.unpack(self.endian + ("Q" if self.big else "I"), e[4 + size:])[0], nbytes)
+                if typ == 2:
+                    tags[tag] = data[:count].rstrip(b"\x00").decode("ascii", "replace")
+                else:
+                    values = struct.unpack(f"{self.endian}{count * len(fmt)}{fmt[0]}", data[:nbytes])
+                    tags[tag] = values if typ not in (5, 10) else tuple(
+                        values[i] / values[i + 1] for i in range(0, len(values), 2))
+            yield tags
+            offset = struct.unpack(self.endian + ("Q" if self.big else "I"), raw[n * entry:n * entry + size])[0]
+
+
+def _level(tags: dict, endian: str, path: str) -> Level:
+    width, height = tags[IMAGE_WIDTH][0], tags[IMAGE_LENGTH][0]
+    if TILE_WIDTH in tags:
+        bw, bh = tags[TILE_WIDTH][0], tags[TILE_LENGTH][0]
+        offsets, counts = tags[TILE_OFFSETS], tags[TILE_BYTE_COUNTS]
+    else:
+        # Tiras: bloques del ancho completo de RowsPerStrip filas
+        bw, bh = width, tags.get(ROWS_PER_STRIP, (height,))[0]
+        offsets, counts = tags[STRIP_OFFSETS], tags[STRIP_BYTE_COUNTS]
+    bits = set(tags.get(BITS_PER_SAMPLE, (1,)))
+    kind = {1: "u", 2: "i", 3: "f"}.get(tags.get(SAMPLE_FORMAT, (1,))[0])
+    if len(bits) != 1 or kind is None or bits.pop() not in (8, 16, 32, 64):
+        raise UnsupportedTiff(f"{path}: formato de muestra no soportado")
+    compression = tags.get(COMPRESSION, (1,))[0]
+    if compression not in (1,) + DEFLATE:
+        raise UnsupportedTiff(f"{path}: compresión {compression} no soportada")
+    predictor = tags.get(PREDICTOR, (1,))[0]
+    if predictor not in (1, 2, 3):
+        raise UnsupportedTiff(f"{path}: predictor {predictor} no soportado")
+    size = tags[BITS_PER_SAMPLE][0] // 8
+    return Level(
+        width=width, height=height, block_width=bw, block_height=bh,
+        offsets=np.asarray(offsets, dtype=np.int64), byte_counts=np.asarray(counts, dtype=np.int64),
+        dtype=np.dtype(f"{endian}{kind}{size}"), samples=tags.get(SAMPLES_PER_PIXEL, (1,))[0],
+        planar=tags.get(PLANAR_CONFIG, (1,))[0], compression=compression, predictor=predictor,
+    )
+
+
+def _georeference(tags: dict, path: str) -> Tuple[GeoTransform, Optional[str]]:
+    if MODEL_TRANSFORMATION in tags:
+        m = tags[MODEL_TRANSFORMATION]
+        if m[1] or m[4]:
+            raise UnsupportedTiff(f"{path}: transform con rotación no soportado")
+        transform = GeoTransform(m[3], m[0], m[7], m[5])
+    elif MODEL_PIXEL_SCALE in tags and MODEL_TIEPOINT in tags:
+        sx, sy = tags[MODEL_PIXEL_SCALE][:2]
+        i, j, _, x, y, _ = tags[MODEL_TIEPOINT][:6]
+        transform = GeoTransform(x - i * sx, sx, y + j * sy, -sy)
+    else:
+        transform = GeoTransform()
+
+    crs = None
+    keys = tags.get(GEO_KEY_DIRECTORY, ())
+    geokeys = {keys[i]: keys[i + 3] for i in range(4, 4 + 4 * (keys[3] if len(keys) > 3 else 0), 4)
+               if keys[i + 1] == 0}
+    for key in (3072, 2048):  # ProjectedCSTypeGeoKey, GeographicTypeGeoKey
+        if 0 < geokeys.get(key, 0) < 32767:
+            crs = f"EPSG:{geokeys[key]}"
+            break
+    if geokeys.get(1025) == 2:  # RasterPixelIsPoint: el punto de enlace es el centro del píxel
+        transform = GeoTransform(transform.x0 - transform.dx / 2, transform.dx,
+                                 transform.y0 - transform.dy / 2, transform.dy)
+    return transform, crs
+
+
+def decode_block(level: Level, raw: bytes) -> np.ndarray:
+    """Bytes de un bloque -> array (filas, columnas, muestras) en orden nativo."""
+    if level.compression in DEFLATE:
+        raw = zlib.decompress(raw)
+    samples = level.samples if level.planar == 1 else 1
+    row_values = level.block_width * samples
+    itemsize = level.dtype.itemsize
+    rows = len(raw) // (row_values * itemsize)
+    raw = raw[:rows * row_values * itemsize]
+    if level.predictor == 3:
+        # Predictor flotante: cada fila son planos de bytes (el más significativo primero) diferenciados
+        planes = np.cumsum(np.frombuffer(raw, dtype=np.uint8).reshape(rows, itemsize * row_values),
+                           axis=1, dtype=np.uint8)
+        big = planes.reshape(rows, itemsize, row_values).transpose(0, 2, 1)
+        block = np.ascontiguousarray(big).view(level.dtype.newbyteorder(">")).reshape(rows, row_values)
+    else:
+        block = np.frombuffer(raw, dtype=level.dtype).reshape(rows, row_values)
+    block = block.reshape(rows, level.block_width, samples)
+    if level.predictor == 2:
+        block = np.cumsum(block, axis=1, dtype=block.dtype)
+    return block.astype(block.dtype.newbyteorder("="), copy=False)
+
+
+# ----------------------------------------------------------------------
+# Caché de bloques
+# ----------------------------------------------------------------------
+
+class BlockCache:
+    """Bloques decodificados por (fichero, nivel, bloque): LRU en memoria + .npy mapeados en disco."""
+
+    def __init__(self, max_bytes: int, directory: Optional[str] = None, disk_bytes: int = 0):
+        self.max_bytes = max_bytes
+        self.directory = directory
+        self.disk_bytes = disk_bytes
+        self.stats = {"memory": 0, "disk": 0, "fetched": 0, "prefetched": 0, "range_reads": 0, "bytes_read": 0}
+        self._lru: "OrderedDict[tuple, np.ndarray]" = OrderedDict()
+        self._bytes = 0
+        self._disk: "OrderedDict[str, int]" = OrderedDict()
+        self._disk_total = 0
+        self._inflight: Dict[tuple, threading.Event] = {}
+        self._lock = threading.Lock()
+        if directory:
+            self._scan_disk()
+
+    def _scan_disk(self) -> None:
+        # Índice del disco por antigüedad de acceso; se recorre una vez al arrancar
+        entries = []
+        for root, _, files in os.walk(self.directory):
+            for name in files:
+                if name.endswith(".npy"):
+                    path = os.path.join(root, name)
+                    st = os.stat(path)
+                    entries.append((st.st_atime, path, st.st_size))
+        for _, path, size in sorted(entries):
+            self._disk[path] = size
+            self._disk_total += size
+
+    def _path(self, key: tuple) -> str:
+        file_id, level, index = key
+        return os.path.join(self.directory, file_id, str(level), f"{index}.npy")
+
+    def _remember(self, key: tuple, block: np.ndarray) -> None:
+        with self._lock:
+            if key in self._lru:
+                self._lru.move_to_end(key)
+                return
+            self._lru[key] = block
+            self._bytes += block.nbytes
+            while self._bytes > self.max_bytes and self._lru:
+                self._bytes -= self._lru.popitem(last=False)[1].nbytes
+
+    def in_memory(self, key: tuple) -> bool:
+        with self._lock:
+            return key in self._lru
+
+    def get(self, key: tuple, persist: bool = True) -> Optional[np.ndarray]:
+        with self._lock:
+            block = self._lru.get(key)
+            if block is not None:
+                self._lru.move_to_end(key)
+                self.stats["memory"] += 1
+                return block
+        if not self.directory or not persist:
+            return None
+        path = self._path(key)
+        try:
+            block = np.load(path)
+        except (FileNotFoundError, ValueError, EOFError):
+            return None
+        with self._lock:
+            if path in self._disk:
+                self._disk.move_to_end(path)
+            self.stats["disk"] += 1
+        self._remember(key, block)
+        return block
+
+    def put(self, key: tuple, block: np.ndarray, persist: bool = True) -> None:
+        self._remember(key, block)
+        if not self.directory or not persist:
+            return
+        path = self._path(key)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        tmp = f"{path}.{threading.get_ident()}.tmp.npy"
+        np.save(tmp, block)
+        os.replace(tmp, path)
+        size = os.path.getsize(path)
+        evict = []
+        with self._lock:
+            self._disk_total += size - self._disk.pop(path, 0)
+            self._disk[path] = size
+            while self._disk_total > self.disk_bytes and len(self._disk) > 1:
+                old, old_size = self._disk.popitem(last=False)
+                self._disk_total -= old_size
+                evict.append(old)
+        for old in evict:
+            try:
+                os.remove(old)
+            except FileNotFoundError:
+                pass
+
+    def get_many(self, keys: Sequence[tuple], fetch: Callable[[List[tuple]], Dict[tuple, np.ndarray]],
+                 persist: bool = True) -> Dict[tuple, np.ndarray]:
+        """
+        Bloques pedidos; los que faltan se leen con `fetch` una sola vez aunque
+        los pidan varios hilos. Con persist=False no se lee ni escribe el disco.
+        """
+        found: Dict[tuple, np.ndarray] = {}
+        claimed: List[tuple] = []
+        waiting: List[Tuple[tuple, threading.Event]] = []
+        for key in keys:
+            block = self.get(key, persist)
+            if block is not None:
+                found[key] = block
+                continue
+            with self._lock:
+                event = self._inflight.get(key)
+                if event is None:
+                    self._inflight[key] = threading.Event()
+                    claimed.append(key)
+                else:
+                    waiting.append((key, event))
+        if claimed:
+            try:
+                fetched = fetch(claimed)
+                for key, block in fetched.items():
+                    self.put(key, block, persist)
+                found.update(fetched)
+            finally:
+                with self._lock:
+                    for key in claimed:
+                        self._inflight.pop(key).set()
+        for key, event in waiting:
+            event.wait()
+            block = self.get(key, persist)
+            found[key] = block if block is not None else fetch([key])[key]
+        return found
+
+    def summary(self) -> dict:
+        with self._lock:
+            return {**self.stats, "memory_bytes": self._bytes, "disk_bytes": self._disk_total}
+
+
+block_cache = BlockCache(
+    int(float(os.getenv("GEO_COG_CACHE_MB", "512")) * 2 ** 20),
+    os.getenv("GEO_COG_CACHE_DIR") or None,
+    int(float(os.getenv("GEO_COG_DISK_MB", "4096")) * 2 ** 20),
+)
+
+
+# ----------------------------------------------------------------------
+# Lector
+# ----------------------------------------------------------------------
+
+class CogRaster:
+    """Una banda de un GeoTIFF/COG local o remoto, con la misma interfaz que NpyRaster."""
+
+    def __init__(self, path: str, band: int = 1, cache: Optional[BlockCache] = None):
+        self.path = path
+        self.band = band
+        self.cache = cache or block_cache
+        self.source = open_source(path)
+        try:
+            header = _Header(self.source)
+            ifds = [tags for tags in header.ifds() if not tags.get(NEW_SUBFILE_TYPE, (0,))[0] & 4]
+            self.levels = [_level(tags, header.endian, path) for tags in ifds
+                           if tags is ifds[0] or tags.get(NEW_SUBFILE_TYPE, (0,))[0] & 1]
+            self.levels.sort(key=lambda level: -level.width)
+            self.transform, self.crs = _georeference(ifds[0], path)
+        except Exception:
+            self.source.close()
+            raise
+        nodata = ifds[0].get(GDAL_NODATA)
+        self.nodata = float(nodata) if nodata not in (None, "", "nan") else None
+        if not 1 <= band <= self.levels[0].samples:
+            self.source.close()
+            raise ValueError(f"{path}: banda {band} fuera de rango (1..{self.levels[0].samples})")
+        self.file_id = hashlib.blake2b(self.source.identity.encode(), digest_size=10).hexdigest()
+        self._last: Dict[int, Tuple[int, int, int, int]] = {}
+        self._prefetches: set = set()
+        self._prefetch_lock = threading.Lock()
+        self._closed = False
+
+    @property
+    def shape(self) -> Tuple[int, int]:
+        return self.levels[0].height, self.levels[0].width
+
+    @property
+    def dtype(self) -> np.dtype:
+        return self.levels[0].dtype.newbyteorder("=")
+
+    def close(self) -> None:
+        # Las precargas en cola se cancelan y las que ya leen terminan antes de
+        # cerrar: un pread sobre un fd cerrado (o ya reutilizado por otro
+        # fichero) metería bloques ajenos en la caché bajo este file_id.
+        with self._prefetch_lock:
+            self._closed = True
+            pending = list(self._prefetches)
+        for future in pending:
+            future.cancel()
+        wait(pending)
+        self.source.close()
+
+    def read(self, window: Window, out_shape: Optional[Tuple[int, int]] = None) -> np.ndarray:
+        if out_shape is None:
+            return self._read_level(0, window)
+        rows = window.row + (np.arange(out_shape[0]) * window.height) // out_shape[0]
+        cols = window.col + (np.arange(out_shape[1]) * window.width) // out_shape[1]
+        # La vista general más gruesa que aún tiene al menos la resolución pedida
+        step = min(window.height / out_shape[0], window.width / out_shape[1])
+        index = max((i for i, level in enumerate(self.levels) if self.levels[0].width / level.width <= step),
+                    default=0)
+        level = self.levels[index]
+        rows = rows * level.height // self.levels[0].height
+        cols = cols * level.width // self.levels[0].width
+        r0, c0 = int(rows[0]), int(cols[0])
+        data = self._read_level(index, Window(r0, c0, int(rows[-1]) + 1 - r0, int(cols[-1]) + 1 - c0))
+        return data[np.ix_(rows - r0, cols - c0)]
+
+    def _key(self, index: int, level: Level, block_row: int, block_col: int) -> tuple:
+        block = block_row * level.blocks_across + block_col
+        if level.planar == 2:
+            block += (self.band - 1) * level.blocks_across * level.blocks_down
+        return self.file_id, index, block
+
+    def _fetch(self, index: int, keys: List[tuple]) -> Dict[tuple, np.ndarray]:
+        if self._closed:
+            raise ValueError(f"{self.path}: ráster cerrado")
+        level = self.levels[index]
+        blocks = [key[2] for key in keys]
+        ranges = [(int(level.offsets[b]), int(level.byte_counts[b])) for b in blocks]
+        out: Dict[tuple, np.ndarray] = {}
+        present = [i for i, r in enumerate(ranges) if r[1] > 0]
+        for start, end, members in coalesce([ranges[i] for i in present], self.source.COALESCE_GAP):
+            data = self.source.read(start, end - start)
+            self.cache.stats["range_reads"] += 1
+            self.cache.stats["bytes_read"] += len(data)
+            for m in members:
+                offset, length = ranges[present[m]]
+                out[keys[present[m]]] = decode_block(level, data[offset - start:offset - start + length])
+        for key, (_, length) in zip(keys, ranges):
+            if length == 0:
+                # Bloque disperso (sin datos escritos): nodata o cero
+                fill = self.nodata if self.nodata is not None else 0
+                samples = level.samples if level.planar == 1 else 1
+                out[key] = np.full((level.block_height, level.block_width, samples), fill, dtype=self.dtype)
+        self.cache.stats["fetched"] += len(out)
+        return out
+
+    def _blocks(self, index: int, br0: int, br1: int, bc0: int, bc1: int) -> List[tuple]:
+        level = self.levels[index]
+        br0, bc0 = max(br0, 0), max(bc0, 0)
+        br1, bc1 = min(br1, level.blocks_down - 1), min(bc1, level.blocks_across - 1)
+        return [self._key(index, level, r, c) for r in range(br0, br1 + 1) for c in range(bc0, bc1 + 1)]
+
+    def _read_level(self, index: int, window: Window) -> np.ndarray:
+        level = self.levels[index]
+        bh, bw = level.block_height, level.block_width
+        br0, br1 = window.row // bh, (window.row + window.height - 1) // bh
+        bc0, bc1 = window.col // bw, (window.col + window.width - 1) // bw
+        keys = self._blocks(index, br0, br1, bc0, bc1)
+        blocks = self.cache.get_many(keys, lambda missing: self._fetch(index, missing), self.source.persistent)
+        self._prefetch(index, (br0, br1, bc0, bc1))
+
+        out = np.empty((window.height, window.width), dtype=self.dtype)
+        sample = self.band - 1 if level.planar == 1 else 0
+        for key in keys:
+            block_row, block_col = divmod(key[2] % (level.blocks_across * level.blocks_down), level.blocks_across)
+            top, left = block_row * bh, block_col * bw
+            r0, r1 = max(window.row, top), min(window.row + window.height, top + bh)
+            c0, c1 = max(window.col, left), min(window.col + window.width, left + bw)
+            out[r0 - window.row:r1 - window.row, c0 - window.col:c1 - window.col] = \
+                blocks[key][r0 - top:r1 - top, c0 - left:c1 - left, sample]
+        return out
+
+    def _prefetch(self, index: int, span: Tuple[int, int, int, int]) -> None:
+        """Siguiente franja de bloques en la dirección en que avanzan las ventanas, en segundo plano."""
+        previous = self._last.get(index)
+        self._last[index] = span
+        if previous is None or previous == span:
+            return
+        br0, br1, bc0, bc1 = span
+        dr = int(np.sign(br0 - previous[0]))
+        dc = int(np.sign(bc0 - previous[2]))
+        keys = []
+        if dr:
+            row = br1 + 1 if dr > 0 else br0 - 1
+            keys += self._blocks(index, row, row, bc0, bc1)
+        if dc:
+            col = bc1 + 1 if dc > 0 else bc0 - 1
+            keys += self._blocks(index, br0, br1, col, col)
+        keys = [key for key in keys if not self.cache.in_memory(key)]
+        if not keys:
+            return
+        with self._prefetch_lock:
+            if self._closed:
+                return
+            self.cache.stats["prefetched"] += len(keys)
+            future = get_pool().submit(self.cache.get_many, keys, lambda missing: self._fetch(index, missing),
+                                       self.source.persistent)
+            self._prefetches.add(future)
+        future.add_done_callback(self._prefetch_done)
+
+    def _prefetch_done(self, future) -> None:
+        with self._prefetch_lock:
+            self._prefetches.discard(future)
+
+
+if __name__ == "__main__":
+    # python -m app.core.cog escena.tif|https://.../escena.tif: estructura del fichero y niveles
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    raster = CogRaster(sys.argv[1])
+    print({"shape": raster.shape, "dtype": str(raster.dtype), "crs": raster.crs, "nodata": raster.nodata,
+           "transform": raster.transform.to_list(),
+           "levels": [{"size": (lv.height, lv.width), "block": (lv.block_height, lv.block_width),
+                       "compression": lv.compression, "predictor": lv.predictor} for lv in raster.levels]})
@@ -1,7 +1,6 @@
 import pandas as pd
 import numpy as np
-from linearmodels.iv import IV2SLS
-from typing import List, Dict, Any
+from typing import List, Dict, Any, Optional, Tuple
 
 class CausalInferenceEngine:
     """
@@ -16,7 +15,8 @@ class CausalInferenceEngine:
         dependent: str, 
         exogenous: List[str], 
         endogenous: str, 
-        instruments: List[str]
+        instruments: List[str],
+        coords: Optional[Tuple[str, str]] = None
     ) -> Dict[str, Any]:
         """
         Ejecuta una regresión de Mínimos Cuadrados en 2 Etapas (Variables Instrumentales).
@@ -24,10 +24,17 @@ class CausalInferenceEngine:
         Matemática subyacente:
         Etapa 1: endogenous ~ exogenous + instruments
         Etapa 2: dependent ~ exogenous + endogenous_hat
+
+        Con `coords` (columnas x, y en un CRS proyectado) se añaden Moran, Geary
+        y LISA de los residuos: si siguen autocorrelados, los errores de la
+        regresión no son independientes entre regiones.
         """
+        # linearmodels es el import más caro del motor: se carga solo al estimar
+        from linearmodels.iv import IV2SLS
+
         try:
             # 1. Asegurar que no hay valores nulos en el subset de análisis (Limpieza defensiva)
-            cols_to_keep = [dependent] + exogenous + [endogenous] + instruments
+            cols_to_keep = [dependent] + exogenous + [endogenous] + instruments + list(coords or [])
             df_clean = df[cols_to_keep].dropna()
 
             # 2. Configurar las matrices del modelo
@@ -70,6 +77,13 @@ class CausalInferenceEngine:
                 "model_diagnostics": "Robust covariance used (White/Huber)"
             } 
 
+            if coords:
+                from app.core.autocorrelation import SpatialWeights, diagnostics
+                w = SpatialWeights.knn(df_clean[list(coords)].to_numpy(dtype=float), k=8)
+                inference_payload["residual_spatial_autocorrelation"] = diagnostics(
+                    results.resids.to_numpy(), w, job="econometrics:residuals"
+                )
+
             return inference_payload
 
         except Exception as e:
@@ -80,14 +94,16 @@ class CausalInferenceEngine:
 # =====================================================================
 if __name__ == "__main__":
     # Simulamos el DataFrame que llegaría desde tu dbt / PostgreSQL
-    np.random.seed(42)
+    # Flujo Philox propio en lugar de np.random.seed global (reproducible y thread-safe)
+    from app.core.rng import stream
+    rng = stream(job="econometrics-demo")
     mock_data = pd.DataFrame({
-        'hours': np.random.randint(1000, 2500, 500),         # y: Horas trabajadas
-        'hushrs': np.random.randint(1000, 2500, 500),        # x_endog: Horas del esposo
-        'huseduc': np.random.randint(8, 20, 500),            # z: Instrumento (Educación del esposo)
-        'lwage': np.random.normal(2.5, 0.5, 500),            # x_exog 1
-        'educ': np.random.randint(8, 20, 500),               # x_exog 2
-        'age': np.random.randint(25, 60, 500)                # x_exog 3
+        'hours': rng.integers(1000, 2500, 500),         # y: Horas trabajadas
+        'hushrs': rng.integers(1000, 2500, 500),        # x_endog: Horas del esposo
+        'huseduc': rng.integers(8, 20, 500),            # z: Instrumento (Educación del esposo)
+        'lwage': rng.normal(2.5, 0.5, 500),             # x_exog 1
+        'educ': rng.integers(8, 20, 500),               # x_exog 2
+        'age': rng.integers(25, 60, 500)                # x_exog 3
     })
 
     engine = CausalInferenceEngine()
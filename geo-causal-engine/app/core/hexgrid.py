@@ -0,0 +1,315 @@
+"""
+Agregación jerárquica en celdas hexagonales H3.
+
+Los promedios por polígono arbitrario no son comparables entre peticiones;
+las celdas H3 sí. Cada capa (estrés, extraversión, responsabilidad...) se
+agrega de abajo arriba:
+
+    píxel -> celda hoja (resolución `leaf`) -> padre -> ... -> resolución `coarsest`
+
+Almacenamiento columnar: por resolución un directorio con `cells.npy`
+(uint64 ordenado) y `<capa>_sum.npy` / `<capa>_count.npy`. Se guardan
+sumas y conteos, no medias, para que el rollup sea exacto. Cada
+construcción escribe un directorio nuevo `.res_XX.<id>/` y lo publica
+cambiando el enlace simbólico `res_XX` con os.replace: un lector ve todas
+las columnas de una versión o todas las de la otra, nunca una mezcla.
+
+Con los ids ordenados, todos los descendientes de una celda a cualquier
+resolución ocupan un rango contiguo: una consulta por región es un
+searchsorted. Padre/hijo se resuelven con operaciones de bits sobre el
+formato de índice H3 (resolución en bits 52-55, dígitos de 3 bits, 7 =
+sin usar); la librería h3 solo se usa para asignar cada píxel a su hoja.
+"""
+
+import os
+import shutil
+import sys
+import uuid
+from typing import Callable, Dict, Iterable, List, Optional, Tuple
+
+import numpy as np
+
+from app.core.raster_io import Window, open_raster, tiles
+from app.core.work_pool import get_pool
+
+MAX_RES = 15
+RES_SHIFT = 52
+RES_MASK = np.uint64(0xF << RES_SHIFT)
+DEFAULT_LEAF, DEFAULT_COARSEST = 9, 3
+
+LeafFn = Callable[[np.ndarray, np.ndarray, int], np.ndarray]
+
+
+# ----------------------------------------------------------------------
+# Índices H3 (vectorizado sobre uint64)
+# ----------------------------------------------------------------------
+def parse_cell(cell: str) -> int:
+    """Id hexadecimal; ValueError si no es hexadecimal o no cabe en 64 bits."""
+    value = int(cell, 16)
+    if not 0 <= value < 1 << 64:
+        raise ValueError(f"Celda H3 fuera del rango de 64 bits: {cell}")
+    return value
+
+
+def format_cell(cell: int) -> str:
+    return format(int(cell), "x")
+
+
+def resolution(cells) -> np.ndarray:
+    return (np.asarray(cells, dtype=np.uint64) >> np.uint64(RES_SHIFT)) & np.uint64(0xF)
+
+
+def _digit_bits(res: int) -> np.uint64:
+    """Máscara de los dígitos por debajo de `res` (res+1 .. 15)."""
+    return np.uint64((1 << (3 * (MAX_RES - res))) - 1)
+
+
+def to_parent(cells: np.ndarray, res: int) -> np.ndarray:
+    """Padre a resolución `res`: se fija el campo de resolución y los dígitos finos pasan a 7."""
+    cells = np.asarray(cells, dtype=np.uint64)
+    return (cells & ~RES_MASK) | np.uint64(res << RES_SHIFT) | _digit_bits(res)
+
+
+def descendant_range(cell: int, res: int) -> Tuple[int, int]:
+    """[lo, hi] de los descendientes de `cell` a resolución `res` en el orden de los ids."""
+    parent_res = int(resolution(cell))
+    if res < parent_res:
+        raise ValueError(f"Resolución {res} más gruesa que la de la celda ({parent_res})")
+    base = (int(cell) & ~int(RES_MASK)) | (res << RES_SHIFT)
+    # Dígitos parent_res+1 .. res: todos 0 (primer hijo) o todos 6 (último)
+    span = ((1 << (3 * (res - parent_res))) - 1) << (3 * (MAX_RES - res))
+    sixes = int("110" * (res - parent_res) or "0", 2) << (3 * (MAX_RES - res))
+    lo = base & ~span
+    return lo, lo | sixes
+
+
+def h3_leaf_cells(lat: np.ndarray, lng: np.ndarray, res: int) -> np.ndarray:
+    """Celda H3 de cada punto (librería h3, una llamada por píxel)."""
+    from h3.api import basic_int as h3
+
+    return np.fromiter((h3.latlng_to_cell(a, b, res) for a, b in zip(lat.ravel(), lng.ravel())),
+                       dtype=np.uint64, count=lat.size)
+
+
+def _reduce_sorted(cells: np.ndarray, sums: np.ndarray, counts: np.ndarray):
+    """Suma filas con el mismo id (cells ya ordenado)."""
+    starts = np.flatnonzero(np.r_[True, cells[1:] != cells[:-1]])
+    return cells[starts], np.add.reduceat(sums, starts, axis=0), np.add.reduceat(counts, starts, axis=0)
+
+
+# ----------------------------------------------------------------------
+# Construcción
+# ----------------------------------------------------------------------
+class HexAggregator:
+    """Capas ráster alineadas (EPSG:4326) -> almacén H3 multirresolución."""
+
+    TILE_ROWS = 256
+
+    def __init__(self, layers: Dict[str, str], leaf: int = DEFAULT_LEAF, coarsest: int = DEFAULT_COARSEST,
+                 leaf_fn: LeafFn = h3_leaf_cells):
+        if not 0 <= coarsest <= leaf <= MAX_RES:
+            raise ValueError(f"Resoluciones inválidas: {coarsest}..{leaf}")
+        self.names = list(layers)
+        self.rasters = [open_raster(path) for path in layers.values()]
+        self.leaf, self.coarsest, self.leaf_fn = leaf, coarsest, leaf_fn
+        first = self.rasters[0]
+        self.shape, self.transform = first.shape, first.transform
+        for raster in self.rasters:
+            if raster.shape != self.shape or raster.transform != self.transform:
+                raise ValueError(f"{raster.path} no está alineada con {first.path}")
+            if raster.crs not in (None, "EPSG:4326"):
+                raise ValueError(f"{raster.path}: se esperaba EPSG:4326, no {raster.crs}")
+
+    def close(self) -> None:
+        for raster in self.rasters:
+            raster.close()
+
+    def _tile(self, window: Window):
+        t = self.transform
+        lat = t.y0 + (np.arange(window.row, window.row + window.height) + 0.5) * t.dy
+        lng = t.x0 + (np.arange(window.col, window.col + window.width) + 0.5) * t.dx
+        lat, lng = np.meshgrid(lat, lng, indexing="ij")
+        cells = self.leaf_fn(lat, lng, self.leaf)
+
+        values = np.stack([r.read(window).ravel().astype(np.float64) for r in self.rasters], axis=1)
+        for j, raster in enumerate(self.rasters):
+            if raster.nodata is not None:
+                values[values[:, j] == raster.nodata, j] = np.nan
+        valid = ~np.isnan(values)
+        values[~valid] = 0.0
+
+        order = np.argsort(cells, kind="stable")
+        return _reduce_sorted(cells[order], values[order], valid[order].astype(np.int64))
+
+    def build(self) -> Dict[int, dict]:
+        parts = get_pool().map(self._tile, tiles(self.shape, self.TILE_ROWS))
+        cells = np.concatenate([p[0] for p in parts])
+        order = np.argsort(cells, kind="stable")
+        cells, sums, counts = _reduce_sorted(
+            cells[order], np.concatenate([p[1] for p in parts])[order], np.concatenate([p[2] for p in parts])[order]
+        )
+        levels = {self.leaf: (cells, sums, counts)}
+        # Rollup: el orden de los hijos se conserva en los padres, así que no hace falta reordenar
+        for res in range(self.leaf - 1, self.coarsest - 1, -1):
+            levels[res] = _reduce_sorted(to_parent(cells, res), sums, counts)
+            cells, sums, counts = levels[res]
+        return {
+            res: {"cells": c, **{f"{n}_sum": s[:, j] for j, n in enumerate(self.names)},
+                  **{f"{n}_count": k[:, j] for j, n in enumerate(self.names)}}
+            for res, (c, s, k) in levels.items()
+        }
+
+
+def write_store(levels: Dict[int, dict], out_dir: str) -> None:
+    os.makedirs(out_dir, exist_ok=True)
+    for res, columns in levels.items():
+        version = f".res_{res:02d}.{uuid.uuid4().hex[:12]}"
+        os.makedirs(os.path.join(out_dir, version))
+        for name, column in columns.items():
+            np.save(os.path.join(out_dir, version, f"{name}.npy"), column)
+        _publish(out_dir, f"res_{res:02d}", version)
+
+
+def _publish(out_dir: str, name: str, version: str) -> None:
+    """Apunta `name` a `version` de una vez y borra las versiones anteriores."""
+    link = os.path.join(out_dir, name)
+    if os.path.isdir(link) and not os.path.islink(link):
+        # Almacén del formato anterior (directorio real): se aparta una vez
+        os.rename(link, os.path.join(out_dir, f".{name}.legacy"))
+    tmp = os.path.join(out_dir, f".{name}.link.tmp")
+    if os.path.lexists(tmp):
+        os.remove(tmp)
+    os.symlink(version, tmp)
+    os.replace(tmp, link)
+    for entry in os.listdir(out_dir):
+        if entry.startswith(f".{name}.") and entry != version and not entry.endswith(".tmp"):
+            # Un lector que ya tenga las columnas en mmap las conserva (el inodo sigue vivo)
+            shutil.rmtree(os.path.join(out_dir, entry), ignore_errors=True)
+
+
+def build_store(layers: Dict[str, str], out_dir: str, leaf: int = DEFAULT_LEAF,
+                coarsest: int = DEFAULT_COARSEST, leaf_fn: LeafFn = h3_leaf_cells) -> dict:
+    aggregator = HexAggregator(layers, leaf, coarsest, leaf_fn)
+    try:
+        levels = aggregator.build()
+    finally:
+        aggregator.close()
+    write_store(levels, out_dir)
+    return {"layers": list(layers), "cells": {res: int(cols["cells"].size) for res, cols in sorted(levels.items())}}
+
+
+# ----------------------------------------------------------------------
+# Consulta
+# ----------------------------------------------------------------------
+class HexStore:
+    """
+    Lectura del almacén: columnas en memoria mapeada, consultas por rango de ids.
+
+    Cada resolución se reabre solo cuando su enlace `res_XX` apunta a otra
+    versión, así que una reconstrucción se sirve sin reiniciar. Las columnas
+    de una versión se cargan juntas y no cambian una vez publicadas: cada
+    llamada a level() devuelve una versión completa.
+    """
+
+    parse_cell = staticmethod(parse_cell)  # main lo usa sin importar el módulo (carga perezosa)
+
+    def __init__(self, directory: str):
+        self.directory = directory
+        self._levels: Dict[int, Tuple[tuple, Dict[str, np.ndarray]]] = {}
+
+    def resolutions(self) -> List[int]:
+        if not os.path.isdir(self.directory):
+            return []
+        return sorted(int(d[4:]) for d in os.listdir(self.directory) if d.startswith("res_"))
+
+    @staticmethod
+    def _signature(directory: str) -> tuple:
+        names = sorted(f for f in os.listdir(directory) if f.endswith(".npy") and not f.startswith("."))
+        stats = [os.stat(os.path.join(directory, f)) for f in names]
+        return tuple((f, st.st_ino, st.st_mtime_ns, st.st_size) for f, st in zip(names, stats))
+
+    def level(self, res: int) -> Dict[str, np.ndarray]:
+        link = os.path.join(self.directory, f"res_{res:02d}")
+        for _ in range(3):
+            if not os.path.isdir(link):
+                self._levels.pop(res, None)
+                raise KeyError(f"Resolución {res} no disponible")
+            # Versión publicada; un directorio real es un almacén del formato anterior
+            pointer = os.readlink(link) if os.path.islink(link) else self._signature(link)
+            cached = self._levels.get(res)
+            if cached is not None and cached[0] == pointer:
+                return cached[1]
+            directory = os.path.join(self.directory, pointer) if isinstance(pointer, str) else link
+            try:
+                columns = {f[:-4]: np.load(os.path.join(directory, f), mmap_mode="r")
+                           for f in os.listdir(directory) if f.endswith(".npy") and not f.startswith(".")}
+            except FileNotFoundError:
+                continue  # otra reconstrucción la retiró entre readlink y la carga: se relee el enlace
+            self._levels[res] = (pointer, columns)
+            return columns
+        raise KeyError(f"Resolución {res} en reconstrucción, reintenta")
+
+    def layers(self, res: int) -> List[str]:
+        return _layers(self.level(res))
+
+    def scan(self, res: int, parent: Optional[int] = None) -> slice:
+        """Filas de la resolución `res` (todas, o solo las que descienden de `parent`)."""
+        return _scan(self.level(res), res, parent)
+
+    def rows(self, rows: slice, res: int) -> List[dict]:
+        return _rows(self.level(res), rows)
+
+    def cell(self, cell: int) -> Optional[dict]:
+        """Agregados de la celda; None si no hay datos (tampoco si su resolución no está en el almacén)."""
+        res = int(resolution(cell))
+        try:
+            columns = self.level(res)
+        except KeyError:
+            return None
+        rows = _scan(columns, res, cell)
+        return _rows(columns, rows)[0] if rows.stop > rows.start else None
+
+    def children(self, cell: int, res: int, limit: int = 1000) -> List[dict]:
+        columns = self.level(res)
+        rows = _scan(columns, res, cell)
+        return _rows(columns, slice(rows.start, min(rows.stop, rows.start + limit)))
+
+
+def _layers(columns: Dict[str, np.ndarray]) -> List[str]:
+    return sorted(name[:-4] for name in columns if name.endswith("_sum"))
+
+
+def _scan(columns: Dict[str, np.ndarray], res: int, parent: Optional[int]) -> slice:
+    cells = columns["cells"]
+    if parent is None:
+        return slice(0, cells.size)
+    lo, hi = descendant_range(parent, res)
+    return slice(int(np.searchsorted(cells, np.uint64(lo), "left")),
+                 int(np.searchsorted(cells, np.uint64(hi), "right")))
+
+
+def _rows(columns: Dict[str, np.ndarray], rows: slice) -> List[dict]:
+    layers = _layers(columns)
+    out = []
+    for i in range(rows.start, rows.stop):
+        row = {"cell": format_cell(columns["cells"][i])}
+        for layer in layers:
+            count = int(columns[f"{layer}_count"][i])
+            row[layer] = round(float(columns[f"{layer}_sum"][i]) / count, 6) if count else None
+            row[f"{layer}_pixels"] = count
+        out.append(row)
+    return out
+
+
+store = HexStore(os.getenv("GEO_HEX_DIR", "/data/hex"))
+
+
+def _parse_layers(args: Iterable[str]) -> Dict[str, str]:
+    return dict(arg.split("=", 1) for arg in args)
+
+
+if __name__ == "__main__":
+    # python -m app.core.hexgrid <out_dir> <leaf> <coarsest> stress=stress.npy extraversion=e.npy ...
+    if len(sys.argv) < 5:
+        sys.exit(__doc__)
+    print(build_store(_parse_layers(sys.argv[4:]), sys.argv[1], int(sys.argv[2]), int(sys.argv[3])))
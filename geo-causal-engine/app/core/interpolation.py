@@ -0,0 +1,233 @@
+"""
+Interpolación espacial de agregados Big Five desde puntos de encuesta.
+
+Dos métodos sobre vecindarios locales del KD-tree (k vecinos por celda):
+
+- kriging ordinario con variograma ajustado automáticamente
+  (esférico / exponencial / gaussiano, mínimos cuadrados ponderados por
+  número de pares). Devuelve la predicción y la varianza de kriging.
+- IDW (potencia `power`); como varianza devuelve la dispersión ponderada
+  de los vecinos alrededor de la predicción.
+
+La rejilla se recorre por teselas en el pool compartido; dentro de cada
+tesela las celdas se agrupan en bloques de BLOCK×BLOCK (lotes coherentes
+para el KD-tree) y los sistemas de kriging de todo el bloque se resuelven
+con una sola llamada batched a LAPACK. Las coordenadas se tratan como
+planas: la rejilla y los puntos deben estar en un CRS proyectado.
+"""
+
+import csv
+import os
+import sys
+from dataclasses import dataclass
+from typing import Callable, Dict, Optional, Tuple
+
+import numpy as np
+
+from app.core import rng as rng_streams
+from app.core.raster_io import GeoTransform, Window, create_raster, tiles
+from app.core.spatial_index import KDTree
+from app.core.work_pool import get_pool
+
+
+def _spherical(h: np.ndarray, r: float) -> np.ndarray:
+    x = np.minimum(h / r, 1.0)
+    return 1.5 * x - 0.5 * x ** 3
+
+
+def _exponential(h: np.ndarray, r: float) -> np.ndarray:
+    return 1.0 - np.exp(-3.0 * h / r)
+
+
+def _gaussian(h: np.ndarray, r: float) -> np.ndarray:
+    return 1.0 - np.exp(-3.0 * (h / r) ** 2)
+
+
+MODELS: Dict[str, Callable[[np.ndarray, float], np.ndarray]] = {
+    "spherical": _spherical,
+    "exponential": _exponential,
+    "gaussian": _gaussian,
+}
+
+
+@dataclass(frozen=True)
+class Variogram:
+    model: str
+    nugget: float
+    psill: float
+    range: float
+
+    def __call__(self, h: np.ndarray) -> np.ndarray:
+        gamma = self.nugget + self.psill * MODELS[self.model](h, self.range)
+        return np.where(h > 0, gamma, 0.0)
+
+    def to_dict(self) -> dict:
+        return {"model": self.model, "nugget": self.nugget, "psill": self.psill, "range": self.range}
+
+
+def empirical_variogram(xy: np.ndarray, z: np.ndarray, bins: int = 20, sample: int = 2000,
+                        tree: Optional[KDTree] = None, job: str = "variogram") -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Semivarianza por clases de distancia hasta la mitad de la diagonal.
+
+    Pares de una submuestra reproducible para las distancias largas, más los
+    pares submuestra-vecinos del árbol para las cortas (la pepita y el tramo
+    inicial son los que pesan en el kriging local). Clases cuadráticas: más
+    finas cerca del origen.
+    """
+    pick = np.arange(xy.shape[0])
+    if xy.shape[0] > sample:
+        pick = rng_streams.stream(job).choice(xy.shape[0], sample, replace=False)
+    i, j = np.triu_indices(pick.size, k=1)
+    i, j = pick[i], pick[j]
+    if tree is not None:
+        near = tree.query(xy[pick], min(9, xy.shape[0]))[1][:, 1:]
+        i = np.concatenate([i, np.repeat(pick, near.shape[1])])
+        j = np.concatenate([j, near.ravel()])
+    h = np.hypot(*(xy[i] - xy[j]).T)
+    semi = 0.5 * (z[i] - z[j]) ** 2
+    max_lag = 0.5 * np.hypot(*np.ptp(xy, axis=0))
+    edges = max_lag * np.linspace(0.0, 1.0, bins + 1) ** 2
+    which = np.digitize(h, edges) - 1
+    inside = (which >= 0) & (which < bins)
+    counts = np.bincount(which[inside], minlength=bins)
+    gamma = np.bincount(which[inside], weights=semi[inside], minlength=bins)
+    lags = np.bincount(which[inside], weights=h[inside], minlength=bins)
+    used = counts > 0
+    return lags[used] / counts[used], gamma[used] / counts[used], counts[used]
+
+
+def fit_variogram(xy: np.ndarray, z: np.ndarray, tree: Optional[KDTree] = None) -> Variogram:
+    """
+    Mejor (modelo, rango) por rejilla; pepita y meseta parcial por mínimos
+    cuadrados no negativos con pesos N_j / h_j² (como gstat, fit.method=7):
+    el tramo corto, el que usa el kriging local, manda.
+    """
+    lags, gamma, counts = empirical_variogram(xy, z, tree=tree)
+    if lags.size < 3:
+        return Variogram("exponential", 0.0, float(np.var(z)) or 1e-12, float(np.ptp(xy, axis=0).max()) or 1.0)
+    w = np.sqrt(counts.astype(np.float64)) / np.maximum(lags, lags[lags > 0].min(initial=1.0))
+    best, best_sse = None, np.inf
+    for name, fn in MODELS.items():
+        for r in np.geomspace(max(lags[0], 1e-12), lags[-1] * 1.5, 80):
+            f = fn(lags, r)
+            A = np.stack([np.ones_like(f), f], axis=1) * w[:, None]
+            nugget, psill = np.linalg.lstsq(A, gamma * w, rcond=None)[0]
+            if nugget < 0:
+                nugget, psill = 0.0, float((f * w) @ (gamma * w) / ((f * w) @ (f * w)))
+            if psill <= 0:
+                continue
+            sse = float(((A @ [nugget, psill]) - gamma * w) @ ((A @ [nugget, psill]) - gamma * w))
+            if sse < best_sse:
+                # Pepita mínima: sin ella el modelo gaussiano deja sistemas casi singulares
+                best, best_sse = Variogram(name, max(float(nugget), 1e-4 * psill), float(psill), float(r)), sse
+    return best or Variogram("exponential", 0.0, float(np.var(z)) or 1e-12, float(lags[-1]))
+
+
+class SpatialInterpolator:
+    TILE = 256
+    BLOCK = 16
+
+    def __init__(self, xy: np.ndarray, z: np.ndarray, method: str = "kriging", k: int = 16,
+                 power: float = 2.0, variogram: Optional[Variogram] = None):
+        if method not in ("kriging", "idw"):
+            raise ValueError(f"Método desconocido: {method}")
+        xy = np.asarray(xy, dtype=np.float64)
+        z = np.asarray(z, dtype=np.float64)
+        keep = np.isfinite(z) & np.isfinite(xy).all(axis=1)
+        # Puntos repetidos en la misma coordenada: se promedian (si no, el sistema de kriging es singular)
+        self.xy, inverse = np.unique(xy[keep], axis=0, return_inverse=True)
+        inverse = inverse.ravel()
+        self.z = np.bincount(inverse, weights=z[keep]) / np.bincount(inverse)
+        if self.xy.shape[0] < 2:
+            raise ValueError("Se necesitan al menos 2 puntos de encuesta distintos")
+        self.method, self.power = method, power
+        self.k = min(k, self.xy.shape[0])
+        self.tree = KDTree(self.xy)
+        self.variogram = (variogram or fit_variogram(self.xy, self.z, self.tree)) if method == "kriging" else None
+
+    def _solve(self, dist: np.ndarray, idx: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+        values = self.z[idx]
+        if self.method == "idw":
+            exact = dist[:, 0] == 0
+            w = 1.0 / np.maximum(dist, 1e-300) ** self.power
+            w /= w.sum(axis=1, keepdims=True)
+            pred = (w * values).sum(axis=1)
+            var = (w * (values - pred[:, None]) ** 2).sum(axis=1)
+            pred[exact], var[exact] = values[exact, 0], 0.0
+            return pred, var
+
+        q, k = idx.shape
+        pts = self.xy[idx]
+        pair = np.hypot(pts[:, :, None, 0] - pts[:, None, :, 0], pts[:, :, None, 1] - pts[:, None, :, 1])
+        A = np.ones((q, k + 1, k + 1))
+        A[:, :k, :k] = self.variogram(pair)
+        A[:, k, k] = 0.0
+        b = np.ones((q, k + 1))
+        b[:, :k] = self.variogram(dist)
+        sol = np.linalg.solve(A, b[:, :, None])[:, :, 0]
+        weights, mu = sol[:, :k], sol[:, k]
+        pred = (weights * values).sum(axis=1)
+        var = (weights * b[:, :k]).sum(axis=1) + mu
+        return pred, np.maximum(var, 0.0)
+
+    def predict(self, points: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+        dist, idx = self.tree.query(points, self.k)
+        return self._solve(dist, idx)
+
+    def _block(self, transform: GeoTransform, window: Window) -> Tuple[np.ndarray, np.ndarray]:
+        t = transform
+        ys = t.y0 + (np.arange(window.row, window.row + window.height) + 0.5) * t.dy
+        xs = t.x0 + (np.arange(window.col, window.col + window.width) + 0.5) * t.dx
+        gy, gx = np.meshgrid(ys, xs, indexing="ij")
+        dist, idx = self.tree.query_batch(np.stack([gx.ravel(), gy.ravel()], axis=1), self.k)
+        pred, var = self._solve(dist, idx)
+        return pred.reshape(gy.shape), var.reshape(gy.shape)
+
+    def predict_grid(self, shape: Tuple[int, int], transform: GeoTransform, out_dir: str,
+                     crs: Optional[str] = None) -> dict:
+        """Predicción y varianza sobre una rejilla, escritas tesela a tesela en out_dir."""
+        os.makedirs(out_dir, exist_ok=True)
+        writers = {name: create_raster(os.path.join(out_dir, f"{name}.npy"), shape, np.float32, transform, crs)
+                   for name in ("prediction", "variance")}
+
+        def run_tile(window: Window) -> None:
+            pred = np.empty((window.height, window.width), dtype=np.float32)
+            var = np.empty_like(pred)
+            for block in tiles((window.height, window.width), self.BLOCK, self.BLOCK):
+                absolute = Window(window.row + block.row, window.col + block.col, block.height, block.width)
+                pred[block.slices], var[block.slices] = self._block(transform, absolute)
+            writers["prediction"].write(window, pred)
+            writers["variance"].write(window, var)
+
+        try:
+            get_pool().map(run_tile, tiles(shape, self.TILE, self.TILE))
+        finally:
+            for writer in writers.values():
+                writer.close()
+        return {
+            "method": self.method,
+            "points": int(self.xy.shape[0]),
+            "neighbors": self.k,
+            "cells": shape[0] * shape[1],
+            "variogram": self.variogram.to_dict() if self.variogram else None,
+            "outputs": {name: writer.path for name, writer in writers.items()},
+        }
+
+
+def read_points(path: str, value: str) -> Tuple[np.ndarray, np.ndarray]:
+    """CSV con columnas x, y y la variable a interpolar."""
+    with open(path, newline="") as f:
+        rows = [(float(r["x"]), float(r["y"]), float(r[value])) for r in csv.DictReader(f) if r[value] != ""]
+    data = np.array(rows).reshape(-1, 3)
+    return data[:, :2], data[:, 2]
+
+
+if __name__ == "__main__":
+    # python -m app.core.interpolation puntos.csv extraversion out_dir filas columnas x0 dx y0 dy [kriging|idw]
+    if len(sys.argv) < 10:
+        sys.exit(__doc__)
+    xy, z = read_points(sys.argv[1], sys.argv[2])
+    grid = GeoTransform(*map(float, sys.argv[6:10]))
+    method = sys.argv[10] if len(sys.argv) > 10 else "kriging"
+    print(SpatialInterpolator(xy, z, method).predict_grid((int(sys.argv[4]), int(sys.argv[5])), grid, sys.argv[3]))
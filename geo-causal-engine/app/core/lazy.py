@@ -0,0 +1,58 @@
+import importlib
+import threading
+import time
+from typing import Any, Callable, Dict, List, Optional
+
+
+class LazyEngine:
+    """
+    Referencia perezosa a un objeto de un módulo pesado (numpy, pandas,
+    linearmodels, rasterio...). El import ocurre en el primer uso real, no al
+    arrancar el contenedor: /health responde sin cargar ningún motor.
+    """
+
+    def __init__(self, module: str, attr: str, on_load: Optional[Callable[[Any], None]] = None):
+        self.module = module
+        self.attr = attr
+        self.on_load = on_load
+        self.load_seconds: Optional[float] = None
+        self._value: Any = None
+        self._lock = threading.Lock()
+        _REGISTERED.append(self)
+
+    @property
+    def loaded(self) -> bool:
+        return self._value is not None
+
+    def get(self) -> Any:
+        if self._value is None:
+            with self._lock:
+                if self._value is None:
+                    start = time.perf_counter()
+                    value = getattr(importlib.import_module(self.module), self.attr)
+                    if self.on_load is not None:
+                        self.on_load(value)
+                    self.load_seconds = time.perf_counter() - start
+                    self._value = value
+        return self._value
+
+
+_REGISTERED: List[LazyEngine] = []
+
+
+def preload_all() -> Dict[str, float]:
+    """
+    Ruta pre-calentada: carga todos los motores registrados de una vez.
+    Pensada para ejecutarse antes de tomar un snapshot del proceso o durante
+    el arranque cuando GEO_PREWARM=1.
+    """
+    return {f"{e.module}.{e.attr}": round(_timed_get(e), 4) for e in _REGISTERED}
+
+
+def _timed_get(engine: LazyEngine) -> float:
+    engine.get()
+    return engine.load_seconds or 0.0
+
+
+def status() -> Dict[str, bool]:
+    return {f"{e.module}.{e.attr}": e.loaded for e in _REGISTERED}
@@ -0,0 +1,174 @@
+"""
+Registro de modelos: conjuntos de parámetros versionados con recarga en caliente.
+
+Estructura en disco (MODEL_REGISTRY_DIR, por defecto ./model_registry):
+
+    political/
+        ACTIVE              <- fichero de texto con la versión a servir
+        2026-10-01.json     <- {"NATION_STRESS_WEIGHT": 0.45, ...}
+
+Un hilo vigilante construye el motor nuevo fuera del camino de la petición y
+lo publica con una única asignación de referencia (estilo RCU): las peticiones
+que ya tienen la versión anterior la siguen usando hasta terminar, y esa
+versión solo se descarta cuando sus peticiones en vuelo llegan a cero.
+"""
+
+import json
+import logging
+import os
+import threading
+from contextlib import contextmanager
+from typing import Any, Callable, Dict, Iterator, List, Optional
+
+logger = logging.getLogger(__name__)
+
+BUILTIN_VERSION = "builtin"
+REGISTRY_DIR = os.getenv("MODEL_REGISTRY_DIR", "./model_registry")
+POLL_SECONDS = float(os.getenv("MODEL_REGISTRY_POLL_SECONDS", "5"))
+
+
+class ModelVersion:
+    """Motor inmutable más el número de peticiones que lo están usando"""
+
+    def __init__(self, version: str, engine: Any):
+        self.version = version
+        self.engine = engine
+        self._in_flight = 0
+        self._lock = threading.Lock()
+
+    @property
+    def in_flight(self) -> int:
+        return self._in_flight
+
+    def acquire(self) -> None:
+        with self._lock:
+            self._in_flight += 1
+
+    def release(self) -> None:
+        with self._lock:
+            self._in_flight -= 1
+
+
+class ModelRegistry:
+    """
+    Sirve una familia de motores (p.ej. "political") desde ficheros versionados.
+
+    factory(params, version) debe devolver un motor ya inicializado; se ejecuta
+    en el hilo vigilante, nunca en el camino de la petición.
+    """
+
+    def __init__(self, name: str, factory: Callable[[Dict[str, Any], str], Any],
+                 directory: str = REGISTRY_DIR):
+        self.name = name
+        self.factory = factory
+        self.directory = os.path.join(directory, name)
+        self._current = ModelVersion(BUILTIN_VERSION, factory({}, BUILTIN_VERSION))
+        self._retired: List[ModelVersion] = []
+        self._swap_lock = threading.Lock()
+        self._watcher: Optional[threading.Thread] = None
+        self._failed: Optional[tuple] = None  # (versión, firma del fichero) de la última carga fallida
+        self._stop = threading.Event()
+
+    # ------------------------------------------------------------------
+    # Lectura (sin candados: una sola lectura de atributo)
+    # ------------------------------------------------------------------
+    @property
+    def current(self) -> ModelVersion:
+        return self._current
+
+    @contextmanager
+    def lease(self) -> Iterator[ModelVersion]:
+        """Fija la versión actual durante toda la petición"""
+        model = self._current
+        model.acquire()
+        try:
+            yield model
+        finally:
+            model.release()
+
+    # ------------------------------------------------------------------
+    # Escritura
+    # ------------------------------------------------------------------
+    def load(self, version: str) -> ModelVersion:
+        """Construye una versión desde disco y la publica de forma atómica"""
+        if version == BUILTIN_VERSION:
+            params: Dict[str, Any] = {}
+        else:
+            with open(os.path.join(self.directory, f"{version}.json")) as f:
+                params = json.load(f)
+
+        candidate = ModelVersion(version, self.factory(params, version))
+
+        with self._swap_lock:
+            previous = self._current
+            if previous.version == version:
+                return previous
+            self._current = candidate
+            self._retired.append(previous)
+            self._drain()
+
+        logger.info("Modelo %s cambiado %s -> %s", self.name, previous.version, version)
+        return candidate
+
+    def active_version_on_disk(self) -> str:
+        try:
+            with open(os.path.join(self.directory, "ACTIVE")) as f:
+                return f.read().strip() or BUILTIN_VERSION
+        except FileNotFoundError:
+            return BUILTIN_VERSION
+
+    def status(self) -> Dict[str, Any]:
+        return {
+            "model": self.name,
+            "version": self._current.version,
+            "in_flight": self._current.in_flight,
+            "draining": {m.version: m.in_flight for m in self._retired},
+        }
+
+    def _file_signature(self, version: str) -> Optional[tuple]:
+        """(mtime, tamaño) del fichero de la versión; None si no existe"""
+        if version == BUILTIN_VERSION:
+            return None
+        try:
+            st = os.stat(os.path.join(self.directory, f"{version}.json"))
+        except OSError:
+            return None
+        return st.st_mtime_ns, st.st_size
+
+    def _drain(self) -> None:
+        """Olvida las versiones retiradas cuando ninguna petición las retiene"""
+        self._retired = [m for m in self._retired if m.in_flight > 0]
+
+    # ------------------------------------------------------------------
+    # Vigilante en segundo plano
+    # ------------------------------------------------------------------
+    def start_watcher(self, poll_seconds: float = POLL_SECONDS) -> None:
+        if self._watcher is not None:
+            return
+        self._poll_once()
+        self._watcher = threading.Thread(
+            target=self._watch, args=(poll_seconds,), name=f"{self.name}-registry", daemon=True
+        )
+        self._watcher.start()
+
+    def stop_watcher(self) -> None:
+        self._stop.set()
+
+    def _watch(self, poll_seconds: float) -> None:
+        while not self._stop.wait(poll_seconds):
+            self._poll_once()
+
+    def _poll_once(self) -> None:
+        try:
+            wanted = self.active_version_on_disk()
+            # Una versión fallida se reintenta en cuanto su fichero cambia (o aparece)
+            attempt = (wanted, self._file_signature(wanted))
+            if wanted != self._current.version and attempt != self._failed:
+                self._failed = attempt
+                self.load(wanted)
+                self._failed = None
+            with self._swap_lock:
+                self._drain()
+        except Exception:
+            # Un fichero de parámetros roto nunca debe tumbar la versión en servicio
+            logger.exception("Recarga del modelo %s fallida; se mantiene %s", self.name, self._current.version)
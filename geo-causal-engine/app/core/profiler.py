@@ -0,0 +1,179 @@
+"""
+Perfilador por muestreo bajo demanda.
+
+En reposo no cuesta nada: no hay hilo, hook ni sys.setprofile activos. Una
+petición a /admin/profile arranca un muestreo acotado en el tiempo y devuelve
+las pilas en formato colapsado ("a;b;c N", compatible con flamegraph.pl y
+speedscope) o un flamegraph SVG autocontenido.
+
+Dos backends:
+- "native": py-spy --native sobre el propio PID. Ve también los frames de las
+  extensiones compiladas (BLAS, numpy, linearmodels). Requiere el binario
+  py-spy y CAP_SYS_PTRACE en el contenedor. py-spy detiene el proceso en cada
+  muestra: no admite --native junto con --nonblocking.
+- "python": hilo que lee sys._current_frames() a la frecuencia pedida. Solo
+  ve frames de Python, pero funciona en cualquier entorno.
+"auto" intenta native y cae a python si py-spy no está disponible.
+"""
+
+import hmac
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import zlib
+from collections import Counter
+from html import escape
+from typing import Dict, Optional, Tuple
+
+ADMIN_TOKEN = os.getenv("PROFILER_TOKEN") or None
+MAX_SECONDS = 60.0
+MAX_HZ = 1000
+
+_busy = threading.Lock()
+
+
+class ProfilerBusy(RuntimeError):
+    pass
+
+
+def check_token(token: Optional[str]) -> bool:
+    """Comparación en tiempo constante; sin PROFILER_TOKEN el endpoint queda desactivado"""
+    if ADMIN_TOKEN is None or token is None:
+        return False
+    return hmac.compare_digest(token.encode(), ADMIN_TOKEN.encode())
+
+
+# ----------------------------------------------------------------------
+# Backend python: sys._current_frames()
+# ----------------------------------------------------------------------
+def _sample_python(seconds: float, hz: int) -> Counter:
+    stacks: Counter = Counter()
+    labels: Dict[object, str] = {}
+    me = threading.get_ident()
+    names = {t.ident: t.name for t in threading.enumerate()}
+    interval = 1.0 / hz
+    deadline = time.perf_counter() + seconds
+    next_tick = time.perf_counter()
+
+    while next_tick < deadline:
+        for ident, frame in sys._current_frames().items():
+            if ident == me:
+                continue
+            stack = []
+            while frame is not None:
+                code = frame.f_code
+                label = labels.get(code)
+                if label is None:
+                    label = f"{code.co_name} ({os.path.basename(code.co_filename)}:{code.co_firstlineno})"
+                    labels[code] = label
+                stack.append(label)
+                frame = frame.f_back
+            if ident not in names:
+                names = {t.ident: t.name for t in threading.enumerate()}
+            stack.append(names.get(ident, str(ident)))
+            stacks[";".join(reversed(stack))] += 1
+        next_tick += interval
+        pause = next_tick - time.perf_counter()
+        if pause > 0:
+            time.sleep(pause)
+    return stacks
+
+
+# ----------------------------------------------------------------------
+# Backend native: py-spy
+# ----------------------------------------------------------------------
+def native_available() -> bool:
+    return shutil.which("py-spy") is not None
+
+
+def _sample_native(seconds: float, hz: int) -> Counter:
+    with tempfile.TemporaryDirectory() as scratch:
+        out = os.path.join(scratch, "profile.txt")
+        subprocess.run(
+            ["py-spy", "record", "--pid", str(os.getpid()), "--duration", str(max(1, round(seconds))),
+             "--rate", str(hz), "--format", "raw", "--native", "--threads",
+             "--output", out],
+            check=True, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, timeout=seconds + 30,
+        )
+        stacks: Counter = Counter()
+        with open(out) as f:
+            for line in f:
+                stack, _, count = line.rstrip("\n").rpartition(" ")
+                if stack:
+                    stacks[stack] += int(count)
+        return stacks
+
+
+def profile(seconds: float = 10.0, hz: int = 100, mode: str = "auto") -> Tuple[Counter, str]:
+    """Muestrea el proceso durante `seconds`; devuelve (pilas, backend usado)"""
+    seconds = min(max(seconds, 0.1), MAX_SECONDS)
+    hz = min(max(hz, 1), MAX_HZ)
+    if not _busy.acquire(blocking=False):
+        raise ProfilerBusy("Ya hay un perfil en curso")
+    try:
+        if mode in ("auto", "native") and native_available():
+            try:
+                return _sample_native(seconds, hz), "native"
+            except (subprocess.SubprocessError, OSError) as e:
+                if mode == "native":
+                    raise RuntimeError(f"py-spy falló: {e}") from e
+        elif mode == "native":
+            raise RuntimeError("py-spy no está instalado")
+        return _sample_python(seconds, hz), "python"
+    finally:
+        _busy.release()
+
+
+# ----------------------------------------------------------------------
+# Salida
+# ----------------------------------------------------------------------
+def collapsed(stacks: Counter) -> str:
+    return "".join(f"{stack} {count}\n" for stack, count in sorted(stacks.items()))
+
+
+def flamegraph_svg(stacks: Counter, title: str = "Perfil", width: int = 1200) -> str:
+    """Flamegraph SVG mínimo (raíz abajo), sin dependencias externas"""
+    root: dict = {"n": 0, "c": {}}
+    for stack, count in stacks.items():
+        node = root
+        node["n"] += count
+        for frame in stack.split(";"):
+            node = node["c"].setdefault(frame, {"n": 0, "c": {}})
+            node["n"] += count
+
+    def depth(node) -> int:
+        return 1 + max((depth(c) for c in node["c"].values()), default=0)
+
+    row = 16
+    total = max(root["n"], 1)
+    height = (depth(root) + 1) * row + 24
+    rects = []
+
+    def draw(name: str, node: dict, x: float, level: int) -> None:
+        w = node["n"] / total * width
+        if w < 0.5:
+            return
+        y = height - (level + 1) * row
+        hue = 20 + zlib.crc32(name.encode()) % 40
+        label = escape(name)
+        text = escape(name[: int(w / 7)]) if w > 21 else ""
+        rects.append(
+            f'<g><title>{label} ({node["n"]} muestras, {100 * node["n"] / total:.1f}%)</title>'
+            f'<rect x="{x:.1f}" y="{y}" width="{w:.1f}" height="{row - 1}" fill="hsl({hue},90%,60%)"/>'
+            f'<text x="{x + 3:.1f}" y="{y + row - 4}">{text}</text></g>'
+        )
+        for child_name, child in sorted(node["c"].items()):
+            draw(child_name, child, x, level + 1)
+            x += child["n"] / total * width
+
+    draw("all", root, 0.0, 0)
+    return (
+        f'<svg xmlns="http://www.w3.org/2000/svg" width="{width}" height="{height}" '
+        f'font-family="monospace" font-size="11">'
+        f'<text x="4" y="14">{escape(title)} - {root["n"]} muestras</text>'
+        + "".join(rects) + "</svg>"
+    )
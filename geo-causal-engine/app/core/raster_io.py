@@ -0,0 +1,223 @@
+"""
+Lectura y escritura de rásters por ventanas.
+
+Los motores nunca cargan una escena completa: piden ventanas (bloques de
+filas o teselas) y escriben el resultado bloque a bloque. Dos backends:
+
+- GeoTIFF/COG con el lector por bloques de app/core/cog.py (caché de
+  bloques compartida, local o por HTTP); rasterio (import perezoso) para
+  lo que ese lector no cubre (LZW, JPEG, rotaciones...).
+- .npy en memoria mapeada con un sidecar .json (transform, crs, nodata):
+  formato de intercambio local y el que usan los laboratorios.
+"""
+
+import json
+import os
+from dataclasses import dataclass
+from typing import Iterator, NamedTuple, Optional, Tuple
+
+import numpy as np
+
+
+class Window(NamedTuple):
+    row: int
+    col: int
+    height: int
+    width: int
+
+    @property
+    def slices(self) -> Tuple[slice, slice]:
+        return slice(self.row, self.row + self.height), slice(self.col, self.col + self.width)
+
+
+@dataclass(frozen=True)
+class GeoTransform:
+    """Afín sin rotación: x = x0 + col*dx, y = y0 + row*dy (dy < 0 en rásters norte-arriba)."""
+    x0: float = 0.0
+    dx: float = 1.0
+    y0: float = 0.0
+    dy: float = -1.0
+
+    def to_list(self) -> list:
+        return [self.x0, self.dx, self.y0, self.dy]
+
+    @classmethod
+    def from_list(cls, values) -> "GeoTransform":
+        return cls(*map(float, values))
+
+    def window_transform(self, window: Window) -> "GeoTransform":
+        return GeoTransform(self.x0 + window.col * self.dx, self.dx, self.y0 + window.row * self.dy, self.dy)
+
+
+def tiles(shape: Tuple[int, int], rows: int, cols: Optional[int] = None) -> Iterator[Window]:
+    """Ventanas que cubren `shape` por bloques de `rows` filas (y `cols` columnas si se indica)."""
+    height, width = shape
+    cols = cols or width
+    for row in range(0, height, rows):
+        for col in range(0, width, cols):
+            yield Window(row, col, min(rows, height - row), min(cols, width - col))
+
+
+class NpyRaster:
+    """Ráster .npy de una banda en memoria mapeada: leer una ventana no copia la escena."""
+
+    def __init__(self, path: str):
+        self.path = path
+        self._data = np.load(path, mmap_mode="r")
+        if self._data.ndim != 2:
+            raise ValueError(f"{path}: se esperaba una banda 2D, no {self._data.shape}")
+        meta = _read_sidecar(path)
+        self.transform = GeoTransform.from_list(meta["transform"]) if "transform" in meta else GeoTransform()
+        self.crs = meta.get("crs")
+        self.nodata = meta.get("nodata")
+
+    @property
+    def shape(self) -> Tuple[int, int]:
+        return self._data.shape
+
+    @property
+    def dtype(self) -> np.dtype:
+        return self._data.dtype
+
+    def read(self, window: Window, out_shape: Optional[Tuple[int, int]] = None) -> np.ndarray:
+        if out_shape is None:
+            return self._data[window.slices]
+        # Lectura diezmada (vecino más próximo): solo se tocan las páginas de las filas/columnas elegidas
+        rows = window.row + (np.arange(out_shape[0]) * window.height) // out_shape[0]
+        cols = window.col + (np.arange(out_shape[1]) * window.width) // out_shape[1]
+        return self._data[np.ix_(rows, cols)]
+
+    def close(self) -> None:
+        self._data = None
+
+
+class RasterioRaster:
+    """Una banda de un GeoTIFF/COG; rasterio lee solo los bloques que cubren la ventana."""
+
+    def __init__(self, path: str, band: int = 1):
+        import rasterio
+
+        self.path = path
+        self.band = band
+        self._ds = rasterio.open(path)
+        a = self._ds.transform
+        if a.b or a.d:
+            raise ValueError(f"{path}: transform con rotación no soportado")
+        self.transform = GeoTransform(a.c, a.a, a.f, a.e)
+        self.crs = self._ds.crs.to_string() if self._ds.crs else None
+        self.nodata = self._ds.nodata
+
+    @property
+    def shape(self) -> Tuple[int, int]:
+        return self._ds.height, self._ds.width
+
+    @property
+    def dtype(self) -> np.dtype:
+        return np.dtype(self._ds.dtypes[self.band - 1])
+
+    def read(self, window: Window, out_shape: Optional[Tuple[int, int]] = None) -> np.ndarray:
+        from rasterio.windows import Window as RioWindow
+
+        # Con out_shape GDAL lee de la vista general (overview) más cercana
+        return self._ds.read(self.band, window=RioWindow(window.col, window.row, window.width, window.height),
+                             out_shape=out_shape)
+
+    def close(self) -> None:
+        self._ds.close()
+
+
+def open_raster(path: str, band: int = 1):
+    if path.endswith(".npy"):
+        return NpyRaster(path)
+    from app.core.cog import CogRaster, UnsupportedTiff
+
+    try:
+        return CogRaster(path, band)
+    except UnsupportedTiff:
+        return RasterioRaster(path, band)
+
+
+class NpyRasterWriter:
+    def __init__(self, path: str, shape, dtype, transform: GeoTransform, crs, nodata):
+        self.path = path
+        self._data = np.lib.format.open_memmap(path + ".tmp.npy", mode="w+", dtype=dtype, shape=tuple(shape))
+        self._meta = {"transform": transform.to_list(), "crs": crs, "nodata": nodata}
+
+    def write(self, window: Window, data: np.ndarray) -> None:
+        self._data[window.slices] = data
+
+    def close(self) -> None:
+        # Datos y sidecar se publican con dos os.replace (cada fichero es atómico, el
+        # par no): primero los datos, luego el sidecar, así nunca hay metadatos nuevos
+        # sobre datos viejos. Entre ambos un lector puede ver datos nuevos con el
+        # sidecar anterior; raster_signature incluye el sidecar, así que quien cachee
+        # por firma reabre en cuanto se publica.
+        self._data.flush()
+        self._data = None
+        os.replace(self.path + ".tmp.npy", self.path)
+        sidecar = _sidecar(self.path)
+        with open(sidecar + ".tmp", "w") as f:
+            json.dump(self._meta, f)
+        os.replace(sidecar + ".tmp", sidecar)
+
+
+class RasterioWriter:
+    def __init__(self, path: str, shape, dtype, transform: GeoTransform, crs, nodata):
+        import rasterio
+        from rasterio.transform import Affine
+
+        self.path = path
+        self._ds = rasterio.open(
+            path, "w", driver="GTiff", height=shape[0], width=shape[1], count=1, dtype=np.dtype(dtype).name,
+            crs=crs, nodata=nodata, transform=Affine(transform.dx, 0.0, transform.x0, 0.0, transform.dy, transform.y0),
+            tiled=True, blockxsize=256, blockysize=256, compress="deflate", predictor=3,
+        )
+
+    def write(self, window: Window, data: np.ndarray) -> None:
+        from rasterio.windows import Window as RioWindow
+
+        self._ds.write(data, 1, window=RioWindow(window.col, window.row, window.width, window.height))
+
+    def close(self) -> None:
+        self._ds.close()
+
+
+def create_raster(path: str, shape, dtype=np.float32, transform: Optional[GeoTransform] = None,
+                  crs: Optional[str] = None, nodata: Optional[float] = None):
+    """Escritor por ventanas; el ráster queda visible al llamar a close()."""
+    transform = transform or GeoTransform()
+    cls = NpyRasterWriter if path.endswith(".npy") else RasterioWriter
+    return cls(path, shape, dtype, transform, crs, nodata)
+
+
+def save_npy(path: str, data: np.ndarray, transform: Optional[GeoTransform] = None,
+             crs: Optional[str] = None, nodata: Optional[float] = None) -> None:
+    """Atajo para laboratorios y fixtures: escribe un array completo como ráster .npy."""
+    writer = NpyRasterWriter(path, data.shape, data.dtype, transform or GeoTransform(), crs, nodata)
+    writer.write(Window(0, 0, *data.shape), data)
+    writer.close()
+
+
+def _sidecar(path: str) -> str:
+    return path[:-4] + ".json"
+
+
+def raster_signature(path: str) -> tuple:
+    """Ruta, mtime y tamaño de los datos y, en un .npy, de su sidecar: cambia con cualquier regeneración."""
+    st = os.stat(path)
+    signature = (path, st.st_mtime_ns, st.st_size)
+    if path.endswith(".npy"):
+        try:
+            meta = os.stat(_sidecar(path))
+            signature += (meta.st_mtime_ns, meta.st_size)
+        except FileNotFoundError:
+            signature += (None, None)
+    return signature
+
+
+def _read_sidecar(path: str) -> dict:
+    try:
+        with open(_sidecar(path)) as f:
+            return json.load(f)
+    except FileNotFoundError:
+        return {}
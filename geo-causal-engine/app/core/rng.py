@@ -0,0 +1,107 @@
+import hashlib
+from typing import Any, Callable, List, Union
+
+import numpy as np
+
+from app.core.work_pool import get_pool
+
+# Semilla raíz de la suite (sustituye al np.random.seed(42) global)
+ROOT_SEED = 42
+
+JobId = Union[int, str]
+
+
+def _job_word(job: JobId) -> int:
+    """Convierte el identificador del trabajo en una palabra de 64 bits estable."""
+    if isinstance(job, int):
+        return job & 0xFFFFFFFFFFFFFFFF
+    digest = hashlib.blake2b(str(job).encode("utf-8"), digest_size=8).digest()
+    return int.from_bytes(digest, "little")
+
+
+def stream(job: JobId, thread: int = 0, replicate: int = 0, seed: int = ROOT_SEED) -> np.random.Generator:
+    """
+    Flujo Philox (generador basado en contador) identificado por (job, thread, replicate).
+
+    - La clave de 128 bits es (seed, job): cada trabajo tiene su propio espacio.
+    - El contador de 256 bits se reparte en: palabras 0-1 = posición dentro del
+      flujo (2^128 bloques), palabra 2 = carril lógico `thread`, palabra 3 =
+      `replicate`. Los flujos nunca se solapan y saltar a cualquiera es O(1).
+
+    `thread` es un carril lógico (p.ej. una variable o sub-simulación), no el
+    id del hilo del sistema: así el resultado no depende de cuántos hilos corran.
+    """
+    key = np.array([seed & 0xFFFFFFFFFFFFFFFF, _job_word(job)], dtype=np.uint64)
+    counter = np.array([0, 0, thread, replicate], dtype=np.uint64)
+    return np.random.Generator(np.random.Philox(key=key, counter=counter))
+
+
+def uniform(rng: np.random.Generator, n: int, low: float = 0.0, high: float = 1.0) -> np.ndarray:
+    return rng.uniform(low, high, n)
+
+
+def normal(rng: np.random.Generator, n: int, mean: float = 0.0, sd: float = 1.0) -> np.ndarray:
+    return rng.normal(mean, sd, n)
+
+
+def truncated_normal(
+    rng: np.random.Generator,
+    n: int,
+    mean: float = 0.0,
+    sd: float = 1.0,
+    low: float = -np.inf,
+    high: float = np.inf,
+) -> np.ndarray:
+    """
+    Normal truncada en [low, high] por rechazo vectorizado.
+
+    La propuesta se elige según la región para mantener alta la aceptación:
+    - colas (a > 0.5 o b < -0.5): exponencial desplazada (Robert, 1995)
+    - intervalos estrechos (b - a < 2): uniforme en [a, b]
+    - resto: normal estándar
+    """
+    a = (low - mean) / sd
+    b = (high - mean) / sd
+    if not a < b:
+        raise ValueError(f"Intervalo de truncamiento vacío: [{low}, {high}]")
+
+    if b < -0.5:
+        # Cola izquierda: se muestrea la cola derecha simétrica y se invierte
+        return mean - sd * _standard_truncated(rng, n, -b, -a)
+    return mean + sd * _standard_truncated(rng, n, a, b)
+
+
+def _standard_truncated(rng: np.random.Generator, n: int, a: float, b: float) -> np.ndarray:
+    out = np.empty(n)
+    filled = 0
+    while filled < n:
+        need = n - filled
+        batch = max(64, int(need * 1.3))
+
+        if a > 0.5:
+            alpha = (a + np.sqrt(a * a + 4.0)) / 2.0
+            z = a + rng.exponential(1.0 / alpha, batch)
+            u = rng.uniform(0.0, 1.0, batch)
+            accept = (u <= np.exp(-0.5 * (z - alpha) ** 2)) & (z <= b)
+        elif b - a < 2.0:
+            z = rng.uniform(a, b, batch)
+            u = rng.uniform(0.0, 1.0, batch)
+            closest = 0.0 if a <= 0.0 <= b else min(abs(a), abs(b))
+            accept = u <= np.exp(0.5 * (closest * closest - z * z))
+        else:
+            z = rng.standard_normal(batch)
+            accept = (z >= a) & (z <= b)
+
+        kept = z[accept][:need]
+        out[filled:filled + kept.size] = kept
+        filled += kept.size
+    return out
+
+
+def replicate_map(job: JobId, n_replicates: int, fn: Callable[[np.random.Generator, int], Any]) -> List[Any]:
+    """
+    Ejecuta fn(rng, r) para cada réplica en el pool compartido.
+    Cada réplica recibe su propio flujo, así que la salida es idéntica bit a
+    bit con 1 o con N hilos.
+    """
+    return get_pool().map(lambda r: fn(stream(job, replicate=r), r), range(n_replicates))
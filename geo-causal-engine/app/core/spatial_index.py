@@ -0,0 +1,149 @@
+"""
+KD-tree de cubetas para vecindarios locales (interpolación, GWR, pesos espaciales).
+
+Construcción: divisiones sucesivas por la mediana del eje más ancho hasta
+hojas de `leaf_size` puntos; cada hoja guarda su caja envolvente. Un árbol
+sin puntos es válido: no tiene hojas y sus consultas devuelven 0 vecinos.
+
+Consulta por lotes coherentes (una tesela de la rejilla, o los puntos de
+una hoja del árbol de consultas): para una caja B que contiene todas las
+consultas del lote,
+
+    U = k-ésima menor distancia máxima de B a los puntos cercanos
+
+acota la distancia al k-ésimo vecino de cualquier consulta dentro de B, así
+que basta con las hojas a distancia mínima <= U. Sobre ese conjunto de
+candidatos se hace fuerza bruta vectorizada con argpartition: el resultado
+es exacto y el trabajo por lote es O(consultas · candidatos) en NumPy.
+"""
+
+from typing import List, Tuple
+
+import numpy as np
+
+from app.core.work_pool import get_pool
+
+
+def _box_min_dist(lo: np.ndarray, hi: np.ndarray, box_lo: np.ndarray, box_hi: np.ndarray) -> np.ndarray:
+    """Distancia mínima entre la caja [box_lo, box_hi] y cada caja [lo, hi]."""
+    gap = np.maximum(0.0, np.maximum(lo - box_hi, box_lo - hi))
+    return np.sqrt((gap * gap).sum(axis=-1))
+
+
+def _expand(bounds: np.ndarray) -> np.ndarray:
+    """Concatena los rangos [a, b) de `bounds` sin bucle de Python."""
+    lengths = bounds[:, 1] - bounds[:, 0]
+    offsets = np.repeat(bounds[:, 0] - np.cumsum(lengths) + lengths, lengths)
+    return offsets + np.arange(lengths.sum())
+
+
+def _point_max_dist(points: np.ndarray, box_lo: np.ndarray, box_hi: np.ndarray) -> np.ndarray:
+    """Distancia máxima desde cualquier punto de la caja a cada punto."""
+    far = np.maximum(np.abs(points - box_lo), np.abs(points - box_hi))
+    return np.sqrt((far * far).sum(axis=-1))
+
+
+class KDTree:
+    # Tope de pares consulta×candidato por lote; por encima el lote se parte en dos
+    PAIR_BUDGET = 1 << 21
+
+    def __init__(self, points: np.ndarray, leaf_size: int = 32):
+        points = np.ascontiguousarray(points, dtype=np.float64)
+        if points.ndim != 2 or points.shape[1] != 2:
+            raise ValueError(f"Se esperaban puntos (n, 2), no {points.shape}")
+        n = points.shape[0]
+        order = np.arange(n)
+        leaves: List[Tuple[int, int]] = []
+        stack = [(0, n)] if n else []
+        while stack:
+            start, stop = stack.pop()
+            if stop - start <= leaf_size:
+                leaves.append((start, stop))
+                continue
+            segment = order[start:stop]
+            coords = points[segment]
+            axis = int(np.argmax(coords.max(axis=0) - coords.min(axis=0)))
+            mid = (stop - start) // 2
+            order[start:stop] = segment[np.argpartition(coords[:, axis], mid)]
+            stack.extend(((start, start + mid), (start + mid, stop)))
+
+        leaves.sort()
+        self.points = points
+        self.order = order
+        self.sorted_points = points[order]
+        self.leaf_bounds = np.array(leaves, dtype=np.int64).reshape(-1, 2)
+        self.leaf_lo = np.array([self.sorted_points[a:b].min(axis=0) for a, b in leaves]).reshape(-1, 2)
+        self.leaf_hi = np.array([self.sorted_points[a:b].max(axis=0) for a, b in leaves]).reshape(-1, 2)
+
+    @property
+    def size(self) -> int:
+        return self.points.shape[0]
+
+    def leaves(self) -> List[np.ndarray]:
+        """Índices originales de los puntos de cada hoja (lotes espacialmente coherentes)."""
+        return [self.order[a:b] for a, b in self.leaf_bounds]
+
+    def candidates(self, box_lo: np.ndarray, box_hi: np.ndarray, k: int) -> np.ndarray:
+        """Índices (en orden del árbol) que contienen los k vecinos de cualquier punto de la caja."""
+        near = _box_min_dist(self.leaf_lo, self.leaf_hi, box_lo, box_hi)
+        by_distance = np.argsort(near)
+        sizes = np.diff(self.leaf_bounds, axis=1).ravel()[by_distance]
+        enough = int(np.searchsorted(np.cumsum(sizes), k)) + 1
+        seed = _expand(self.leaf_bounds[by_distance[:enough]])
+        bound = np.partition(_point_max_dist(self.sorted_points[seed], box_lo, box_hi), k - 1)[k - 1]
+        return _expand(self.leaf_bounds[np.flatnonzero(near <= bound)])
+
+    def query_batch(self, queries: np.ndarray, k: int) -> Tuple[np.ndarray, np.ndarray]:
+        """k vecinos exactos de un lote coherente: (distancias, índices originales), ambos (Q, k) ordenados."""
+        k = min(k, self.size)
+        queries = np.asarray(queries, dtype=np.float64)
+        if k <= 0 or queries.shape[0] == 0:
+            return np.empty((queries.shape[0], max(k, 0))), np.empty((queries.shape[0], max(k, 0)), dtype=np.int64)
+        cand = self.candidates(queries.min(axis=0), queries.max(axis=0), k)
+        if cand.size * queries.shape[0] > self.PAIR_BUDGET and queries.shape[0] > 1:
+            # Lote demasiado extenso para la densidad de puntos: se parte por la mediana del eje ancho
+            axis = int(np.argmax(np.ptp(queries, axis=0)))
+            order = np.argsort(queries[:, axis], kind="stable")
+            half = order.size // 2
+            dist = np.empty((queries.shape[0], k))
+            idx = np.empty((queries.shape[0], k), dtype=np.int64)
+            for part in (order[:half], order[half:]):
+                dist[part], idx[part] = self.query_batch(queries[part], k)
+            return dist, idx
+        # |q - p|² = |q|² + |p|² - 2 q·p: una multiplicación de matrices en lugar de un cubo (Q, C, 2)
+        pts = self.sorted_points[cand]
+        d2 = queries @ (-2.0 * pts.T)
+        d2 += (queries * queries).sum(axis=1)[:, None]
+        d2 += (pts * pts).sum(axis=1)
+        np.maximum(d2, 0.0, out=d2)
+        part = np.argpartition(d2, k - 1, axis=1)[:, :k] if cand.size > k else np.broadcast_to(np.arange(k), d2.shape[:1] + (k,))
+        d2k = np.take_along_axis(d2, part, axis=1)
+        sort = np.argsort(d2k, axis=1, kind="stable")
+        part = np.take_along_axis(part, sort, axis=1)
+        return np.sqrt(np.take_along_axis(d2k, sort, axis=1)), self.order[cand[part]]
+
+    def query(self, queries: np.ndarray, k: int, batch: int = 64) -> Tuple[np.ndarray, np.ndarray]:
+        """k vecinos de consultas arbitrarias: se agrupan en lotes coherentes con un árbol propio."""
+        queries = np.asarray(queries, dtype=np.float64)
+        groups = KDTree(queries, leaf_size=batch).leaves()
+        k = min(k, self.size)
+        dist = np.empty((queries.shape[0], k))
+        idx = np.empty((queries.shape[0], k), dtype=np.int64)
+
+        def run(group: np.ndarray) -> None:
+            dist[group], idx[group] = self.query_batch(queries[group], k)
+
+        get_pool().map(run, groups)
+        return dist, idx
+
+    def knn_self(self, k: int) -> Tuple[np.ndarray, np.ndarray]:
+        """k vecinos de cada punto del árbol, excluido él mismo (listas reutilizables entre motores)."""
+        if self.size == 0:
+            return np.empty((0, 0)), np.empty((0, 0), dtype=np.int64)
+        dist, idx = self.query(self.points, k + 1)
+        # El propio punto es el primero salvo duplicados exactos: se elimina por identidad
+        own = idx == np.arange(self.size)[:, None]
+        has_own = own.any(axis=1)
+        own[~has_own, -1] = True
+        keep = ~own
+        return dist[keep].reshape(self.size, -1), idx[keep].reshape(self.size, -1)
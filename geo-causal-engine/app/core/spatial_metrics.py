@@ -1,4 +1,12 @@
+import numpy as np
+
+from app.core.work_pool import get_pool
+
+
 class SpatialStressCalculator:
+    # Filas por bloque al procesar rásters completos (un bloque = una tarea del pool)
+    TILE_ROWS = 256
+
     @staticmethod
     def calculate_environmental_stress(ndvi: float, lst: float) -> float:
         """
@@ -13,3 +21,36 @@ class SpatialStressCalculator:
         
         environmental_stress = (resource_scarcity * 0.6) + (norm_temp * 0.4)
         return round(environmental_stress, 4)
+
+    @staticmethod
+    def stress_kernel(ndvi: np.ndarray, lst: np.ndarray, out: np.ndarray) -> None:
+        """Misma fórmula que la versión escalar, in-place sobre un bloque (libera el GIL)."""
+        np.minimum(lst / 45.0, 1.0, out=out)
+        out *= 0.4
+        scarcity = 1.0 - np.maximum(ndvi, 0.0)
+        scarcity *= 0.6
+        out += scarcity
+
+    @classmethod
+    def calculate_stress_raster(cls, ndvi: np.ndarray, lst: np.ndarray) -> np.ndarray:
+        """
+        Estrés ambiental píxel a píxel para rásters completos.
+        Se reparte por bloques de filas en el pool compartido del proceso.
+        """
+        ndvi = np.asarray(ndvi, dtype=np.float32)
+        lst = np.asarray(lst, dtype=np.float32)
+        if ndvi.shape != lst.shape:
+            raise ValueError(f"NDVI {ndvi.shape} y LST {lst.shape} deben estar alineados")
+
+        out = np.empty_like(ndvi)
+        rows = ndvi.shape[0] if ndvi.ndim else 1
+        if ndvi.ndim == 0 or rows <= cls.TILE_ROWS:
+            cls.stress_kernel(ndvi, lst, out)
+            return out
+
+        def run_tile(start: int) -> None:
+            stop = min(start + cls.TILE_ROWS, rows)
+            cls.stress_kernel(ndvi[start:stop], lst[start:stop], out[start:stop])
+
+        get_pool().map(run_tile, range(0, rows, cls.TILE_ROWS))
+        return out
@@ -0,0 +1,386 @@
+"""
+Teselas de mapa XYZ (Web Mercator, 256 px) de las capas precalculadas.
+
+Capas base: rásters en GEO_TILE_LAYERS_DIR (`stress`, `extraversion`,
+`conscientiousness`, .npy o .tif, en cualquier CRS de app/core/warp.py). Capas
+derivadas: `nation` y `patria`, la probabilidad del modelo político
+evaluada píxel a píxel sobre las tres capas base con la versión activa
+del registro.
+
+Render: en EPSG:3857 y EPSG:4326 las coordenadas de los centros de píxel
+de la tesela son separables (una por fila, una por columna), así que el
+muestreo es un gather por vecino más próximo sobre la ventana que cubre la
+tesela; si la ventana es mucho mayor que la tesela (zoom bajo) se lee
+diezmada, de la vista general en un COG. Otros CRS (UTM...) pasan por
+WarpedRaster con remuestreo `nearest`. La salida es un PNG con paleta (1 byte/píxel, índice 0
+transparente) comprimido con zlib nivel 1.
+
+Caché en dos niveles: LRU en memoria acotado en bytes y directorio en disco
+`<capa>/<versión>/<z>/<x>/<y>.png`. La versión de una capa es un hash del
+tamaño y mtime de sus ficheros (datos y sidecar), los bytes de su paleta, su escala y (en las
+derivadas) la versión del modelo: sirve de ETag sin renderizar nada, y una
+capa regenerada invalida sus teselas sin borrarlas una a una. Las versiones
+antiguas se retiran del disco renombrando su directorio antes de borrarlo,
+así una escritura concurrente nunca encuentra un árbol a medio borrar.
+"""
+
+import hashlib
+import math
+import os
+import shutil
+import struct
+import sys
+import threading
+import zlib
+from collections import OrderedDict
+from contextlib import ExitStack, contextmanager
+from dataclasses import dataclass
+from typing import Dict, Iterator, Optional, Tuple
+
+import numpy as np
+
+from app.core.raster_io import GeoTransform, Window, open_raster, raster_signature
+from app.core.warp import WarpedRaster, parse_crs, transformer
+from app.core.work_pool import get_pool
+
+TILE = 256
+MAX_ZOOM = 24
+EARTH_RADIUS = 6378137.0
+ORIGIN = math.pi * EARTH_RADIUS
+
+# Paletas (posición 0..1, RGB); se expanden a 255 colores, el índice 0 queda transparente
+COLORMAPS = {
+    "stress": ((0.0, (255, 255, 204)), (0.5, (253, 141, 60)), (1.0, (128, 0, 38))),
+    "probability": ((0.0, (33, 102, 172)), (0.5, (247, 247, 247)), (1.0, (178, 24, 43))),
+    "trait": ((0.0, (68, 1, 84)), (0.5, (33, 145, 140)), (1.0, (253, 231, 37))),
+}
+
+DRIVERS = ("conscientiousness", "extraversion", "stress")
+
+
+@dataclass(frozen=True)
+class Layer:
+    sources: Tuple[str, ...]
+    colormap: str
+    vmin: float = 0.0
+    vmax: float = 1.0
+    derived: Optional[str] = None  # "nation" | "patria": probabilidad del modelo político
+
+
+LAYERS: Dict[str, Layer] = {
+    "stress": Layer(("stress",), "stress"),
+    "extraversion": Layer(("extraversion",), "trait"),
+    "conscientiousness": Layer(("conscientiousness",), "trait"),
+    "nation": Layer(DRIVERS, "probability", derived="nation"),
+    "patria": Layer(DRIVERS, "probability", derived="patria"),
+}
+
+
+def palette(stops) -> bytes:
+    """PLTE de 256 entradas: 0 transparente (tRNS), 1..255 la rampa."""
+    pos = np.linspace(0.0, 1.0, 255)
+    at = [s[0] for s in stops]
+    ramp = np.stack([np.interp(pos, at, [s[1][c] for s in stops]) for c in range(3)], axis=1)
+    return bytes(3) + np.round(ramp).astype(np.uint8).tobytes()
+
+
+PALETTES = {name: palette(stops) for name, stops in COLORMAPS.items()}
+
+
+def _chunk(tag: bytes, data: bytes) -> bytes:
+    return struct.pack(">I", len(data)) + tag + data + struct.pack(">I", zlib.crc32(tag + data))
+
+
+def encode_png(index: np.ndarray, plte: bytes, level: int = 1) -> bytes:
+    """PNG indexado de 8 bits; cada fila con filtro 0 (los índices ya comprimen bien)."""
+    h, w = index.shape
+    raw = np.zeros((h, w + 1), dtype=np.uint8)
+    raw[:, 1:] = index
+    return b"".join((
+        b"\x89PNG\r\n\x1a\n",
+        _chunk(b"IHDR", struct.pack(">IIBBBBB", w, h, 8, 3, 0, 0, 0)),
+        _chunk(b"PLTE", plte),
+        _chunk(b"tRNS", b"\x00"),
+        _chunk(b"IDAT", zlib.compress(raw.tobytes(), level)),
+        _chunk(b"IEND", b""),
+    ))
+
+
+EMPTY_TILE = encode_png(np.zeros((TILE, TILE), dtype=np.uint8), PALETTES["stress"], 9)
+
+
+def valid_tile(z: int, x: int, y: int) -> bool:
+    return 0 <= z <= MAX_ZOOM and 0 <= x < 2 ** z and 0 <= y < 2 ** z
+
+
+def tile_centers(z: int, x: int, y: int) -> Tuple[np.ndarray, np.ndarray]:
+    """Centros de píxel de la tesela en metros Web Mercator: (xs por columna, ys por fila)."""
+    res = 2.0 * ORIGIN / (TILE * 2 ** z)
+    offsets = np.arange(TILE) + 0.5
+    return -ORIGIN + (x * TILE + offsets) * res, ORIGIN - (y * TILE + offsets) * res
+
+
+def sample(raster, z: int, x: int, y: int) -> Optional[np.ndarray]:
+    """Valores (TILE, TILE) float32 por vecino más próximo; NaN fuera del ráster o en nodata."""
+    xs, ys = tile_centers(z, x, y)
+    if parse_crs(raster.crs) not in (("geographic",), ("mercator",)):
+        res = xs[1] - xs[0]
+        warped = WarpedRaster(raster, GeoTransform(xs[0] - res / 2, res, ys[0] + res / 2, -res), (TILE, TILE),
+                              "EPSG:3857", "nearest")
+        values = warped.read(Window(0, 0, TILE, TILE)).astype(np.float32)
+        if warped.nodata is not None:
+            values[values == warped.nodata] = np.nan
+        return values if not np.isnan(values).all() else None
+    # Entre 3857 y 4326 x solo depende de x e y solo de y
+    to_raster = transformer("EPSG:3857", raster.crs)
+    xs, ys = to_raster(xs, np.zeros_like(xs))[0], to_raster(np.zeros_like(ys), ys)[1]
+    t = raster.transform
+    rows = np.floor((ys - t.y0) / t.dy).astype(np.int64)
+    cols = np.floor((xs - t.x0) / t.dx).astype(np.int64)
+    rin = (rows >= 0) & (rows < raster.shape[0])
+    cin = (cols >= 0) & (cols < raster.shape[1])
+    if not rin.any() or not cin.any():
+        return None
+    r0, c0 = int(rows[rin].min()), int(cols[cin].min())
+    window = Window(r0, c0, int(rows[rin].max()) + 1 - r0, int(cols[cin].max()) + 1 - c0)
+    out_shape = None
+    if window.height > 2 * TILE or window.width > 2 * TILE:
+        out_shape = (min(window.height, 2 * TILE), min(window.width, 2 * TILE))
+    data = raster.read(window, out_shape)
+    local_rows = (rows[rin] - r0) * data.shape[0] // window.height
+    local_cols = (cols[cin] - c0) * data.shape[1] // window.width
+    values = np.full((TILE, TILE), np.nan, dtype=np.float32)
+    values[np.ix_(rin, cin)] = data[np.ix_(local_rows, local_cols)]
+    if raster.nodata is not None:
+        values[values == raster.nodata] = np.nan
+    return values
+
+
+class TileCache:
+    """LRU en memoria acotado en bytes sobre un directorio en disco (opcional)."""
+
+    def __init__(self, max_bytes: int, directory: Optional[str] = None):
+        self.max_bytes = max_bytes
+        self.directory = directory
+        self.stats = {"memory": 0, "disk": 0, "miss": 0}
+        self._lru: "OrderedDict[tuple, bytes]" = OrderedDict()
+        self._bytes = 0
+        self._lock = threading.Lock()
+
+    def _path(self, key: tuple) -> str:
+        layer, version, z, x, y = key
+        return os.path.join(self.directory, layer, version, str(z), str(x), f"{y}.png")
+
+    def _remember(self, key: tuple, data: bytes) -> None:
+        with self._lock:
+            if key in self._lru:
+                self._lru.move_to_end(key)
+                return
+            self._lru[key] = data
+            self._bytes += len(data)
+            while self._bytes > self.max_bytes and self._lru:
+                self._bytes -= len(self._lru.popitem(last=False)[1])
+
+    def get(self, key: tuple) -> Optional[bytes]:
+        with self._lock:
+            data = self._lru.get(key)
+            if data is not None:
+                self._lru.move_to_end(key)
+                self.stats["memory"] += 1
+                return data
+        if self.directory:
+            try:
+                with open(self._path(key), "rb") as f:
+                    data = f.read()
+            except OSError:
+                pass
+            else:
+                self.stats["disk"] += 1
+                self._remember(key, data)
+                return data
+        self.stats["miss"] += 1
+        return None
+
+    def put(self, key: tuple, data: bytes) -> None:
+        self._remember(key, data)
+        if self.directory:
+            path = self._path(key)
+            tmp = f"{path}.{os.getpid()}.{threading.get_ident()}.tmp"
+            try:
+                os.makedirs(os.path.dirname(path), exist_ok=True)
+                with open(tmp, "wb") as f:
+                    f.write(data)
+                os.replace(tmp, path)
+            except OSError:
+                # Versión retirada por prune() a mitad de escritura (o disco lleno): la
+                # tesela ya está en memoria, el disco es solo una caché
+                try:
+                    os.remove(tmp)
+                except OSError:
+                    pass
+
+    def prune(self, layer: str, keep: str) -> None:
+        """Borra del disco las versiones antiguas de una capa."""
+        root = os.path.join(self.directory, layer) if self.directory else None
+        if not root or not os.path.isdir(root):
+            return
+        for version in os.listdir(root):
+            if version == keep:
+                continue
+            path = os.path.join(root, version)
+            if not version.startswith("."):
+                # rename atómico: los lectores ven la versión entera o ninguna, y las
+                # escrituras rezagadas fallan (o recrean un directorio que el próximo prune retira)
+                trash = os.path.join(root, f".{version}.{os.getpid()}.{threading.get_ident()}.trash")
+                try:
+                    os.rename(path, trash)
+                except OSError:
+                    continue  # otro hilo/proceso ya la está retirando
+                path = trash
+            shutil.rmtree(path, ignore_errors=True)
+
+
+class _OpenRaster:
+    """Ráster abierto de una capa y cuántas peticiones lo leen; se cierra retirado y sin lectores."""
+    __slots__ = ("signature", "raster", "readers", "retired")
+
+    def __init__(self, signature: tuple, raster):
+        self.signature = signature
+        self.raster = raster
+        self.readers = 0
+        self.retired = False
+
+
+class TileService:
+    def __init__(self, layers_dir: str, cache: TileCache):
+        self.layers_dir = layers_dir
+        self.cache = cache
+        self._rasters: Dict[str, _OpenRaster] = {}
+        self._versions: Dict[str, str] = {}
+        self._lock = threading.Lock()
+
+    def _source(self, name: str) -> Tuple[str, tuple]:
+        for ext in (".npy", ".tif"):
+            path = os.path.join(self.layers_dir, name + ext)
+            try:
+                return path, raster_signature(path)
+            except FileNotFoundError:
+                continue
+        raise FileNotFoundError(f"Capa no disponible: {name}")
+
+    @contextmanager
+    def _raster(self, name: str) -> Iterator:
+        """
+        Ráster de la capa durante el bloque. Se reabre si los datos o el sidecar
+        cambiaron (capa regenerada; abrir un .npy es solo un mmap) y el anterior
+        se cierra cuando termina la última petición que lo estaba leyendo.
+        """
+        path, signature = self._source(name)
+        stale = None
+        with self._lock:
+            current = self._rasters.get(name)
+            if current is None or current.signature != signature:
+                if current is not None:
+                    current.retired = True
+                    stale = current if not current.readers else None
+                current = self._rasters[name] = _OpenRaster(signature, open_raster(path))
+            current.readers += 1
+        if stale is not None:
+            stale.raster.close()
+        try:
+            yield current.raster
+        finally:
+            with self._lock:
+                current.readers -= 1
+                done = current.retired and not current.readers
+            if done:
+                current.raster.close()
+
+    def version(self, layer: str, model=None) -> str:
+        spec = LAYERS[layer]
+        # Lo que cambia los píxeles renderizados: paleta (bytes, no el nombre), escala y derivación
+        h = hashlib.blake2b(PALETTES[spec.colormap], digest_size=8)
+        h.update(struct.pack("<dd", spec.vmin, spec.vmax))
+        h.update(f"{spec.derived}".encode())
+        for name in spec.sources:
+            h.update(repr(self._source(name)[1]).encode())
+        if spec.derived:
+            h.update(str(model.version).encode())
+        version = h.hexdigest()
+        with self._lock:
+            previous = self._versions.get(layer)
+            self._versions[layer] = version
+        if previous is not None and previous != version:
+            self.cache.prune(layer, version)
+        return version
+
+    @staticmethod
+    def etag(version: str, z: int, x: int, y: int) -> str:
+        return f'"{version}-{z}-{x}-{y}"'
+
+    def values(self, layer: str, z: int, x: int, y: int, model=None) -> Optional[np.ndarray]:
+        spec = LAYERS[layer]
+        with ExitStack() as stack:
+            grids = [sample(stack.enter_context(self._raster(name)), z, x, y) for name in spec.sources]
+        if any(g is None for g in grids):
+            return None
+        if not spec.derived:
+            return grids[0]
+        nation, patria = model.engine.scores(*grids)
+        prob_nation = 1.0 / (1.0 + np.exp(patria - nation))
+        return prob_nation if spec.derived == "nation" else 1.0 - prob_nation
+
+    def render(self, layer: str, z: int, x: int, y: int, model=None) -> bytes:
+        values = self.values(layer, z, x, y, model)
+        if values is None:
+            return EMPTY_TILE
+        spec = LAYERS[layer]
+        scaled = (values - spec.vmin) * (254.0 / (spec.vmax - spec.vmin))
+        index = np.clip(np.nan_to_num(scaled, nan=-1.0), 0.0, 254.0).astype(np.uint8) + 1
+        index[np.isnan(values)] = 0
+        return encode_png(index, PALETTES[spec.colormap])
+
+    def tile(self, layer: str, version: str, z: int, x: int, y: int, model=None) -> bytes:
+        key = (layer, version, z, x, y)
+        data = self.cache.get(key)
+        if data is None:
+            data = self.render(layer, z, x, y, model)
+            self.cache.put(key, data)
+        return data
+
+    def tile_range(self, layer: str, z: int) -> Tuple[range, range]:
+        """Teselas que cubren la extensión de la capa a un zoom (para sembrar la caché)."""
+        with self._raster(LAYERS[layer].sources[0]) as raster:
+            t, (h, w), crs = raster.transform, raster.shape, raster.crs
+        # Contorno de la capa (bordes muestreados: en UTM no es un rectángulo en Web Mercator)
+        edge = np.linspace(0.0, 1.0, 17)
+        cols = np.concatenate([edge, np.ones_like(edge), edge, np.zeros_like(edge)]) * w
+        rows = np.concatenate([np.zeros_like(edge), edge, np.ones_like(edge), edge]) * h
+        xs, ys = transformer(crs, "EPSG:3857")(t.x0 + cols * t.dx, t.y0 + rows * t.dy)
+        scale = 2 ** z / (2.0 * ORIGIN)
+        tx = np.clip(np.floor((np.array([xs.min(), xs.max()]) + ORIGIN) * scale), 0, 2 ** z - 1).astype(int)
+        ty = np.clip(np.floor((ORIGIN - np.array([ys.max(), ys.min()])) * scale), 0, 2 ** z - 1).astype(int)
+        return range(tx[0], tx[1] + 1), range(ty[0], ty[1] + 1)
+
+
+service = TileService(
+    os.getenv("GEO_TILE_LAYERS_DIR", "/data/layers"),
+    TileCache(int(float(os.getenv("GEO_TILE_CACHE_MB", "256")) * 2 ** 20), os.getenv("GEO_TILE_CACHE_DIR") or None),
+)
+
+
+if __name__ == "__main__":
+    # python -m app.core.tiles <capa> <zoom_min> <zoom_max>: siembra la caché de disco (GEO_TILE_CACHE_DIR)
+    if len(sys.argv) != 4 or sys.argv[1] not in LAYERS:
+        sys.exit(__doc__)
+    layer = sys.argv[1]
+    model = None
+    if LAYERS[layer].derived:
+        from app.core.bayesian_model import registry
+        model = registry.current
+    version = service.version(layer, model)
+    for z in range(int(sys.argv[2]), int(sys.argv[3]) + 1):
+        xs, ys = service.tile_range(layer, z)
+        get_pool().map(lambda xy: service.tile(layer, version, z, *xy, model), [(x, y) for x in xs for y in ys])
+        print({"zoom": z, "tiles": len(xs) * len(ys)})
+    print(service.cache.stats)
@@ -0,0 +1,224 @@
+"""
+Tendencias temporales píxel a píxel sobre pilas de rásters (NDVI, LST, estrés).
+
+Para cada píxel de una serie de T escenas alineadas calcula:
+
+- pendiente OLS (unidades por año),
+- pendiente de Theil–Sen (mediana de las pendientes entre pares),
+- Mann–Kendall: S, Z y p bilateral.
+
+Disposición temporal-mayor: cada tesela se lee como un bloque (T, píxeles)
+contiguo, así las operaciones por desfase `x[k:] - x[:-k]` recorren memoria
+secuencial y se vectorizan a lo ancho de los píxeles. Las teselas se
+reparten en el pool compartido y cada capa de salida se escribe tesela a
+tesela. Los valores NaN (nubes, relleno) se excluyen par a par.
+"""
+
+import calendar
+import os
+import sys
+from datetime import date
+from typing import Dict, List, Sequence
+
+import numpy as np
+
+from app.core.raster_io import Window, create_raster, open_raster, tiles
+from app.core.work_pool import get_pool
+
+OUTPUTS = ("ols_slope", "theil_sen_slope", "mk_s", "mk_z", "mk_p", "n_valid")
+
+# Mínimo de observaciones válidas para estimar una tendencia
+MIN_OBSERVATIONS = 3
+
+
+def decimal_years(dates: Sequence[date]) -> np.ndarray:
+    """Fechas -> años decimales (las pendientes salen en unidades por año)."""
+    return np.array([d.year + (d.timetuple().tm_yday - 0.5) / (366 if calendar.isleap(d.year) else 365) for d in dates])
+
+
+def _norm_sf2(z: np.ndarray) -> np.ndarray:
+    """p bilateral de la normal, 2·(1 - Φ(|z|)) = erfc(|z|/√2) (Abramowitz–Stegun 7.1.26, error < 1.5e-7)."""
+    x = np.abs(z) / np.sqrt(2.0)
+    t = 1.0 / (1.0 + 0.3275911 * x)
+    poly = t * (0.254829592 + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429))))
+    return poly * np.exp(-x * x)
+
+
+def ols_slope(stack: np.ndarray, t: np.ndarray) -> np.ndarray:
+    """Pendiente OLS por columna de un bloque (T, P) con NaN."""
+    valid = ~np.isnan(stack)
+    n = valid.sum(axis=0)
+    tv = np.where(valid, t[:, None], 0.0)
+    with np.errstate(invalid="ignore", divide="ignore"):
+        t_mean = tv.sum(axis=0) / n
+        x_mean = np.nansum(stack, axis=0, dtype=np.float64) / n
+        dt = np.where(valid, t[:, None] - t_mean, 0.0)
+        sxy = np.nansum(dt * (stack - x_mean), axis=0)
+        sxx = np.sum(dt * dt, axis=0)
+        slope = sxy / sxx
+    slope[n < MIN_OBSERVATIONS] = np.nan
+    return slope
+
+
+def pairwise_stats(stack: np.ndarray, t: np.ndarray):
+    """
+    Theil–Sen y el estadístico S de Mann–Kendall a partir de los mismos pares.
+
+    Las pendientes de los T(T-1)/2 pares se guardan píxel-mayor (P, pares). Las
+    inválidas se reparten mitad a -inf y mitad a +inf: la mediana de las
+    válidas queda en una de unas pocas posiciones fijas, así basta un
+    np.partition (O(n)) en lugar de ordenar cada fila. Los pares de escenas con
+    la misma fecha (Δt = 0) no definen pendiente ni orden: cuentan como inválidos.
+    """
+    T, P = stack.shape
+    n_pairs = T * (T - 1) // 2
+    slopes = np.empty((P, n_pairs), dtype=np.float32)
+    s = np.zeros(P, dtype=np.int64)
+    offset = 0
+    same_date = False
+    for k in range(1, T):
+        diff = stack[k:] - stack[:-k]
+        dt = t[k:] - t[:-k]
+        if not dt.all():
+            diff[dt == 0] = np.nan
+            dt = np.where(dt == 0, 1.0, dt)
+            same_date = True
+        s += np.nansum(np.sign(diff), axis=0, dtype=np.int64)
+        diff /= dt[:, None]
+        slopes[:, offset:offset + T - k] = diff.T
+        offset += T - k
+
+    q = np.zeros(P, dtype=np.int64)
+    gappy = np.arange(P) if same_date else np.flatnonzero(np.isnan(stack).any(axis=0))
+    if gappy.size:
+        # Solo las filas con huecos pagan el relleno ±inf
+        sub = slopes[gappy]
+        invalid = np.isnan(sub)
+        q[gappy] = invalid.sum(axis=1)
+        low_fill = (np.cumsum(invalid, axis=1, dtype=np.int32) <= (q[gappy] // 2)[:, None]) & invalid
+        sub[low_fill] = -np.inf
+        sub[invalid & ~low_fill] = np.inf
+        slopes[gappy] = sub
+    m = n_pairs - q
+
+    lo = q // 2 + (m - 1) // 2
+    hi = q // 2 + m // 2
+    kth = np.unique(np.concatenate([lo, hi]).clip(0, n_pairs - 1))
+    slopes.partition(kth, axis=1)
+    rows = np.arange(P)
+    lo_v = slopes[rows, lo.clip(0, n_pairs - 1)].astype(np.float64)
+    hi_v = slopes[rows, hi.clip(0, n_pairs - 1)].astype(np.float64)
+    theil_sen = 0.5 * (lo_v + hi_v)
+    return theil_sen, s
+
+
+def pixel_trends(stack: np.ndarray, t: np.ndarray, pair_budget_bytes: int = 64 << 20) -> Dict[str, np.ndarray]:
+    """Kernel completo sobre un bloque (T, P); trocea los píxeles para acotar la memoria de los pares."""
+    stack = np.asarray(stack, dtype=np.float32)
+    t = np.asarray(t, dtype=np.float64)
+    T, P = stack.shape
+    n_valid = (~np.isnan(stack)).sum(axis=0)
+
+    chunk = max(1, pair_budget_bytes // max(1, 4 * T * (T - 1) // 2))
+    theil_sen = np.empty(P)
+    s = np.empty(P, dtype=np.int64)
+    for start in range(0, P, chunk):
+        part = slice(start, min(start + chunk, P))
+        theil_sen[part], s[part] = pairwise_stats(stack[:, part], t)
+
+    # Var(S) sin corrección por empates (series continuas)
+    n = n_valid.astype(np.float64)
+    var_s = n * (n - 1) * (2 * n + 5) / 18.0
+    with np.errstate(invalid="ignore", divide="ignore"):
+        z = np.where(s > 0, s - 1, np.where(s < 0, s + 1, 0)) / np.sqrt(var_s)
+    p = _norm_sf2(z)
+
+    short = n_valid < MIN_OBSERVATIONS
+    for arr in (theil_sen, z, p):
+        arr[short] = np.nan
+    return {
+        "ols_slope": ols_slope(stack, t),
+        "theil_sen_slope": theil_sen,
+        "mk_s": s,
+        "mk_z": z,
+        "mk_p": p,
+        "n_valid": n_valid,
+    }
+
+
+class TrendEngine:
+    """Pila de rásters alineados -> rásters de tendencia, por teselas cuadradas en el pool."""
+
+    TILE = 128
+
+    def __init__(self, paths: Sequence[str], times: Sequence[float]):
+        if len(paths) != len(times):
+            raise ValueError("Cada escena necesita su fecha")
+        if len(paths) < MIN_OBSERVATIONS:
+            raise ValueError(f"Se necesitan al menos {MIN_OBSERVATIONS} escenas")
+        order = np.argsort(times, kind="stable")
+        self.times = np.asarray(times, dtype=np.float64)[order]
+        self.layers = [open_raster(paths[i]) for i in order]
+        self.shape = self.layers[0].shape
+        for layer in self.layers:
+            if layer.shape != self.shape:
+                raise ValueError(f"{layer.path} {layer.shape} no está alineada con {self.shape}")
+
+    def close(self) -> None:
+        for layer in self.layers:
+            layer.close()
+
+    def read_stack(self, window: Window) -> np.ndarray:
+        """Bloque temporal-mayor (T, h*w) de una tesela; nodata -> NaN."""
+        stack = np.empty((len(self.layers), window.height * window.width), dtype=np.float32)
+        for i, layer in enumerate(self.layers):
+            stack[i] = layer.read(window).ravel()
+            if layer.nodata is not None and not np.isnan(layer.nodata):
+                stack[i][stack[i] == layer.nodata] = np.nan
+        return stack
+
+    def run(self, out_dir: str) -> dict:
+        os.makedirs(out_dir, exist_ok=True)
+        first = self.layers[0]
+        writers = {
+            name: create_raster(os.path.join(out_dir, f"{name}.npy"), self.shape,
+                                np.int32 if name in ("mk_s", "n_valid") else np.float32,
+                                first.transform, first.crs, None if name in ("mk_s", "n_valid") else float("nan"))
+            for name in OUTPUTS
+        }
+
+        def run_tile(window: Window) -> int:
+            result = pixel_trends(self.read_stack(window), self.times)
+            for name, writer in writers.items():
+                writer.write(window, result[name].reshape(window.height, window.width))
+            return int((result["mk_p"] < 0.05).sum())
+
+        try:
+            significant = sum(get_pool().map(run_tile, tiles(self.shape, self.TILE, self.TILE)))
+        finally:
+            for writer in writers.values():
+                writer.close()
+        return {
+            "scenes": len(self.layers),
+            "years": round(float(self.times[-1] - self.times[0]), 2),
+            "pixels": self.shape[0] * self.shape[1],
+            "significant_pixels": significant,
+            "outputs": {name: writer.path for name, writer in writers.items()},
+        }
+
+
+def trend_stack(paths: Sequence[str], times: Sequence[float], out_dir: str) -> dict:
+    engine = TrendEngine(paths, times)
+    try:
+        return engine.run(out_dir)
+    finally:
+        engine.close()
+
+
+if __name__ == "__main__":
+    # python -m app.core.trends <out_dir> AAAA-MM-DD=escena.npy ...
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    entries: List[tuple] = [arg.split("=", 1) for arg in sys.argv[2:]]
+    when = decimal_years([date.fromisoformat(d) for d, _ in entries])
+    print(trend_stack([p for _, p in entries], when, sys.argv[1]))
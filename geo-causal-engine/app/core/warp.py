@@ -0,0 +1,369 @@
+"""
+Reproyección y remuestreo al vuelo, tesela a tesela.
+
+NDVI, LST, población y límites llegan en CRS y resoluciones distintas.
+WarpedRaster presenta cualquier ráster en la rejilla (transform, forma,
+CRS) de otro con la misma interfaz read(window[, out_shape]) que los
+lectores de raster_io, así que band_math, zonal y las teselas lo consumen
+sin escribir rásters intermedios.
+
+Coordenadas: la transformación exacta se evalúa solo en una rejilla gruesa
+de nodos (cada GRID píxeles destino, más los bordes) y se interpola
+bilinealmente para el resto; entre 4326, 3857 y UTM el error de esa
+interpolación es de milésimas de píxel con GRID = 16. Transformaciones
+analíticas:
+
+- EPSG:4326 (grados lon/lat)
+- EPSG:3857 (Web Mercator esférico)
+- EPSG:326zz / 327zz (UTM norte / sur, serie de Krüger de 6º orden,
+  precisión submilimétrica dentro de la zona)
+
+Otros CRS se delegan en pyproj (import perezoso).
+
+Remuestreo: `nearest`, `bilinear` (pesos renormalizados sobre los vecinos
+válidos) y `average` (media de los píxeles origen cuyo centro cae en la
+huella del píxel destino, con imágenes integrales). `sum` es la densidad
+de la caja de la huella (fuera del origen y nodata cuentan como 0) por el
+área de la huella en píxeles origen: conserva la masa de rásters de conteo
+(población) al cambiar de rejilla. Si la ventana origen pasa de
+AREA_MAX_PIXELS se lee diezmada (vistas generales en un COG) y la suma
+pasa a ser una estimación a partir de las muestras.
+"""
+
+import math
+from typing import Callable, Optional, Tuple
+
+import numpy as np
+
+from app.core.raster_io import GeoTransform, Window
+
+WGS84_A = 6378137.0
+WGS84_F = 1 / 298.257223563
+UTM_K0 = 0.9996
+MAX_LATITUDE = 85.0511287798
+
+RESAMPLING = ("nearest", "bilinear", "average", "sum")
+
+
+def _krueger():
+    n = WGS84_F / (2 - WGS84_F)
+    A = WGS84_A / (1 + n) * (1 + n ** 2 / 4 + n ** 4 / 64 + n ** 6 / 256)
+    alpha = (
+        n / 2 - 2 * n ** 2 / 3 + 5 * n ** 3 / 16 + 41 * n ** 4 / 180 - 127 * n ** 5 / 288 + 7891 * n ** 6 / 37800,
+        13 * n ** 2 / 48 - 3 * n ** 3 / 5 + 557 * n ** 4 / 1440 + 281 * n ** 5 / 630 - 1983433 * n ** 6 / 1935360,
+        61 * n ** 3 / 240 - 103 * n ** 4 / 140 + 15061 * n ** 5 / 26880 + 167603 * n ** 6 / 181440,
+        49561 * n ** 4 / 161280 - 179 * n ** 5 / 168 + 6601661 * n ** 6 / 7257600,
+        34729 * n ** 5 / 80640 - 3418889 * n ** 6 / 1995840,
+        212378941 * n ** 6 / 319334400,
+    )
+    beta = (
+        n / 2 - 2 * n ** 2 / 3 + 37 * n ** 3 / 96 - n ** 4 / 360 - 81 * n ** 5 / 512 + 96199 * n ** 6 / 604800,
+        n ** 2 / 48 + n ** 3 / 15 - 437 * n ** 4 / 1440 + 46 * n ** 5 / 105 - 1118711 * n ** 6 / 3870720,
+        17 * n ** 3 / 480 - 37 * n ** 4 / 840 - 209 * n ** 5 / 4480 + 5569 * n ** 6 / 90720,
+        4397 * n ** 4 / 161280 - 11 * n ** 5 / 504 - 830251 * n ** 6 / 7257600,
+        4583 * n ** 5 / 161280 - 108847 * n ** 6 / 3991680,
+        20648693 * n ** 6 / 638668800,
+    )
+    return A, alpha, beta
+
+
+UTM_A, UTM_ALPHA, UTM_BETA = _krueger()
+WGS84_E = math.sqrt(WGS84_F * (2 - WGS84_F))
+
+
+def parse_crs(crs: Optional[str]) -> Optional[tuple]:
+    """("geographic",) | ("mercator",) | ("utm", zona, sur) | None si no es analítico."""
+    crs = (crs or "").upper()
+    if crs in ("EPSG:4326", "OGC:CRS84"):
+        return ("geographic",)
+    if crs in ("EPSG:3857", "EPSG:900913"):
+        return ("mercator",)
+    if crs.startswith("EPSG:"):
+        code = int(crs[5:]) if crs[5:].isdigit() else 0
+        if 32601 <= code <= 32660 or 32701 <= code <= 32760:
+            return ("utm", code % 100, code > 32700)
+    return None
+
+
+def _utm_forward(lon: np.ndarray, lat: np.ndarray, zone: int, south: bool) -> Tuple[np.ndarray, np.ndarray]:
+    phi = np.radians(lat)
+    lam = np.radians(lon - (zone * 6 - 183))
+    sin_phi = np.sin(phi)
+    t = np.sinh(np.arctanh(sin_phi) - WGS84_E * np.arctanh(WGS84_E * sin_phi))
+    xi_p = np.arctan2(t, np.cos(lam))
+    eta_p = np.arctanh(np.sin(lam) / np.sqrt(1 + t * t))
+    xi, eta = xi_p.copy(), eta_p.copy()
+    for j, a in enumerate(UTM_ALPHA, start=1):
+        xi += a * np.sin(2 * j * xi_p) * np.cosh(2 * j * eta_p)
+        eta += a * np.cos(2 * j * xi_p) * np.sinh(2 * j * eta_p)
+    return 500000.0 + UTM_K0 * UTM_A * eta, (10000000.0 if south else 0.0) + UTM_K0 * UTM_A * xi
+
+
+def _utm_inverse(x: np.ndarray, y: np.ndarray, zone: int, south: bool) -> Tuple[np.ndarray, np.ndarray]:
+    xi = (y - (10000000.0 if south else 0.0)) / (UTM_K0 * UTM_A)
+    eta = (x - 500000.0) / (UTM_K0 * UTM_A)
+    xi_p, eta_p = xi.copy(), eta.copy()
+    for j, b in enumerate(UTM_BETA, start=1):
+        xi_p -= b * np.sin(2 * j * xi) * np.cosh(2 * j * eta)
+        eta_p -= b * np.cos(2 * j * xi) * np.sinh(2 * j * eta)
+    # Latitud conforme -> geodésica por Newton sobre tan(φ) (Karney, 2011)
+    tau_p = np.sin(xi_p) / np.sqrt(np.sinh(eta_p) ** 2 + np.cos(xi_p) ** 2)
+    tau = tau_p.copy()
+    e2 = WGS84_E ** 2
+    for _ in range(4):
+        sigma = np.sinh(WGS84_E * np.arctanh(WGS84_E * tau / np.sqrt(1 + tau * tau)))
+        tau_i = tau * np.sqrt(1 + sigma * sigma) - sigma * np.sqrt(1 + tau * tau)
+        tau += (tau_p - tau_i) / np.sqrt(1 + tau_i * tau_i) * (1 + (1 - e2) * tau * tau) / (
+            (1 - e2) * np.sqrt(1 + tau * tau))
+    lon = np.degrees(np.arctan2(np.sinh(eta_p), np.cos(xi_p))) + (zone * 6 - 183)
+    return lon, np.degrees(np.arctan(tau))
+
+
+def to_lonlat(kind: tuple, x: np.ndarray, y: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+    if kind[0] == "geographic":
+        return x, y
+    if kind[0] == "mercator":
+        return np.degrees(x / WGS84_A), np.degrees(np.arctan(np.sinh(y / WGS84_A)))
+    return _utm_inverse(x, y, kind[1], kind[2])
+
+
+def from_lonlat(kind: tuple, lon: np.ndarray, lat: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+    if kind[0] == "geographic":
+        return lon, lat
+    if kind[0] == "mercator":
+        phi = np.radians(np.clip(lat, -MAX_LATITUDE, MAX_LATITUDE))
+        return WGS84_A * np.radians(lon), WGS84_A * np.log(np.tan(math.pi / 4 + phi / 2))
+    return _utm_forward(lon, lat, kind[1], kind[2])
+
+
+def transformer(src: Optional[str], dst: Optional[str]) -> Callable[[np.ndarray, np.ndarray], Tuple[np.ndarray, np.ndarray]]:
+    """(x, y) en `src` -> (x, y) en `dst`, vectorizado."""
+    if (src or "").upper() == (dst or "").upper():
+        return lambda x, y: (x, y)
+    a, b = parse_crs(src), parse_crs(dst)
+    if a is not None and b is not None:
+        return lambda x, y: from_lonlat(b, *to_lonlat(a, np.asarray(x, dtype=np.float64), np.asarray(y, dtype=np.float64)))
+    if src is None or dst is None:
+        raise ValueError(f"No se puede reproyectar sin CRS ({src} -> {dst})")
+    try:
+        from pyproj import Transformer
+    except ImportError:
+        raise ValueError(f"Reproyección {src} -> {dst} requiere pyproj (analíticos: EPSG:4326, EPSG:3857, UTM)")
+    return Transformer.from_crs(src, dst, always_xy=True).transform
+
+
+def _axis_nodes(n: int, step: int) -> np.ndarray:
+    n = max(n, 1)  # al menos dos nodos por eje, aunque la ventana tenga una sola fila
+    return np.unique(np.append(np.arange(0, n + 1, step), n)).astype(np.float64)
+
+
+def _interpolate(nodes_r: np.ndarray, nodes_c: np.ndarray, grid: np.ndarray, rows: np.ndarray, cols: np.ndarray) -> np.ndarray:
+    """Bilineal de una rejilla regular de nodos a las posiciones (rows × cols), separable: columnas y luego filas."""
+    j = np.clip(np.searchsorted(nodes_c, cols, side="right") - 1, 0, nodes_c.size - 2)
+    fc = (cols - nodes_c[j]) / (nodes_c[j + 1] - nodes_c[j])
+    along = grid[:, j] * (1 - fc) + grid[:, j + 1] * fc  # (nodos de fila, columnas): pequeño
+    i = np.clip(np.searchsorted(nodes_r, rows, side="right") - 1, 0, nodes_r.size - 2)
+    fr = ((rows - nodes_r[i]) / (nodes_r[i + 1] - nodes_r[i]))[:, None]
+    out = along[i + 1] * fr
+    out += along[i] * (1 - fr)
+    return out
+
+
+class WarpedRaster:
+    """`source` visto en otra rejilla; misma interfaz que NpyRaster (shape, transform, crs, nodata, read)."""
+
+    GRID = 16
+    AREA_MAX_PIXELS = 1 << 22  # lectura máxima de average/sum (~64 MB de imágenes integrales)
+
+    def __init__(self, source, transform: GeoTransform, shape: Tuple[int, int], crs: Optional[str] = None,
+                 resampling: str = "bilinear", nodata: Optional[float] = None):
+        if resampling not in RESAMPLING:
+            raise ValueError(f"Remuestreo desconocido: {resampling} ({', '.join(RESAMPLING)})")
+        self.source = source
+        self.path = source.path
+        self.transform = transform
+        self.shape = tuple(shape)
+        self.crs = crs or source.crs
+        self.resampling = resampling
+        self.dtype = np.dtype(source.dtype) if resampling == "nearest" else np.dtype(np.float32)
+        self.nodata = nodata if nodata is not None else source.nodata
+        if self.nodata is not None:
+            self.fill = self.nodata
+        else:
+            self.fill = np.nan if self.dtype.kind == "f" else 0
+        if self.dtype.kind in "ui" and not np.can_cast(np.min_scalar_type(self.fill), self.dtype):
+            self.dtype = np.dtype(np.int64)  # el relleno no cabe en el tipo de origen (p.ej. -1 en zonas uint8)
+        self._to_source = transformer(self.crs, source.crs)
+
+    def close(self) -> None:
+        self.source.close()
+
+    def source_pixels(self, transform: GeoTransform, shape: Tuple[int, int], corners: bool = False
+                      ) -> Tuple[np.ndarray, np.ndarray]:
+        """Posición (fila, columna) en el origen de cada centro (o esquina) de píxel destino; centros en enteros."""
+        h, w = shape[0] + corners, shape[1] + corners
+        offset = 0.0 if corners else 0.5
+        nodes_r, nodes_c = _axis_nodes(h - 1, self.GRID), _axis_nodes(w - 1, self.GRID)
+        ys = transform.y0 + (nodes_r + offset) * transform.dy
+        xs = transform.x0 + (nodes_c + offset) * transform.dx
+        gx, gy = np.meshgrid(xs, ys)
+        sx, sy = self._to_source(gx, gy)
+        s = self.source.transform
+        src_cols = (np.asarray(sx) - s.x0) / s.dx - 0.5
+        src_rows = (np.asarray(sy) - s.y0) / s.dy - 0.5
+        rows, cols = np.arange(h, dtype=np.float64), np.arange(w, dtype=np.float64)
+        return (_interpolate(nodes_r, nodes_c, src_rows, rows, cols),
+                _interpolate(nodes_r, nodes_c, src_cols, rows, cols))
+
+    def read(self, window: Window, out_shape: Optional[Tuple[int, int]] = None) -> np.ndarray:
+        t = self.transform.window_transform(window)
+        if out_shape is not None:
+            # Lectura diezmada: la misma ventana en una rejilla virtual más gruesa
+            t = GeoTransform(t.x0, t.dx * window.width / out_shape[1], t.y0, t.dy * window.height / out_shape[0])
+        return self._warp(t, out_shape or (window.height, window.width))
+
+    def _source_window(self, rows: np.ndarray, cols: np.ndarray, margin: int) -> Optional[Window]:
+        finite = np.isfinite(rows) & np.isfinite(cols)
+        if not finite.any():
+            return None
+        h, w = self.source.shape
+        r0 = max(int(np.floor(rows[finite].min())) - margin, 0)
+        r1 = min(int(np.ceil(rows[finite].max())) + margin + 1, h)
+        c0 = max(int(np.floor(cols[finite].min())) - margin, 0)
+        c1 = min(int(np.ceil(cols[finite].max())) + margin + 1, w)
+        if r0 >= r1 or c0 >= c1:
+            return None
+        return Window(r0, c0, r1 - r0, c1 - c0)
+
+    def _valid(self, data: np.ndarray) -> np.ndarray:
+        valid = ~np.isnan(data) if data.dtype.kind == "f" else np.ones(data.shape, dtype=bool)
+        if self.source.nodata is not None:
+            valid &= data != self.source.nodata
+        return valid
+
+    def _warp(self, transform: GeoTransform, shape: Tuple[int, int]) -> np.ndarray:
+        out = np.full(shape, self.fill, dtype=self.dtype)
+        area = self.resampling in ("average", "sum")
+        rows, cols = self.source_pixels(transform, shape, corners=area)
+        window = self._source_window(rows, cols, 1)
+        if window is None:
+            return out
+        if area:
+            return self._area(rows, cols, window, out)
+
+        scale = 1.0
+        read_shape = None
+        step = min(window.height / shape[0], window.width / shape[1])
+        if step > 2:
+            # Mucho más grueso que el origen: lectura diezmada (vistas generales del COG)
+            scale = 1.0 / step
+            read_shape = (max(1, int(window.height * scale)), max(1, int(window.width * scale)))
+        data = self.source.read(window, read_shape)
+        # Coordenadas locales a la ventana leída (y a su diezmado)
+        ry = (rows - window.row + 0.5) * data.shape[0] / window.height - 0.5
+        rx = (cols - window.col + 0.5) * data.shape[1] / window.width - 0.5
+        valid = self._valid(data)
+        h, w = data.shape
+
+        if self.resampling == "nearest":
+            # Índices fuera del origen caen en un marco inválido alrededor de la ventana
+            i = np.clip(np.floor(ry + 0.5), -1, h).astype(np.int64) + 1
+            j = np.clip(np.floor(rx + 0.5), -1, w).astype(np.int64) + 1
+            mask = np.zeros((h + 2, w + 2), dtype=bool)
+            mask[1:-1, 1:-1] = valid
+            padded = np.zeros((h + 2, w + 2), dtype=data.dtype)
+            padded[1:-1, 1:-1] = data
+            idx = i * (w + 2) + j
+            take = mask.ravel()[idx]
+            out[take] = padded.ravel()[idx[take]]
+            return out
+
+        # Origen rodeado de un marco inválido: los 4 vecinos se leen sin comprobar bordes
+        values = np.zeros((h + 2, w + 2), dtype=np.float32)
+        weights = np.zeros((h + 2, w + 2), dtype=np.float32)
+        values[1:-1, 1:-1] = np.where(valid, data, 0)
+        weights[1:-1, 1:-1] = valid
+        values, weights = values.ravel(), weights.ravel()
+        i0 = np.clip(np.floor(ry), -1, h - 1)
+        j0 = np.clip(np.floor(rx), -1, w - 1)
+        fy = np.clip(ry - i0, 0.0, 1.0).astype(np.float32)
+        fx = np.clip(rx - j0, 0.0, 1.0).astype(np.float32)
+        base = (i0.astype(np.int64) + 1) * (w + 2) + j0.astype(np.int64) + 1
+        total = np.zeros(shape, dtype=np.float32)
+        weight = np.zeros(shape, dtype=np.float32)
+        for offset, wgt in ((0, (1 - fy) * (1 - fx)), (1, (1 - fy) * fx), (w + 2, fy * (1 - fx)), (w + 3, fy * fx)):
+            idx = base + offset
+            wgt *= weights[idx]
+            total += wgt * values[idx]
+            weight += wgt
+        ok = weight > 1e-6
+        out[ok] = total[ok] / weight[ok]
+        return out
+
+    def _area(self, rows: np.ndarray, cols: np.ndarray, window: Window, out: np.ndarray) -> np.ndarray:
+        """average / sum sobre la huella (caja envolvente de las 4 esquinas) de cada píxel destino."""
+        corner_r = np.stack([rows[:-1, :-1], rows[:-1, 1:], rows[1:, :-1], rows[1:, 1:]]) - window.row
+        corner_c = np.stack([cols[:-1, :-1], cols[:-1, 1:], cols[1:, :-1], cols[1:, 1:]]) - window.col
+        # Esquinas sin transformación válida (fuera del dominio de la proyección): píxel sin datos
+        lost = ~(np.isfinite(corner_r).all(axis=0) & np.isfinite(corner_c).all(axis=0))
+        corner_r, corner_c = np.nan_to_num(corner_r), np.nan_to_num(corner_c)
+        if self.resampling == "sum":
+            # Área de la huella en píxeles origen (fórmula del polígono de las 4 esquinas, en orden)
+            r, c = corner_r[[0, 1, 3, 2]], corner_c[[0, 1, 3, 2]]
+            footprint = 0.5 * np.abs((c * np.roll(r, -1, axis=0) - np.roll(c, -1, axis=0) * r).sum(axis=0))
+
+        read_shape = None
+        if window.height * window.width > self.AREA_MAX_PIXELS:
+            # Ventana enorme para un destino grueso: lectura diezmada (vistas generales del COG)
+            scale = math.sqrt(self.AREA_MAX_PIXELS / (window.height * window.width))
+            read_shape = (max(1, int(window.height * scale)), max(1, int(window.width * scale)))
+        data = self.source.read(window, read_shape)
+        if read_shape is not None:
+            # La muestra k del diezmado es el píxel origen k * alto / alto_leído
+            corner_r = corner_r * data.shape[0] / window.height
+            corner_c = corner_c * data.shape[1] / window.width
+        valid = self._valid(data)
+        values = np.where(valid, data, 0).astype(np.float64)
+        # Imágenes integrales de valores y conteos válidos (con una fila/columna de ceros delante)
+        S = np.zeros((data.shape[0] + 1, data.shape[1] + 1))
+        N = np.zeros_like(S)
+        S[1:, 1:] = values.cumsum(0).cumsum(1)
+        N[1:, 1:] = valid.cumsum(0).cumsum(1)
+
+        # Centros de píxel origen k con lo <= k < hi
+        lo_r, hi_r = np.ceil(corner_r.min(axis=0)), np.ceil(corner_r.max(axis=0))
+        lo_c, hi_c = np.ceil(corner_c.min(axis=0)), np.ceil(corner_c.max(axis=0))
+        i0, i1 = (np.clip(v, 0, data.shape[0]).astype(np.int64) for v in (lo_r, hi_r))
+        j0, j1 = (np.clip(v, 0, data.shape[1]).astype(np.int64) for v in (lo_c, hi_c))
+        total = S[i1, j1] - S[i0, j1] - S[i1, j0] + S[i0, j0]
+        count = N[i1, j1] - N[i0, j1] - N[i1, j0] + N[i0, j0]
+        if self.resampling == "sum":
+            # Densidad sobre todos los centros de la caja: los que caen fuera del origen o en nodata
+            # cuentan como 0, así que la parte de la huella sin datos no aporta masa
+            cells = (hi_r - lo_r) * (hi_c - lo_c)
+            mean = np.divide(total, cells, out=np.full(total.shape, np.nan), where=count > 0)
+        else:
+            mean = np.divide(total, count, out=np.full(total.shape, np.nan), where=count > 0)
+
+        # Píxel destino más fino que el origen (ningún centro dentro): el valor del píxel que lo contiene
+        empty = count == 0
+        if empty.any():
+            ci = np.floor(corner_r.mean(axis=0) + 0.5).astype(np.int64)
+            cj = np.floor(corner_c.mean(axis=0) + 0.5).astype(np.int64)
+            inside = empty & (ci >= 0) & (ci < data.shape[0]) & (cj >= 0) & (cj < data.shape[1])
+            ci, cj = np.clip(ci, 0, data.shape[0] - 1), np.clip(cj, 0, data.shape[1] - 1)
+            inside &= valid[ci, cj]
+            mean[inside] = values[ci[inside], cj[inside]]
+
+        if self.resampling == "sum":
+            mean *= footprint
+        ok = np.isfinite(mean) & ~lost
+        out[ok] = mean[ok]
+        return out
+
+
+def align(raster, like, resampling: str = "bilinear", nodata: Optional[float] = None):
+    """`raster` tal cual si ya comparte rejilla con `like`; si no, visto en la rejilla de `like`."""
+    if raster.shape == like.shape and raster.transform == like.transform and raster.crs == like.crs:
+        return raster
+    return WarpedRaster(raster, like.transform, like.shape, like.crs, resampling, nodata)
@@ -0,0 +1,188 @@
+import os
+import itertools
+import threading
+from collections import deque
+from concurrent.futures import Future, wait
+from typing import Any, Callable, Iterable, List, Optional
+
+
+class WorkStealingPool:
+    """
+    Planificador único (por proceso) para todos los kernels numéricos del motor.
+
+    Cada worker tiene su propia cola (deque): empuja y saca trabajo por el
+    extremo derecho (LIFO, localidad de caché) y, cuando se queda sin trabajo,
+    roba por el extremo izquierdo de las colas ajenas (FIFO, tareas grandes).
+    Las operaciones append/pop de deque son atómicas en CPython, así que las
+    colas no necesitan candado; solo el contador de pendientes lo usa.
+
+    Los kernels trabajan sobre bloques de arrays NumPy, cuyas operaciones
+    vectorizadas liberan el GIL: por eso los hilos escalan con los núcleos.
+    """
+
+    def __init__(self, max_workers: Optional[int] = None):
+        self.max_workers = max_workers or resolve_worker_count()
+        self._deques: List[deque] = [deque() for _ in range(self.max_workers)]
+        self._cv = threading.Condition()
+        self._pending = 0
+        self._local = threading.local()
+        self._round_robin = itertools.count()
+        self._threads: List[threading.Thread] = []
+        self._started = False
+        self._start_lock = threading.Lock()
+
+    # ------------------------------------------------------------------
+    # Ciclo de vida
+    # ------------------------------------------------------------------
+    def _ensure_started(self) -> None:
+        if self._started:
+            return
+        with self._start_lock:
+            if self._started:
+                return
+            for index in range(self.max_workers):
+                t = threading.Thread(
+                    target=self._worker_loop, args=(index,),
+                    name=f"geo-pool-{index}", daemon=True
+                )
+                t.start()
+                self._threads.append(t)
+            self._started = True
+
+    def in_worker(self) -> bool:
+        """True si el llamador ya es un hilo del pool (paralelismo anidado)."""
+        return getattr(self._local, "index", None) is not None
+
+    # ------------------------------------------------------------------
+    # Envío de trabajo
+    # ------------------------------------------------------------------
+    def submit(self, fn: Callable, *args, **kwargs) -> Future:
+        self._ensure_started()
+        future: Future = Future()
+        task = (future, fn, args, kwargs)
+
+        index = getattr(self._local, "index", None)
+        if index is None:
+            index = next(self._round_robin) % self.max_workers
+        self._deques[index].append(task)
+
+        with self._cv:
+            self._pending += 1
+            self._cv.notify()
+        return future
+
+    def map(self, fn: Callable, items: Iterable[Any]) -> List[Any]:
+        """
+        Ejecuta fn sobre cada elemento y devuelve los resultados en orden.
+
+        El llamador no se bloquea de brazos cruzados: mientras espera ejecuta
+        tareas pendientes. Así una llamada anidada desde un worker no puede
+        provocar deadlock ni crear hilos adicionales.
+        """
+        items = list(items)
+        if not items:
+            return []
+        if len(items) == 1 or self.max_workers == 1:
+            return [fn(item) for item in items]
+
+        futures = [self.submit(fn, item) for item in items]
+        self._help_until_done(futures)
+        return [f.result() for f in futures]
+
+    def stats(self) -> dict:
+        return {
+            "workers": self.max_workers,
+            "queued": sum(len(d) for d in self._deques),
+            "blas_threads": blas_thread_count(),
+        }
+
+    # ------------------------------------------------------------------
+    # Internos
+    # ------------------------------------------------------------------
+    def _take(self, index: Optional[int]):
+        if index is not None:
+            try:
+                return self._deques[index].pop()
+            except IndexError:
+                pass
+            start = index + 1
+        else:
+            start = 0
+        for offset in range(self.max_workers):
+            victim = self._deques[(start + offset) % self.max_workers]
+            try:
+                return victim.popleft()
+            except IndexError:
+                continue
+        return None
+
+    def _run(self, task) -> None:
+        with self._cv:
+            self._pending -= 1
+        future, fn, args, kwargs = task
+        if not future.set_running_or_notify_cancel():
+            return
+        try:
+            future.set_result(fn(*args, **kwargs))
+        except BaseException as exc:
+            future.set_exception(exc)
+
+    def _help_until_done(self, futures: List[Future]) -> None:
+        index = getattr(self._local, "index", None)
+        for future in futures:
+            while not future.done():
+                task = self._take(index)
+                if task is None:
+                    # Nada que robar: la tarea restante la ejecuta otro hilo
+                    wait([future], timeout=0.005)
+                    continue
+                self._run(task)
+
+    def _worker_loop(self, index: int) -> None:
+        self._local.index = index
+        while True:
+            task = self._take(index)
+            if task is None:
+                with self._cv:
+                    while self._pending == 0:
+                        self._cv.wait()
+                continue
+            self._run(task)
+
+
+def blas_thread_count() -> int:
+    """Hilos que BLAS/OpenMP usará dentro de cada llamada de NumPy."""
+    for var in ("OMP_NUM_THREADS", "OPENBLAS_NUM_THREADS", "MKL_NUM_THREADS"):
+        value = os.getenv(var)
+        if value and value.isdigit() and int(value) > 0:
+            return int(value)
+    return 1
+
+
+def resolve_worker_count() -> int:
+    """
+    Tamaño del pool coordinado con BLAS: workers x hilos_BLAS <= núcleos.
+    Respeta el cpuset del contenedor y el override GEO_POOL_WORKERS.
+    """
+    override = os.getenv("GEO_POOL_WORKERS")
+    if override and override.isdigit() and int(override) > 0:
+        return int(override)
+    try:
+        cores = len(os.sched_getaffinity(0))
+    except AttributeError:
+        cores = os.cpu_count() or 1
+    return max(1, cores // blas_thread_count())
+
+
+_pool: Optional[WorkStealingPool] = None
+_pool_lock = threading.Lock()
+
+
+def get_pool() -> WorkStealingPool:
+    """Instancia global: todos los motores del proceso comparten los mismos hilos."""
+    global _pool
+    if _pool is None:
+        with _pool_lock:
+            if _pool is None:
+                _pool = WorkStealingPool()
+    return _pool
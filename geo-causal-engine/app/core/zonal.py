@@ -0,0 +1,154 @@
+"""
+Medias zonales ponderadas por población.
+
+Los agregados sin ponderar dejan que los desiertos cálidos y vacíos dominen
+el promedio. Aquí cada capa (estrés, extraversión, responsabilidad...) se
+pondera por la población del píxel:
+
+    media_z = Σ pop·x / Σ pop      sobre los píxeles válidos de la zona z
+
+El ráster de población suele tener otra resolución y otro origen que las
+capas (mismo CRS). Se remuestrea a la rejilla de las capas por área,
+conservando la masa: con las matrices de solape por eje Ay (filas) y Ax
+(columnas), la población de la tesela destino es Ay · S · Axᵀ, exacto tanto
+si la población es más gruesa como más fina. Si la población está en otro
+CRS se reproyecta con app/core/warp.py (remuestreo `sum`, que conserva la
+masa), y las capas o zonas en otra rejilla se remuestrean a la de la
+primera capa (bilineal / vecino más próximo). Todo ocurre en una sola
+pasada por teselas en el pool: no se escribe ningún ráster intermedio.
+"""
+
+import math
+from typing import Dict, List, Optional, Tuple
+
+import numpy as np
+
+from app.core.raster_io import GeoTransform, Window, open_raster, tiles
+from app.core.warp import WarpedRaster, align
+from app.core.work_pool import get_pool
+
+# Zona única cuando no se pasa ráster de zonas
+WHOLE_EXTENT = 0
+
+
+def overlap_matrix(edges: np.ndarray, n_src: int) -> Tuple[int, np.ndarray]:
+    """
+    Fracción de cada celda origen cubierta por cada celda destino a lo largo de un eje.
+
+    `edges` son los bordes de las celdas destino en índices fraccionarios de
+    la rejilla origen. Devuelve (primer índice origen, matriz destino×origen).
+    """
+    lo = np.minimum(edges[:-1], edges[1:])
+    hi = np.maximum(edges[:-1], edges[1:])
+    j0 = max(0, int(math.floor(lo.min())))
+    j1 = min(n_src, int(math.ceil(hi.max())))
+    j = np.arange(j0, max(j0, j1))
+    m = np.minimum(hi[:, None], j + 1) - np.maximum(lo[:, None], j)
+    return j0, np.clip(m, 0.0, None)
+
+
+def resample_counts(source, source_transform: GeoTransform, target_transform: GeoTransform,
+                    window: Window) -> np.ndarray:
+    """Ráster de conteos (población) remuestreado por área a una ventana de la rejilla destino."""
+    s, t = source_transform, target_transform
+    x_edges = t.x0 + np.arange(window.col, window.col + window.width + 1) * t.dx
+    y_edges = t.y0 + np.arange(window.row, window.row + window.height + 1) * t.dy
+    c0, ax = overlap_matrix((x_edges - s.x0) / s.dx, source.shape[1])
+    r0, ay = overlap_matrix((y_edges - s.y0) / s.dy, source.shape[0])
+    if ax.shape[1] == 0 or ay.shape[1] == 0:
+        return np.zeros((window.height, window.width))
+
+    counts = source.read(Window(r0, c0, ay.shape[1], ax.shape[1])).astype(np.float64)
+    if source.nodata is not None:
+        counts[counts == source.nodata] = 0.0
+    np.nan_to_num(counts, copy=False, nan=0.0)
+    np.maximum(counts, 0.0, out=counts)
+    return ay @ counts @ ax.T
+
+
+class ZonalAggregator:
+    """Capas alineadas + población (remuestreada) + zonas -> medias ponderadas por zona."""
+
+    TILE = 256
+
+    def __init__(self, layers: Dict[str, str], population: str, zones: Optional[str] = None):
+        if not layers:
+            raise ValueError("Se necesita al menos una capa")
+        self.names = list(layers)
+        self.layers = [open_raster(path) for path in layers.values()]
+        self.population = open_raster(population)
+        self.zones = open_raster(zones) if zones else None
+        first = self.layers[0]
+        self.shape, self.transform = first.shape, first.transform
+        self.layers = [first] + [align(raster, first, "bilinear") for raster in self.layers[1:]]
+        if self.zones is not None:
+            self.zones = align(self.zones, first, "nearest", self.zones.nodata if self.zones.nodata is not None else -1)
+        if self.population.crs != first.crs:
+            self.population = WarpedRaster(self.population, first.transform, first.shape, first.crs, "sum")
+
+    def close(self) -> None:
+        for raster in self.layers + [self.population] + ([self.zones] if self.zones else []):
+            raster.close()
+
+    def _population(self, window: Window) -> np.ndarray:
+        if not isinstance(self.population, WarpedRaster):
+            return resample_counts(self.population, self.population.transform, self.transform, window)
+        counts = self.population.read(window).astype(np.float64)
+        if self.population.nodata is not None:
+            counts[counts == self.population.nodata] = 0.0
+        np.nan_to_num(counts, copy=False, nan=0.0)
+        return np.maximum(counts, 0.0, out=counts)
+
+    def _tile(self, window: Window):
+        pop = self._population(window).ravel()
+        if self.zones is not None:
+            zone = self.zones.read(window).ravel().astype(np.int64)
+            keep = zone != (self.zones.nodata if self.zones.nodata is not None else -1)
+            keep &= zone >= 0
+        else:
+            zone = np.full(pop.size, WHOLE_EXTENT, dtype=np.int64)
+            keep = np.ones(pop.size, dtype=bool)
+        ids, inverse = np.unique(zone[keep], return_inverse=True)
+
+        k = len(self.names)
+        # Columnas: Σpop·x, Σpop, Σx, n  por capa; más la población total de la zona
+        sums = np.zeros((ids.size, 4 * k + 1))
+        sums[:, -1] = np.bincount(inverse, weights=pop[keep], minlength=ids.size)
+        for j, raster in enumerate(self.layers):
+            x = raster.read(window).ravel()[keep].astype(np.float64)
+            valid = ~np.isnan(x)
+            if raster.nodata is not None:
+                valid &= x != raster.nodata
+            x = np.where(valid, x, 0.0)
+            w = np.where(valid, pop[keep], 0.0)
+            sums[:, 4 * j] = np.bincount(inverse, weights=w * x, minlength=ids.size)
+            sums[:, 4 * j + 1] = np.bincount(inverse, weights=w, minlength=ids.size)
+            sums[:, 4 * j + 2] = np.bincount(inverse, weights=x, minlength=ids.size)
+            sums[:, 4 * j + 3] = np.bincount(inverse, weights=valid, minlength=ids.size)
+        return ids, sums
+
+    def run(self) -> List[dict]:
+        parts = get_pool().map(self._tile, tiles(self.shape, self.TILE, self.TILE))
+        ids = np.concatenate([p[0] for p in parts])
+        sums = np.concatenate([p[1] for p in parts])
+        zones, inverse = np.unique(ids, return_inverse=True)
+        totals = np.zeros((zones.size, sums.shape[1]))
+        np.add.at(totals, inverse, sums)
+
+        out = []
+        for zone, row in zip(zones, totals):
+            entry = {"zone": int(zone), "population": round(float(row[-1]), 2)}
+            for j, name in enumerate(self.names):
+                wx, w, x, n = row[4 * j:4 * j + 4]
+                entry[name] = round(float(wx / w), 6) if w > 0 else None
+                entry[f"{name}_unweighted"] = round(float(x / n), 6) if n > 0 else None
+            out.append(entry)
+        return out
+
+
+def zonal_means(layers: Dict[str, str], population: str, zones: Optional[str] = None) -> List[dict]:
+    aggregator = ZonalAggregator(layers, population, zones)
+    try:
+        return aggregator.run()
+    finally:
+        aggregator.close()
@@ -1,47 +1,232 @@
-from fastapi import FastAPI
-from app.models.schemas import GeoPsychometricInput
-from app.core.spatial_metrics import SpatialStressCalculator
-from app.core.bayesian_model import PoliticalInferenceEngine # (Tu lógica causal)
+import os
+from contextlib import asynccontextmanager, nullcontext
+from typing import Optional
+from fastapi import FastAPI, Header, HTTPException
+from fastapi.responses import PlainTextResponse, Response
+from app.models.schemas import GeoPsychometricInput, SceneInput, ZonalInput
+from app.core.lazy import LazyEngine, preload_all
+from app.core.tracing import TracedRoute, TracingMiddleware, span
+from app.core import profiler
+
+# Motores pesados (numpy, pools, registro): se cargan en la primera petición que los usa
+stress_calculator = LazyEngine("app.core.spatial_metrics", "SpatialStressCalculator")
+political_registry = LazyEngine(
+    "app.core.bayesian_model", "registry",  # (Tu lógica causal, versionada)
+    on_load=lambda registry: registry.start_watcher()
+)
+band_math = LazyEngine("app.core.band_math", "derive_scene")
+hex_store = LazyEngine("app.core.hexgrid", "store")
+zonal_means = LazyEngine("app.core.zonal", "zonal_means")
+tile_service = LazyEngine("app.core.tiles", "service")
+
+# Las escenas se leen de disco local: solo rutas dentro de este directorio
+SCENES_DIR = os.path.realpath(os.getenv("GEO_SCENES_DIR", "/data/scenes"))
+
+
+def scene_path(name: str) -> str:
+    path = os.path.realpath(os.path.join(SCENES_DIR, name))
+    if os.path.commonpath([path, SCENES_DIR]) != SCENES_DIR:
+        raise HTTPException(status_code=400, detail=f"Ruta fuera de GEO_SCENES_DIR: {name}")
+    if not os.path.isfile(path):
+        raise HTTPException(status_code=404, detail=f"Banda no encontrada: {name}")
+    return path
+
+
+def derive_scene(scene: SceneInput) -> dict:
+    from app.core.band_math import CALIBRATIONS, Scene
+
+    bands = {k: scene_path(v) for k, v in scene.model_dump(exclude={"level"}).items() if v is not None}
+    try:
+        return band_math.get()(Scene(**bands, calibration=CALIBRATIONS[scene.level]))
+    except ValueError as e:
+        raise HTTPException(status_code=422, detail=str(e))
+
+
+@asynccontextmanager
+async def lifespan(app: FastAPI):
+    # Arranque en frío mínimo; GEO_PREWARM=1 precarga todo antes de aceptar peticiones
+    if os.getenv("GEO_PREWARM") == "1":
+        preload_all()
+    yield
+    if political_registry.loaded:
+        political_registry.get().stop_watcher()
+
 
 app = FastAPI(
     title="Geo-Causal Engine",
     version="1.0.0",
-    description="Motor Hexagonal de Inferencia: Teledetección Geoespacial + Psicometría"
+    description="Motor Hexagonal de Inferencia: Teledetección Geoespacial + Psicometría",
+    lifespan=lifespan
 )
+app.add_middleware(TracingMiddleware)
+app.router.route_class = TracedRoute
 
 @app.post("/infer-political-structure")
 def infer_structure(data: GeoPsychometricInput):
     # 1. Transformación de la capa física (Teledetección)
-    env_stress = SpatialStressCalculator.calculate_environmental_stress(
-        ndvi=data.ndvi_mean, 
-        lst=data.lst_mean_celsius
-    )
+    scene_summary = None
+    if data.scene is not None:
+        # Estrés medio píxel a píxel sobre la escena cruda (sin nubes)
+        with span("engine.band_math"):
+            scene_summary = derive_scene(data.scene)
+        if scene_summary["valid_pixels"] == 0:
+            raise HTTPException(status_code=422, detail="La escena no tiene píxeles válidos (todo nube o relleno)")
+        env_stress = scene_summary["stress_mean"]
+    else:
+        with span("engine.stress"):
+            env_stress = stress_calculator.get().calculate_environmental_stress(
+                ndvi=data.ndvi_mean, 
+                lst=data.lst_mean_celsius
+            )
     
     # 2. Inferencia Causal (Hexágono central puro)
     # Alta extraversión + Alto estrés geográfico = Probabilidad de Caudillismo (Patria)
     # Alta responsabilidad + Alto estrés geográfico = Probabilidad de Institucionalidad (Nación)
-    
-    nation_score = (data.conscientiousness_agg * 1.5) + (env_stress * 0.5) - data.extraversion_agg
-    patria_score = (data.extraversion_agg * 1.5) + (env_stress * 0.8) - data.conscientiousness_agg
-    
-    # Función Softmax simplificada para probabilidad
-    import numpy as np
-    total = np.exp(nation_score) + np.exp(patria_score)
-    prob_nation = np.exp(nation_score) / total
-    prob_patria = np.exp(patria_score) / total
+    # La versión del modelo queda fijada durante toda la petición
+    with political_registry.get().lease() as model, span("engine.political", model_version=model.version):
+        inference = model.engine.calculate_synthesis(
+            conscientiousness=data.conscientiousness_agg,
+            extraversion=data.extraversion_agg,
+            env_stress=env_stress
+        )
+    prob_nation = inference["probability_nation"]
+    prob_patria = inference["probability_patria"]
     
     synthesis = "Nación (Institucional)" if prob_nation > prob_patria else "Patria (Caudillista/Folclórica)"
 
     return {
         "telemetry_inputs": data.dict(),
+        "scene_summary": scene_summary,
         "calculated_environmental_stress": env_stress,
         "causal_inference": {
-            "probability_nation": round(prob_nation, 4),
-            "probability_patria": round(prob_patria, 4)
+            "probability_nation": prob_nation,
+            "probability_patria": prob_patria
         },
-        "emergent_synthesis": synthesis
+        "emergent_synthesis": synthesis,
+        "model_version": model.version
     }
 
+@app.post("/infer-zonal")
+def infer_zonal(data: ZonalInput):
+    # Medias ponderadas por población por zona -> misma inferencia causal, una por zona
+    paths = {k: scene_path(v) for k, v in data.model_dump().items() if v is not None}
+    population, zones = paths.pop("population"), paths.pop("zones", None)
+    with span("engine.zonal"):
+        try:
+            rows = zonal_means.get()(paths, population, zones)
+        except ValueError as e:
+            raise HTTPException(status_code=422, detail=str(e))
+
+    results = []
+    with political_registry.get().lease() as model, span("engine.political", model_version=model.version, zones=len(rows)):
+        for row in rows:
+            if None in (row["stress"], row["extraversion"], row["conscientiousness"]):
+                results.append({"zonal": row, "causal_inference": None})
+                continue
+            results.append({"zonal": row, "causal_inference": model.engine.calculate_synthesis(
+                conscientiousness=row["conscientiousness"],
+                extraversion=row["extraversion"],
+                env_stress=row["stress"]
+            )})
+    return {"zones": results, "model_version": model.version}
+
+
+def parse_hex(cell: str) -> int:
+    try:
+        return hex_store.get().parse_cell(cell)
+    except ValueError:
+        raise HTTPException(status_code=422, detail=f"Celda H3 inválida: {cell}")
+
+
+def hex_cell(cell: str) -> dict:
+    row = hex_store.get().cell(parse_hex(cell))
+    if row is None:
+        raise HTTPException(status_code=404, detail=f"Celda sin datos: {cell}")
+    return row
+
+
+@app.get("/hex/{cell}")
+def hex_aggregates(cell: str, children_res: Optional[int] = None, limit: int = 1000):
+    # Agregados de la celda y, opcionalmente, de sus descendientes a `children_res` (un rango contiguo)
+    row = hex_cell(cell)
+    if children_res is None:
+        return row
+    try:
+        children = hex_store.get().children(parse_hex(cell), children_res, min(limit, 10000))
+    except (KeyError, ValueError) as e:
+        raise HTTPException(status_code=422, detail=str(e))
+    return {**row, "children": children}
+
+
+@app.get("/hex/{cell}/infer")
+def infer_hex(cell: str):
+    # Misma inferencia que /infer-political-structure, sobre los agregados de una celda H3
+    row = hex_cell(cell)
+    missing = [k for k in ("stress", "extraversion", "conscientiousness") if row.get(k) is None]
+    if missing:
+        raise HTTPException(status_code=422, detail=f"La celda no tiene las capas: {', '.join(missing)}")
+    with political_registry.get().lease() as model, span("engine.political", model_version=model.version):
+        inference = model.engine.calculate_synthesis(
+            conscientiousness=row["conscientiousness"],
+            extraversion=row["extraversion"],
+            env_stress=row["stress"]
+        )
+    return {"hex": row, "causal_inference": inference, "model_version": model.version}
+
+
+@app.get("/tiles/{layer}/{z}/{x}/{y}.png")
+def map_tile(layer: str, z: int, x: int, y: int, if_none_match: Optional[str] = Header(None)):
+    # Teselas XYZ de las capas precalculadas; nation/patria con la versión activa del modelo
+    from app.core.tiles import LAYERS, valid_tile
+
+    if layer not in LAYERS:
+        raise HTTPException(status_code=404, detail=f"Capa desconocida: {layer} ({', '.join(LAYERS)})")
+    if not valid_tile(z, x, y):
+        raise HTTPException(status_code=404, detail=f"Tesela fuera de rango: {z}/{x}/{y}")
+    service = tile_service.get()
+    lease = political_registry.get().lease() if LAYERS[layer].derived else nullcontext()
+    with lease as model, span("engine.tiles", layer=layer, z=z):
+        try:
+            version = service.version(layer, model)
+            etag = service.etag(version, z, x, y)
+            headers = {"ETag": etag, "Cache-Control": "public, no-cache"}
+            # Revalidación sin renderizar: el ETag solo depende de la versión de la capa
+            if if_none_match and etag in (t.strip().removeprefix("W/") for t in if_none_match.split(",")):
+                return Response(status_code=304, headers=headers)
+            png = service.tile(layer, version, z, x, y, model)
+        except FileNotFoundError as e:
+            raise HTTPException(status_code=404, detail=str(e))
+        except ValueError as e:
+            raise HTTPException(status_code=422, detail=str(e))
+    return Response(png, media_type="image/png", headers=headers)
+
+
+@app.post("/admin/profile")
+def admin_profile(
+    seconds: float = 10.0,
+    hz: int = 100,
+    format: str = "collapsed",
+    mode: str = "auto",
+    x_admin_token: Optional[str] = Header(None)
+):
+    # Muestreo acotado del worker: collapsed (flamegraph.pl/speedscope) o svg
+    if not profiler.check_token(x_admin_token):
+        raise HTTPException(status_code=403, detail="Token de administración inválido")
+    if format not in ("collapsed", "svg") or mode not in ("auto", "native", "python"):
+        raise HTTPException(status_code=422, detail="format: collapsed|svg, mode: auto|native|python")
+    try:
+        stacks, backend = profiler.profile(seconds, hz, mode)
+    except profiler.ProfilerBusy as e:
+        raise HTTPException(status_code=409, detail=str(e))
+    except RuntimeError as e:
+        raise HTTPException(status_code=501, detail=f"Perfil nativo no disponible: {e}")
+
+    headers = {"X-Profiler-Backend": backend}
+    if format == "svg":
+        svg = profiler.flamegraph_svg(stacks, title=f"geo-causal-engine ({backend}, {seconds}s)")
+        return Response(svg, media_type="image/svg+xml", headers=headers)
+    return PlainTextResponse(profiler.collapsed(stacks), headers=headers)
+
 @app.get("/health")
 def health_check():
     return {"status": "Geo-Causal Engine Operativo. Sensores calibrados."}
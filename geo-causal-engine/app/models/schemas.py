@@ -1,10 +1,38 @@
-from pydantic import BaseModel, Field
+from typing import Literal, Optional
+
+from pydantic import BaseModel, Field, model_validator
+
+
+class SceneInput(BaseModel):
+    # Bandas crudas de una escena local (rutas relativas a GEO_SCENES_DIR)
+    red: str = Field(..., description="Banda roja (Landsat 8/9: B4)")
+    nir: str = Field(..., description="Infrarrojo cercano (B5)")
+    thermal: str = Field(..., description="Infrarrojo térmico (B10)")
+    qa: Optional[str] = Field(None, description="QA_PIXEL: se descartan nubes, sombras, cirros y relleno")
+    level: Literal["L1", "L2"] = Field("L2", description="Producto Collection 2: L1 (TOA y radiancia) o L2 (SR_B* y ST_B10)")
+
 
 class GeoPsychometricInput(BaseModel):
-    # Variables Espaciales (Teledetección - Obtenidas por ej. de Google Earth Engine)
-    ndvi_mean: float = Field(..., description="Índice de Vegetación de Diferencia Normalizada promedio (Abundancia de recursos)", ge=-1.0, le=1.0)
-    lst_mean_celsius: float = Field(..., description="Land Surface Temperature (Estrés térmico)")
+    # Variables Espaciales (Teledetección): promedios ya calculados o la escena cruda en `scene`
+    ndvi_mean: Optional[float] = Field(None, description="Índice de Vegetación de Diferencia Normalizada promedio (Abundancia de recursos)", ge=-1.0, le=1.0)
+    lst_mean_celsius: Optional[float] = Field(None, description="Land Surface Temperature (Estrés térmico)")
+    scene: Optional[SceneInput] = Field(None, description="Escena cruda: NDVI, LST y estrés se derivan píxel a píxel")
 
     # Variables Psicométricas (Provenientes de tu people-analytics-etl)
     extraversion_agg: float = Field(..., description="Agregado poblacional de Extraversión (Hedonismo/Gregarismo)", ge=0, le=1)
     conscientiousness_agg: float = Field(..., description="Agregado poblacional de Responsabilidad (Planificación)", ge=0, le=1)
+
+    @model_validator(mode="after")
+    def _remote_sensing_source(self):
+        if self.scene is None and (self.ndvi_mean is None or self.lst_mean_celsius is None):
+            raise ValueError("Se requiere ndvi_mean y lst_mean_celsius, o bien scene")
+        return self
+
+
+class ZonalInput(BaseModel):
+    # Capas alineadas (rutas relativas a GEO_SCENES_DIR); la población puede tener otra resolución
+    stress: str = Field(..., description="Estrés ambiental (p.ej. salida de la escena cruda)")
+    extraversion: str = Field(..., description="Extraversión interpolada por píxel")
+    conscientiousness: str = Field(..., description="Responsabilidad interpolada por píxel")
+    population: str = Field(..., description="Conteo de población por celda (mismo CRS)")
+    zones: Optional[str] = Field(None, description="Ráster de ids de zona alineado con las capas (sin él: una sola zona)")
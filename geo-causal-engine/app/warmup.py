@@ -0,0 +1,35 @@
+"""
+Ruta de arranque pre-calentada del Geo-Causal Engine.
+
+    python -m app.warmup
+
+1. Compila a bytecode todo el paquete (se ejecuta en el build de la imagen,
+   así el primer arranque no paga la compilación de .pyc).
+2. Precarga los motores perezosos y ejecuta una inferencia de referencia.
+   En el build esto solo verifica que los motores cargan: el proceso termina y
+   el contenedor arranca en frío igualmente. Para pagar la carga antes de la
+   primera petición usa GEO_PREWARM=1 al arrancar.
+"""
+
+import compileall
+import json
+import os
+import time
+
+
+def warm() -> dict:
+    from app.main import political_registry, stress_calculator
+    from app.core.lazy import preload_all
+
+    timings = preload_all()
+    start = time.perf_counter()
+    stress = stress_calculator.get().calculate_environmental_stress(ndvi=0.3, lst=30.0)
+    with political_registry.get().lease() as model:
+        model.engine.calculate_synthesis(conscientiousness=0.5, extraversion=0.5, env_stress=stress)
+    timings["reference_inference"] = round(time.perf_counter() - start, 4)
+    return timings
+
+
+if __name__ == "__main__":
+    compileall.compile_dir(os.path.dirname(os.path.abspath(__file__)), quiet=1)
+    print(json.dumps(warm(), indent=2))
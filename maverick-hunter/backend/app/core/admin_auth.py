@@ -0,0 +1,27 @@
+"""
+Admin token check shared by every /admin route
+
+The token is PROFILER_TOKEN (the profiler was the first admin endpoint);
+without it the whole admin API answers 403.
+"""
+
+import hmac
+import os
+from typing import Optional
+
+from fastapi import Header, HTTPException
+
+ADMIN_TOKEN = os.getenv("PROFILER_TOKEN") or None
+
+
+def check_token(token: Optional[str]) -> bool:
+    """Constant-time compare; without PROFILER_TOKEN every token is rejected"""
+    if ADMIN_TOKEN is None or token is None:
+        return False
+    return hmac.compare_digest(token.encode(), ADMIN_TOKEN.encode())
+
+
+def require_admin(x_admin_token: Optional[str] = Header(None)) -> None:
+    """Router dependency for /admin"""
+    if not check_token(x_admin_token):
+        raise HTTPException(status_code=403, detail="Invalid admin token")
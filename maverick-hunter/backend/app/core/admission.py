@@ -0,0 +1,270 @@
+"""
+Admission control - per-tenant rate limits and weighted fair queueing
+
+Every /api request must carry `X-API-Key` for an active Company (checked
+against the in-memory key table, see api_keys.py). Admission then happens in
+two stages:
+
+1. Token bucket per (company, traffic class). Over-rate requests get 429
+   with Retry-After immediately; they never occupy a queue slot.
+2. A fixed number of execution slots shared by everyone. When all slots are
+   busy, requests wait in per-class queues (interactive / batch, chosen via
+   `X-Traffic-Class`) that are served by stride scheduling with weights
+   (default 4:1), and round-robin across tenants inside each class. A full
+   queue or a wait longer than the class timeout is answered with 429.
+
+A single tenant saturating the batch class therefore only ever gets its
+batch share of the slots, and interactive requests from other tenants are
+dispatched ahead of its backlog.
+
+A slot is held until the response body is fully sent, streamed bodies
+included. Streaming exports are therefore always batch traffic, whatever
+header they carry (BATCH_PATHS).
+
+Slots must not exceed what the backend really runs in parallel: any excess
+just moves the queue somewhere unfair (the GIL starving the event loop, the
+SQLite write lock, the connection pool). See default_slots().
+
+All bucket, queue and counter state is mutated on the event loop thread
+only, so none of it needs a lock.
+"""
+
+import asyncio
+import json
+import math
+import os
+import time
+from collections import OrderedDict, deque
+from typing import Any, Callable, Deque, Dict, Optional, Tuple
+
+from app.core.api_keys import key_table
+
+INTERACTIVE = "interactive"
+BATCH = "batch"
+
+ENABLED = os.getenv("ADMISSION_CONTROL", "1") == "1"
+CLASS_WEIGHTS = {INTERACTIVE: 4, BATCH: 1}
+CLASS_RATES = {  # (tokens per second, burst) per company
+    INTERACTIVE: (float(os.getenv("ADMISSION_INTERACTIVE_RPS", "20")), float(os.getenv("ADMISSION_INTERACTIVE_BURST", "40"))),
+    BATCH: (float(os.getenv("ADMISSION_BATCH_RPS", "100")), float(os.getenv("ADMISSION_BATCH_BURST", "200"))),
+}
+MAX_QUEUE = {INTERACTIVE: 256, BATCH: 2048}
+QUEUE_TIMEOUT = {INTERACTIVE: 2.0, BATCH: 30.0}
+
+# Paths served without a tenant (health checks, docs, token-protected admin)
+PUBLIC_PREFIXES = ("/health", "/docs", "/redoc", "/openapi.json", "/admin")
+# Long-running streamed responses: always admitted as batch
+BATCH_PATHS = ("/api/v1/results/export",)
+
+
+def default_slots() -> int:
+    """ADMISSION_SLOTS, else one per core on SQLite or the connection pool size on Postgres"""
+    if os.getenv("ADMISSION_SLOTS"):
+        return int(os.getenv("ADMISSION_SLOTS"))
+    from app.models.database import engine
+
+    if engine.dialect.name == "sqlite":
+        if hasattr(os, "sched_getaffinity"):  # Linux only: honours taskset / cgroup cpusets
+            return len(os.sched_getaffinity(0))
+        return os.cpu_count() or 1
+    return engine.pool.size()
+
+
+SLOTS = default_slots()
+
+
+class Rejected(Exception):
+    def __init__(self, status: int, detail: str, retry_after: float = 1.0):
+        super().__init__(detail)
+        self.status = status
+        self.detail = detail
+        self.retry_after = retry_after
+
+
+class TokenBucket:
+    __slots__ = ("rate", "burst", "tokens", "stamp")
+
+    def __init__(self, rate: float, burst: float):
+        self.rate = rate
+        self.burst = burst
+        self.tokens = burst
+        self.stamp = time.monotonic()
+
+    def take(self, now: float) -> float:
+        """Consume one token; returns 0 if admitted, else seconds until one is available"""
+        self.tokens = min(self.burst, self.tokens + (now - self.stamp) * self.rate)
+        self.stamp = now
+        if self.tokens >= 1.0:
+            self.tokens -= 1.0
+            return 0.0
+        return (1.0 - self.tokens) / self.rate
+
+
+class TenantStats:
+    __slots__ = ("admitted", "rate_limited", "shed")
+
+    def __init__(self):
+        self.admitted = 0
+        self.rate_limited = 0
+        self.shed = 0
+
+
+class FairScheduler:
+    """Execution slots + weighted fair queues (stride across classes, round-robin across tenants)"""
+
+    def __init__(self, slots: int = SLOTS, weights: Dict[str, int] = CLASS_WEIGHTS):
+        self.free = slots
+        self.weights = weights
+        self.queues: Dict[str, "OrderedDict[str, Deque[asyncio.Future]]"] = {c: OrderedDict() for c in weights}
+        self.depth = {c: 0 for c in weights}
+        self.passes = {c: 0.0 for c in weights}
+        self.virtual_time = 0.0
+
+    async def acquire(self, traffic_class: str, tenant: str) -> None:
+        if self.free > 0 and not any(self.depth.values()):
+            self.free -= 1
+            return
+        if self.depth[traffic_class] >= MAX_QUEUE[traffic_class]:
+            raise Rejected(429, f"{traffic_class} queue full", retry_after=1.0)
+
+        if self.depth[traffic_class] == 0:
+            # An idle class re-enters at the current virtual time: no banked credit
+            self.passes[traffic_class] = max(self.passes[traffic_class], self.virtual_time)
+        waiter = asyncio.get_running_loop().create_future()
+        self.queues[traffic_class].setdefault(tenant, deque()).append(waiter)
+        self.depth[traffic_class] += 1
+        try:
+            await asyncio.wait_for(asyncio.shield(waiter), QUEUE_TIMEOUT[traffic_class])
+        except (asyncio.TimeoutError, asyncio.CancelledError) as exc:
+            if waiter.done() and not waiter.cancelled():
+                self.release()  # granted at the same moment we gave up: hand the slot on
+            else:
+                waiter.cancel()
+                self._forget(traffic_class, tenant, waiter)
+            if isinstance(exc, asyncio.CancelledError):
+                raise
+            raise Rejected(429, f"{traffic_class} queue timeout", retry_after=1.0)
+
+    def release(self) -> None:
+        waiter = self._next()
+        if waiter is None:
+            self.free += 1
+        else:
+            waiter.set_result(None)
+
+    def _next(self) -> Optional[asyncio.Future]:
+        ready = [c for c in self.queues if self.depth[c]]
+        if not ready:
+            return None
+        traffic_class = min(ready, key=lambda c: self.passes[c])
+        self.virtual_time = self.passes[traffic_class]
+        self.passes[traffic_class] += 1.0 / self.weights[traffic_class]
+
+        tenants = self.queues[traffic_class]
+        tenant, waiters = next(iter(tenants.items()))
+        waiter = waiters.popleft()
+        self.depth[traffic_class] -= 1
+        del tenants[tenant]
+        if waiters:
+            tenants[tenant] = waiters  # back of the round-robin
+        return waiter
+
+    def _forget(self, traffic_class: str, tenant: str, waiter: asyncio.Future) -> None:
+        waiters = self.queues[traffic_class].get(tenant)
+        if waiters is not None and waiter in waiters:
+            waiters.remove(waiter)
+            self.depth[traffic_class] -= 1
+            if not waiters:
+                del self.queues[traffic_class][tenant]
+
+
+class AdmissionController:
+    def __init__(self, resolve: Callable[[str], Optional[str]] = key_table.authenticate, slots: int = SLOTS):
+        self.resolve = resolve
+        self.scheduler = FairScheduler(slots)
+        self.buckets: Dict[Tuple[str, str], TokenBucket] = {}
+        self.stats: Dict[str, TenantStats] = {}
+
+    async def admit(self, api_key: Optional[str], traffic_class: str) -> str:
+        """Returns the tenant id once a slot is held; caller must release()"""
+        if not api_key:
+            raise Rejected(401, "Missing X-API-Key")
+        tenant = self.resolve(api_key)
+        if tenant is None:
+            raise Rejected(401, "Invalid API key")
+        stats = self.stats.get(tenant)
+        if stats is None:
+            stats = self.stats[tenant] = TenantStats()
+
+        bucket = self.buckets.get((tenant, traffic_class))
+        if bucket is None:
+            bucket = self.buckets[(tenant, traffic_class)] = TokenBucket(*CLASS_RATES[traffic_class])
+        wait = bucket.take(time.monotonic())
+        if wait:
+            stats.rate_limited += 1
+            raise Rejected(429, f"{traffic_class} rate limit exceeded", retry_after=wait)
+
+        try:
+            await self.scheduler.acquire(traffic_class, tenant)
+        except Rejected:
+            stats.shed += 1
+            raise
+        stats.admitted += 1
+        return tenant
+
+    def release(self) -> None:
+        self.scheduler.release()
+
+    def status(self) -> Dict[str, Any]:
+        return {
+            "free_slots": self.scheduler.free,
+            "queued": dict(self.scheduler.depth),
+            "tenants": {t: {"admitted": s.admitted, "rate_limited": s.rate_limited, "shed": s.shed}
+                        for t, s in self.stats.items()},
+        }
+
+
+controller = AdmissionController()
+
+
+class AdmissionMiddleware:
+    """Pure ASGI middleware; exposes the tenant as request.state.company_id"""
+
+    def __init__(self, app, admission: AdmissionController = controller):
+        self.app = app
+        self.admission = admission
+
+    async def __call__(self, scope, receive, send):
+        if (not ENABLED or scope["type"] != "http" or scope["method"] == "OPTIONS"
+                or scope["path"] == "/" or scope["path"].startswith(PUBLIC_PREFIXES)):
+            await self.app(scope, receive, send)
+            return
+
+        api_key = None
+        traffic_class = BATCH if scope["path"] in BATCH_PATHS else INTERACTIVE
+        for key, value in scope["headers"]:
+            if key == b"x-api-key":
+                api_key = value.decode("latin-1")
+            elif key == b"x-traffic-class" and value == b"batch":
+                traffic_class = BATCH
+
+        try:
+            tenant = await self.admission.admit(api_key, traffic_class)
+        except Rejected as rejected:
+            await _reject(send, rejected)
+            return
+
+        scope.setdefault("state", {})["company_id"] = tenant
+        try:
+            await self.app(scope, receive, send)
+        finally:
+            self.admission.release()
+
+
+async def _reject(send, rejected: Rejected) -> None:
+    body = json.dumps({"detail": rejected.detail}).encode()
+    headers = [(b"content-type", b"application/json"), (b"content-length", str(len(body)).encode())]
+    if rejected.status == 429:
+        headers.append((b"retry-after", str(max(1, math.ceil(rejected.retry_after))).encode()))
+    await send({"type": "http.response.start", "status": rejected.status, "headers": headers})
+    await send({"type": "http.response.body", "body": body})
@@ -0,0 +1,231 @@
+"""
+API key table - in-memory, hashed, refreshed from database change events
+
+Loaded once at startup and kept current incrementally:
+- PostgreSQL: an AFTER trigger on `companies` calls pg_notify('company_keys',
+  id) and a listener thread reloads just those rows.
+- SQLite: the same triggers append to `company_key_changes`, which a thread
+  polls every API_KEY_POLL_SECONDS for rows past the last seen sequence.
+After a listener reconnect the whole table is reloaded (notifications sent
+while disconnected are lost).
+
+Only SHA-256 digests of keys are held in memory. Authentication is one hash,
+one dict lookup and a constant-time digest compare: no query, no threadpool
+hop. Writers (the refresh thread) take a lock; readers never do.
+"""
+
+import hashlib
+import hmac
+import logging
+import os
+import select
+import threading
+import time
+from typing import Any, Dict, Iterable, Optional, Set
+
+from sqlalchemy import text
+
+logger = logging.getLogger(__name__)
+
+CHANNEL = "company_keys"
+POLL_SECONDS = float(os.getenv("API_KEY_POLL_SECONDS", "1.0"))
+CHANGELOG_KEEP = 10_000
+
+POSTGRES_CHANGE_FEED = [
+    f"""
+    CREATE OR REPLACE FUNCTION notify_company_keys() RETURNS trigger AS $$
+    BEGIN
+        PERFORM pg_notify('{CHANNEL}', COALESCE(NEW.id, OLD.id)::text);
+        RETURN NULL;
+    END $$ LANGUAGE plpgsql
+    """,
+    "DROP TRIGGER IF EXISTS company_keys_notify ON companies",
+    """
+    CREATE TRIGGER company_keys_notify AFTER INSERT OR UPDATE OR DELETE ON companies
+    FOR EACH ROW EXECUTE FUNCTION notify_company_keys()
+    """,
+]
+
+SQLITE_CHANGE_FEED = [
+    "CREATE TABLE IF NOT EXISTS company_key_changes (seq INTEGER PRIMARY KEY AUTOINCREMENT, company_id TEXT)",
+    """CREATE TRIGGER IF NOT EXISTS company_keys_insert AFTER INSERT ON companies
+       BEGIN INSERT INTO company_key_changes (company_id) VALUES (NEW.id); END""",
+    """CREATE TRIGGER IF NOT EXISTS company_keys_update AFTER UPDATE ON companies
+       BEGIN INSERT INTO company_key_changes (company_id) VALUES (NEW.id); END""",
+    """CREATE TRIGGER IF NOT EXISTS company_keys_delete AFTER DELETE ON companies
+       BEGIN INSERT INTO company_key_changes (company_id) VALUES (OLD.id); END""",
+]
+
+
+def digest(api_key: str) -> bytes:
+    return hashlib.sha256(api_key.encode()).digest()
+
+
+class KeyEntry:
+    __slots__ = ("digest", "company_id")
+
+    def __init__(self, key_digest: bytes, company_id: str):
+        self.digest = key_digest
+        self.company_id = company_id
+
+
+class KeyUsage:
+    __slots__ = ("requests", "last_used")
+
+    def __init__(self):
+        self.requests = 0
+        self.last_used = 0.0
+
+
+class ApiKeyTable:
+    def __init__(self, engine=None):
+        self._engine = engine
+        self._by_digest: Dict[bytes, KeyEntry] = {}
+        self._by_company: Dict[str, bytes] = {}
+        self.usage: Dict[str, KeyUsage] = {}
+        self.invalid_attempts = 0
+        self._write_lock = threading.Lock()
+        self._stop = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+        self._last_seq = 0
+
+    @property
+    def engine(self):
+        if self._engine is None:
+            from app.models.database import engine
+            self._engine = engine
+        return self._engine
+
+    # ------------------------------------------------------------------
+    # Read path
+    # ------------------------------------------------------------------
+    def authenticate(self, api_key: str) -> Optional[str]:
+        """Company id for an active key, else None"""
+        key_digest = digest(api_key)
+        entry = self._by_digest.get(key_digest)
+        if entry is None or not hmac.compare_digest(entry.digest, key_digest):
+            self.invalid_attempts += 1
+            return None
+        usage = self.usage.get(entry.company_id)
+        if usage is None:
+            usage = self.usage[entry.company_id] = KeyUsage()
+        usage.requests += 1
+        usage.last_used = time.time()
+        return entry.company_id
+
+    def status(self) -> Dict[str, Any]:
+        return {
+            "keys": len(self._by_digest),
+            "invalid_attempts": self.invalid_attempts,
+            "usage": {c: {"requests": u.requests, "last_used": u.last_used}
+                      for c, u in self.usage.items()},
+        }
+
+    # ------------------------------------------------------------------
+    # Refresh
+    # ------------------------------------------------------------------
+    def reload(self, company_ids: Optional[Iterable[str]] = None) -> None:
+        """Reload all companies, or only the given ids (missing rows are dropped)"""
+        query = "SELECT id, api_key, is_active FROM companies"
+        params: Dict[str, Any] = {}
+        if company_ids is not None:
+            ids = sorted(set(company_ids))
+            if not ids:
+                return
+            params = {f"id{i}": cid for i, cid in enumerate(ids)}
+            query += " WHERE id IN (" + ", ".join(f":{p}" for p in params) + ")"
+        with self.engine.connect() as conn:
+            rows = conn.execute(text(query), params).fetchall()
+
+        with self._write_lock:
+            seen: Set[str] = set()
+            for company_id, api_key, is_active in rows:
+                company_id = str(company_id)
+                seen.add(company_id)
+                self._drop(company_id)
+                if api_key and is_active:
+                    key_digest = digest(api_key)
+                    self._by_digest[key_digest] = KeyEntry(key_digest, company_id)
+                    self._by_company[company_id] = key_digest
+            stale = (set(self._by_company) if company_ids is None else set(ids)) - seen
+            for company_id in stale:
+                self._drop(company_id)
+
+    def _drop(self, company_id: str) -> None:
+        old = self._by_company.pop(company_id, None)
+        if old is not None:
+            self._by_digest.pop(old, None)
+
+    # ------------------------------------------------------------------
+    # Change feed
+    # ------------------------------------------------------------------
+    def install_change_feed(self) -> None:
+        statements = POSTGRES_CHANGE_FEED if self.engine.dialect.name == "postgresql" else SQLITE_CHANGE_FEED
+        with self.engine.begin() as conn:
+            for statement in statements:
+                conn.execute(text(statement))
+
+    def start(self) -> None:
+        if self._thread is not None and self._thread.is_alive():
+            return
+        self.install_change_feed()
+        if self.engine.dialect.name != "postgresql":
+            with self.engine.connect() as conn:
+                self._last_seq = conn.execute(text("SELECT COALESCE(MAX(seq), 0) FROM company_key_changes")).scalar()
+        self.reload()
+        target = self._listen if self.engine.dialect.name == "postgresql" else self._poll
+        self._stop.clear()
+        self._thread = threading.Thread(target=target, name="api-key-refresh", daemon=True)
+        self._thread.start()
+
+    def stop(self) -> None:
+        self._stop.set()
+
+    def _listen(self) -> None:
+        """LISTEN on a dedicated connection; full reload after every (re)connect"""
+        while not self._stop.is_set():
+            raw = None
+            try:
+                raw = self.engine.raw_connection()
+                conn = raw.driver_connection
+                conn.autocommit = True
+                conn.cursor().execute(f"LISTEN {CHANNEL}")
+                self.reload()
+                while not self._stop.is_set():
+                    if select.select([conn], [], [], 1.0) == ([], [], []):
+                        continue
+                    conn.poll()
+                    changed = {n.payload for n in conn.notifies}
+                    conn.notifies.clear()
+                    self.reload(changed)
+            except Exception:
+                logger.exception("API key listener failed; reconnecting")
+                self._stop.wait(POLL_SECONDS)
+            finally:
+                if raw is not None:
+                    raw.invalidate()
+
+    def _poll(self) -> None:
+        while not self._stop.wait(POLL_SECONDS):
+            try:
+                self.poll_once()
+            except Exception:
+                logger.exception("API key refresh failed; keeping current table")
+
+    def poll_once(self) -> None:
+        with self.engine.connect() as conn:
+            rows = conn.execute(
+                text("SELECT seq, company_id FROM company_key_changes WHERE seq > :seq ORDER BY seq"),
+                {"seq": self._last_seq},
+            ).fetchall()
+        if not rows:
+            return
+        self.reload(company_id for _, company_id in rows)
+        self._last_seq = rows[-1][0]
+        if self._last_seq % CHANGELOG_KEEP < len(rows):
+            with self.engine.begin() as conn:
+                conn.execute(text("DELETE FROM company_key_changes WHERE seq <= :seq"),
+                             {"seq": self._last_seq - CHANGELOG_KEEP})
+
+
+key_table = ApiKeyTable()
@@ -124,10 +124,16 @@ PSYCAP_ITEMS: List[AssessmentItem] = [
 # All items combined
 ALL_ITEMS = SD4_ITEMS + VEE_ITEMS + PSYCAP_ITEMS
 
+# Item bank index, built once at import (scoring used to rescan ALL_ITEMS per construct)
+ITEMS_BY_CONSTRUCT: Dict[Construct, List[AssessmentItem]] = {
+    construct: [item for item in ALL_ITEMS if item.construct == construct]
+    for construct in Construct
+}
+
 
 def get_items_by_construct(construct: Construct) -> List[AssessmentItem]:
     """Get all items for a specific construct"""
-    return [item for item in ALL_ITEMS if item.construct == construct]
+    return ITEMS_BY_CONSTRUCT[construct]
 
 
 def calculate_construct_score(responses: Dict[str, int], construct: Construct) -> float:
@@ -8,9 +8,11 @@ the thesis model: "Dark Agency in Institutional Voids"
 
 from dataclasses import dataclass
 from enum import Enum
-from typing import Tuple
+from typing import Dict, Optional, Tuple
 import math
 
+from app.core.model_registry import ModelRegistry
+
 
 class Classification(Enum):
     """Candidate classification based on Bifactor model"""
@@ -84,12 +86,44 @@ class BifactorEngine:
     LOADING_MACH = 0.10
     LOADING_NARC = 0.05
     
+    # S_Agency: Mach/Narc residual after removing G, amplified by VEE
+    S_AGENCY_MACH = 0.50
+    S_AGENCY_NARC = 0.50
+    S_AGENCY_G_CONTAMINATION = 0.35
+    S_AGENCY_VEE_AMPLIFICATION = 0.2
+    
+    # EIB path coefficients (H1a/H1c) and POPS x S_Agency interaction on VEE
+    EIB_POPS_INTERACTION = 0.5
+    EIB_S_AGENCY = 0.30
+    EIB_G = -0.20
+    EIB_VEE = 0.25
+    EIB_PSYCAP = 0.15
+    EIB_S_PSYCAP = 0.10
+    EIB_BASE = 0.3
+    
+    # Counterproductive work behavior paths
+    CWB_O_S_AGENCY = 0.30
+    CWB_O_G = 0.25
+    CWB_I_G = 0.70
+    CWB_I_S_AGENCY = 0.05
+    
     # Thresholds
     G_THRESHOLD_HIGH = 0.70
     G_THRESHOLD_MODERATE = 0.50
     S_AGENCY_THRESHOLD_HIGH = 0.65
     S_AGENCY_THRESHOLD_MODERATE = 0.45
     
+    def __init__(self, params: Optional[Dict[str, float]] = None, version: str = "builtin"):
+        """
+        params overrides the class-level loadings/thresholds (model registry).
+        Unknown keys are rejected so a typo can't silently serve defaults.
+        """
+        self.version = version
+        for key, value in (params or {}).items():
+            if not key.isupper() or not hasattr(type(self), key):
+                raise ValueError(f"Unknown bifactor parameter: {key}")
+            setattr(self, key, float(value))
+    
     def extract_g_factor(self, scores: PsychometricScores) -> float:
         """
         Extract G-factor (antagonistic core)
@@ -110,35 +144,36 @@ class BifactorEngine:
         S_Agency = strategic darkness after removing G contamination.
         This is what predicts intrapreneurial behavior (EIB).
         """
-        raw_agency = 0.50 * scores.machiavellianism + 0.50 * scores.narcissism
+        raw_agency = (self.S_AGENCY_MACH * scores.machiavellianism +
+                      self.S_AGENCY_NARC * scores.narcissism)
         
         # Remove G contamination
-        s_agency = raw_agency - (g * 0.35)
+        s_agency = raw_agency - (g * self.S_AGENCY_G_CONTAMINATION)
         
         # VEE amplifies expression
-        s_agency *= (1.0 + scores.vigilance * 0.2)
+        s_agency *= (1.0 + scores.vigilance * self.S_AGENCY_VEE_AMPLIFICATION)
         
         return max(0.0, min(1.0, s_agency))
     
     def predict_eib(self, scores: PsychometricScores, g: float, s: float) -> float:
         """Predict Intrapreneurial Behavior score"""
-        effective_vee = scores.vigilance * (1.0 + scores.pops * s * 0.5)
+        effective_vee = scores.vigilance * (1.0 + scores.pops * s * self.EIB_POPS_INTERACTION)
         
-        eib = (0.30 * s +           # H1a: S_Agency → EIB (+)
-               -0.20 * g +          # H1c: G → EIB (-)
-               0.25 * effective_vee +
-               0.15 * scores.psycap +
-               0.10 * (s * scores.psycap))
+        eib = (self.EIB_S_AGENCY * s +      # H1a: S_Agency → EIB (+)
+               self.EIB_G * g +             # H1c: G → EIB (-)
+               self.EIB_VEE * effective_vee +
+               self.EIB_PSYCAP * scores.psycap +
+               self.EIB_S_PSYCAP * (s * scores.psycap))
         
-        return max(0.0, min(1.0, eib + 0.3))
+        return max(0.0, min(1.0, eib + self.EIB_BASE))
     
     def predict_cwb_o(self, g: float, s: float) -> float:
         """Predict CWB-O (organizational transgression) risk"""
-        return max(0.0, min(1.0, 0.30 * s + 0.25 * g))
+        return max(0.0, min(1.0, self.CWB_O_S_AGENCY * s + self.CWB_O_G * g))
     
     def predict_cwb_i(self, g: float, s: float) -> float:
         """Predict CWB-I (interpersonal damage) risk"""
-        return max(0.0, min(1.0, 0.70 * g + 0.05 * s))
+        return max(0.0, min(1.0, self.CWB_I_G * g + self.CWB_I_S_AGENCY * s))
     
     def classify(self, g: float, s: float) -> Tuple[Classification, float]:
         """
@@ -187,10 +222,10 @@ class BifactorEngine:
         )
 
 
-# Global engine instance
-engine = BifactorEngine()
+# Global engine instance (hot-reloadable through the model registry)
+registry = ModelRegistry("bifactor", lambda params, version: BifactorEngine(params, version))
 
 
 def analyze_candidate(scores: PsychometricScores) -> BifactorResult:
     """Convenience function for analyzing a candidate"""
-    return engine.analyze(scores)
+    return registry.current.engine.analyze(scores)
@@ -0,0 +1,362 @@
+"""
+Duplicate-candidate detection
+
+The same person often applies under several emails. Candidates are linked
+into clusters (Candidate.cluster_id = id of the oldest member) in three
+steps:
+
+1. Blocking. Each candidate gets a handful of keys: normalized phone,
+   LinkedIn slug and email local part. Only candidates that share a key
+   are ever compared; oversized blocks (shared junk values such as a
+   company switchboard number) are skipped. Name-only keys are not used:
+   with realistic name frequencies they produce huge blocks and, without
+   a shared identifier, two "Juan Garcia Perez" cannot be told apart.
+2. Scoring, vectorized over all pairs of a block at once: Jaro-Winkler on
+   normalized names (fixed-width code arrays, one pass per character
+   position) and trigram Jaccard on names (1024-bit sets, popcount over
+   packed bytes), which catches reordered tokens that Jaro-Winkler misses.
+   A pair matches when it shares an identifier and either name score
+   clears its threshold.
+3. Union-find over matched pairs.
+
+link_candidate() runs this incrementally for one new candidate through
+the `candidate_block_keys` index; backfill() recomputes everything in
+parallel worker processes:
+
+    python -m app.core.dedupe --workers 8
+"""
+
+import argparse
+import logging
+import os
+import re
+import time
+import unicodedata
+import zlib
+from concurrent.futures import ProcessPoolExecutor
+from typing import Dict, Iterable, List, Optional, Sequence, Set, Tuple
+
+import numpy as np
+from sqlalchemy import func
+
+from app.models.database import SessionLocal
+from app.models.schemas import Candidate, CandidateBlockKey
+
+logger = logging.getLogger(__name__)
+
+MAX_LEN = 32          # characters compared per string (longer names are truncated)
+TRIGRAM_BITS = 1024
+MAX_BLOCK = int(os.getenv("DEDUPE_MAX_BLOCK", "500"))
+PAIR_CHUNK = 200_000  # pairs scored per vectorized call / worker task
+
+# A shared identifier only links two candidates whose names are plausibly the
+# same person (typos, accents, "Surname Name" order)
+MIN_NAME_JW = 0.85
+MIN_NAME_TRIGRAM = 0.50
+MIN_EMAIL_LOCAL = 5  # shorter local parts ("info", "rrhh") identify nobody
+
+_POPCOUNT = np.array([bin(i).count("1") for i in range(256)], dtype=np.uint8)
+_LINKEDIN = re.compile(r"linkedin\.com/(?:in|pub)/([^/?#]+)", re.IGNORECASE)
+
+
+# ----------------------------------------------------------------------
+# Normalization and blocking
+# ----------------------------------------------------------------------
+def normalize_name(name: Optional[str]) -> str:
+    text = unicodedata.normalize("NFKD", name or "")
+    text = "".join(c for c in text if not unicodedata.combining(c)).lower()
+    return " ".join(re.sub(r"[^a-z ]+", " ", text).split())
+
+
+def normalize_phone(phone: Optional[str]) -> str:
+    digits = re.sub(r"\D", "", phone or "")
+    return digits[-9:] if len(digits) >= 7 else ""  # drops country / trunk prefixes
+
+
+def normalize_linkedin(url: Optional[str]) -> str:
+    match = _LINKEDIN.search(url or "")
+    if not match:
+        return ""
+    return re.sub(r"-[0-9a-f]{6,}$", "", match.group(1).lower().rstrip("/"))
+
+
+def normalize_email_local(email: Optional[str]) -> str:
+    local = (email or "").split("@")[0].lower().split("+")[0]
+    return re.sub(r"[^a-z0-9]", "", local)
+
+
+class Features:
+    """Normalized fields of many candidates as fixed-width arrays"""
+
+    def __init__(self, names: Sequence[str], phones: Sequence[str],
+                 linkedins: Sequence[str], email_locals: Sequence[str]):
+        self.names = list(names)
+        self.phones = np.array(phones, dtype=object)
+        self.linkedins = np.array(linkedins, dtype=object)
+        self.email_locals = np.array(email_locals, dtype=object)
+        self.name_codes, self.name_lens = _codes(self.names)
+        self.trigrams = np.stack([_trigram_bits(n) for n in self.names]) if self.names else \
+            np.zeros((0, TRIGRAM_BITS // 8), dtype=np.uint8)
+
+    @classmethod
+    def from_fields(cls, rows: Iterable[Tuple[str, str, str, str]]) -> "Features":
+        """rows of (full_name, phone, linkedin_url, email)"""
+        normalized = [(normalize_name(name), normalize_phone(phone), normalize_linkedin(linkedin),
+                       normalize_email_local(email)) for name, phone, linkedin, email in rows]
+        return cls(*zip(*normalized)) if normalized else cls([], [], [], [])
+
+    @classmethod
+    def from_candidates(cls, candidates: Iterable[Candidate]) -> "Features":
+        return cls.from_fields((c.full_name, c.phone, c.linkedin_url, c.email) for c in candidates)
+
+
+def blocking_keys(phone: str, linkedin: str, email_local: str) -> Set[str]:
+    keys = set()
+    if phone:
+        keys.add(f"p:{phone}")
+    if linkedin:
+        keys.add(f"l:{linkedin}")
+    if len(email_local) >= MIN_EMAIL_LOCAL:
+        keys.add(f"e:{email_local}")
+    return keys
+
+
+def _codes(strings: Sequence[str]) -> Tuple[np.ndarray, np.ndarray]:
+    codes = np.zeros((len(strings), MAX_LEN), dtype=np.uint32)
+    lens = np.zeros(len(strings), dtype=np.int64)
+    for i, s in enumerate(strings):
+        s = s[:MAX_LEN]
+        codes[i, :len(s)] = np.frombuffer(s.encode("utf-32-le"), dtype=np.uint32)
+        lens[i] = len(s)
+    return codes, lens
+
+
+def _trigram_bits(name: str) -> np.ndarray:
+    bits = np.zeros(TRIGRAM_BITS, dtype=bool)
+    padded = f"  {name} "
+    for i in range(len(padded) - 2):
+        bits[zlib.crc32(padded[i:i + 3].encode()) % TRIGRAM_BITS] = True
+    return np.packbits(bits)
+
+
+# ----------------------------------------------------------------------
+# Vectorized similarity (one row per pair)
+# ----------------------------------------------------------------------
+def jaro_winkler(s1: np.ndarray, l1: np.ndarray, s2: np.ndarray, l2: np.ndarray) -> np.ndarray:
+    """Jaro-Winkler for P pairs of (P, MAX_LEN) code arrays; greedy matching one position at a time"""
+    pairs = s1.shape[0]
+    positions = np.arange(MAX_LEN)
+    window = np.maximum(np.maximum(l1, l2) // 2 - 1, 0)
+    in_s2 = positions[None, :] < l2[:, None]
+    matched1 = np.zeros((pairs, MAX_LEN), dtype=bool)
+    matched2 = np.zeros((pairs, MAX_LEN), dtype=bool)
+    rows = np.arange(pairs)
+    for i in range(int(l1.max(initial=0))):
+        near = np.abs(positions[None, :] - i) <= window[:, None]
+        candidates = (s2 == s1[:, i:i + 1]) & near & in_s2 & ~matched2 & (i < l1)[:, None]
+        hit = candidates.any(axis=1)
+        first = candidates.argmax(axis=1)
+        matched2[rows[hit], first[hit]] = True
+        matched1[hit, i] = True
+
+    m = matched1.sum(axis=1)
+    # Matched characters in order on each side; half the mismatches are transpositions
+    order1 = np.argsort(~matched1, axis=1, kind="stable")
+    order2 = np.argsort(~matched2, axis=1, kind="stable")
+    c1 = np.take_along_axis(s1, order1, axis=1)
+    c2 = np.take_along_axis(s2, order2, axis=1)
+    t = ((c1 != c2) & (positions[None, :] < m[:, None])).sum(axis=1) / 2
+
+    jaro = np.where(m > 0, (m / np.maximum(l1, 1) + m / np.maximum(l2, 1) + (m - t) / np.maximum(m, 1)) / 3, 0.0)
+    same_prefix = np.cumprod(s1[:, :4] == s2[:, :4], axis=1).sum(axis=1)
+    prefix = np.minimum(same_prefix, np.minimum(np.minimum(l1, l2), 4))
+    return jaro + prefix * 0.1 * (1 - jaro)
+
+
+def trigram_jaccard(b1: np.ndarray, b2: np.ndarray) -> np.ndarray:
+    inter = _POPCOUNT[b1 & b2].sum(axis=1, dtype=np.int64)
+    union = _POPCOUNT[b1 | b2].sum(axis=1, dtype=np.int64)
+    return np.where(union > 0, inter / np.maximum(union, 1), 0.0)
+
+
+def match_pairs(features: Features, a: np.ndarray, b: np.ndarray) -> np.ndarray:
+    """Boolean mask over pairs (a[k], b[k]) judged to be the same person"""
+    def shared(values: np.ndarray, min_len: int = 1) -> np.ndarray:
+        lengths = np.fromiter(map(len, values[a]), dtype=np.int64, count=len(a))
+        return (values[a] == values[b]).astype(bool) & (lengths >= min_len)
+
+    same_id = shared(features.phones) | shared(features.linkedins) | shared(features.email_locals, MIN_EMAIL_LOCAL)
+    name_jw = jaro_winkler(features.name_codes[a], features.name_lens[a],
+                           features.name_codes[b], features.name_lens[b])
+    matched = same_id & (name_jw >= MIN_NAME_JW)
+    maybe = same_id & ~matched  # e.g. reordered tokens: trigram sets don't care about order
+    if maybe.any():
+        matched[maybe] = trigram_jaccard(features.trigrams[a[maybe]], features.trigrams[b[maybe]]) >= MIN_NAME_TRIGRAM
+    return matched
+
+
+# ----------------------------------------------------------------------
+# Clustering
+# ----------------------------------------------------------------------
+class UnionFind:
+    """Roots are always the smallest index, i.e. the oldest candidate"""
+
+    def __init__(self, n: int):
+        self.parent = np.arange(n)
+
+    def find(self, x: int) -> int:
+        parent = self.parent
+        while parent[x] != x:
+            parent[x] = parent[parent[x]]
+            x = parent[x]
+        return x
+
+    def union(self, x: int, y: int) -> None:
+        rx, ry = self.find(x), self.find(y)
+        if rx != ry:
+            self.parent[max(rx, ry)] = min(rx, ry)
+
+    def roots(self) -> np.ndarray:
+        return np.array([self.find(i) for i in range(len(self.parent))])
+
+
+def block_pairs(keys: List[Tuple[str, int]]) -> np.ndarray:
+    """(key, index) rows -> unique (a, b) pairs with a < b inside every block"""
+    keys.sort()
+    chunks = []
+    start = 0
+    while start < len(keys):
+        end = start
+        while end < len(keys) and keys[end][0] == keys[start][0]:
+            end += 1
+        size = end - start
+        if 1 < size <= MAX_BLOCK:
+            members = np.array([index for _, index in keys[start:end]])
+            i, j = np.triu_indices(size, 1)
+            chunks.append(np.stack([np.minimum(members[i], members[j]), np.maximum(members[i], members[j])], axis=1))
+        elif size > MAX_BLOCK:
+            logger.info("skipping oversized block %s (%d candidates)", keys[start][0], size)
+        start = end
+    if not chunks:
+        return np.zeros((0, 2), dtype=np.int64)
+    return np.unique(np.concatenate(chunks), axis=0)
+
+
+# ----------------------------------------------------------------------
+# Incremental
+# ----------------------------------------------------------------------
+def link_candidate(session, candidate: Candidate) -> Optional[str]:
+    """Index a new candidate's keys and merge it into any matching cluster; returns its cluster id"""
+    features = Features.from_candidates([candidate])
+    keys = blocking_keys(features.phones[0], features.linkedins[0], features.email_locals[0])
+    others: Dict[str, Candidate] = {}
+    for key in keys:
+        ids = [row[0] for row in session.query(CandidateBlockKey.candidate_id)
+               .filter(CandidateBlockKey.key == key).limit(MAX_BLOCK + 1)]
+        if len(ids) > MAX_BLOCK:
+            continue
+        for other in session.query(Candidate).filter(Candidate.id.in_(ids)):
+            if other.id != candidate.id:
+                others[str(other.id)] = other
+        session.add(CandidateBlockKey(key=key, candidate_id=candidate.id))
+
+    matches = []
+    if others:
+        group = [candidate] + list(others.values())
+        features = Features.from_candidates(group)
+        b = np.arange(1, len(group))
+        matched = match_pairs(features, np.zeros_like(b), b)
+        matches = [group[k] for k in b[matched]]
+
+    if matches:
+        members = [candidate] + matches
+        clusters = {m.cluster_id or m.id for m in members}
+        oldest = min(session.query(Candidate).filter(Candidate.id.in_(clusters)),
+                     key=lambda c: (c.created_at, str(c.id)))
+        session.query(Candidate).filter(Candidate.cluster_id.in_(clusters)).update(
+            {"cluster_id": oldest.id}, synchronize_session=False)
+        for member in members:
+            member.cluster_id = oldest.id
+    session.commit()
+    return str(candidate.cluster_id) if candidate.cluster_id else None
+
+
+# ----------------------------------------------------------------------
+# Parallel backfill
+# ----------------------------------------------------------------------
+_worker_features: Optional[Features] = None
+
+
+def _score_chunk(pairs: np.ndarray) -> np.ndarray:
+    matched = match_pairs(_worker_features, pairs[:, 0], pairs[:, 1])
+    return pairs[matched]
+
+
+def backfill(workers: int = os.cpu_count() or 1, chunk: int = 100_000) -> Dict[str, float]:
+    """Recompute every cluster and the block-key index from scratch"""
+    global _worker_features
+    timings = {}
+    start = time.perf_counter()
+    with SessionLocal() as session:
+        rows = (session.query(Candidate.id, Candidate.full_name, Candidate.phone,
+                              Candidate.linkedin_url, Candidate.email)
+                .order_by(Candidate.created_at, Candidate.id).yield_per(chunk).all())
+    ids = [row[0] for row in rows]
+    features = Features.from_fields(row[1:] for row in rows)
+    keys = [(key, i) for i in range(len(ids))
+            for key in blocking_keys(features.phones[i], features.linkedins[i], features.email_locals[i])]
+    pairs = block_pairs(list(keys))
+    timings["features_s"] = time.perf_counter() - start
+
+    start = time.perf_counter()
+    tasks = [pairs[i:i + PAIR_CHUNK] for i in range(0, len(pairs), PAIR_CHUNK)]
+    _worker_features = features  # inherited by forked workers
+    if workers > 1 and len(tasks) > 1:
+        import multiprocessing
+        with ProcessPoolExecutor(workers, mp_context=multiprocessing.get_context("fork")) as pool:
+            matched = list(pool.map(_score_chunk, tasks))
+    else:
+        matched = [_score_chunk(task) for task in tasks]
+    _worker_features = None
+    timings["scoring_s"] = time.perf_counter() - start
+
+    start = time.perf_counter()
+    clusters = UnionFind(len(ids))
+    for a, b in (np.concatenate(matched) if matched else np.zeros((0, 2), dtype=np.int64)):
+        clusters.union(int(a), int(b))
+    roots = clusters.roots()
+    sizes = np.bincount(roots, minlength=len(ids))
+    with SessionLocal() as session:
+        session.query(Candidate).update({"cluster_id": None}, synchronize_session=False)
+        updates = [{"id": ids[i], "cluster_id": ids[roots[i]]} for i in np.flatnonzero(sizes[roots] > 1)]
+        for i in range(0, len(updates), chunk):
+            session.bulk_update_mappings(Candidate, updates[i:i + chunk])
+        session.query(CandidateBlockKey).delete(synchronize_session=False)
+        for i in range(0, len(keys), chunk):
+            session.bulk_insert_mappings(CandidateBlockKey,
+                                         [{"key": k, "candidate_id": ids[j]} for k, j in keys[i:i + chunk]])
+        session.commit()
+    timings["write_s"] = time.perf_counter() - start
+    timings.update(candidates=len(ids), pairs=len(pairs), clusters=int((np.bincount(roots) > 1).sum()),
+                   duplicates=int((sizes[roots] > 1).sum() - (np.bincount(roots) > 1).sum()))
+    return timings
+
+
+def clusters(session, limit: int = 100) -> List[Dict]:
+    """Largest duplicate clusters first"""
+    rows = (session.query(Candidate.cluster_id, func.count(Candidate.id))
+            .filter(Candidate.cluster_id.isnot(None)).group_by(Candidate.cluster_id)
+            .order_by(func.count(Candidate.id).desc()).limit(limit).all())
+    out = []
+    for cluster_id, size in rows:
+        members = session.query(Candidate).filter(Candidate.cluster_id == cluster_id).all()
+        out.append({"cluster_id": str(cluster_id), "size": size,
+                    "members": [{"id": str(c.id), "email": c.email, "name": c.full_name} for c in members]})
+    return out
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Recompute duplicate-candidate clusters")
+    parser.add_argument("--workers", type=int, default=os.cpu_count() or 1)
+    logging.basicConfig(level=logging.INFO)
+    print(backfill(parser.parse_args().workers))
@@ -0,0 +1,394 @@
+"""
+Streaming export of assessment results (CSV / NDJSON / Parquet)
+
+Tables are read by keyset pagination: every CHUNK_ROWS batch is its own
+short query `(timestamp, id) > last row`, over the (company_id, timestamp,
+id) / (timestamp, id) indexes, and no cursor stays open while a batch is
+being sent. A cursor held across yields would pin SQLite's shared lock for
+as long as the client takes to read, and every concurrent submit would fail
+with "database is locked". Batches are turned into columns once and encoded
+column-wise, so memory stays at one batch whatever the export size. Sources
+are visited oldest first: archived months, then month tables / partitions
+(see partitioning.py), in (timestamp, id) order, which is also the resume
+key.
+
+Resume: every row carries `timestamp` and `id`; pass the last pair back as
+`after` to continue an interrupted download. Ranges: `Range: rows=a-b`
+selects rows by position in the export (0-based, inclusive); the start is
+reached by an index seek (OFFSET over timestamp, id) per table and by
+slicing the selection in archives, never by reading the skipped rows.
+count_rows() resolves open ranges to a concrete last row for Content-Range.
+
+company_id None exports every result (single-tenant deployments running
+without admission control). Results stored without a tenant only show up in
+a tenant's export after partitioning.backfill_company().
+"""
+
+
+import io
+import json
+import os
+from datetime import datetime
+from typing import Any, Dict, Iterator, Optional, Sequence, Tuple
+
+import numpy as np
+
+from app.core import response_codec
+from app.models import partitioning
+from app.models.database import engine
+
+CHUNK_ROWS = int(os.getenv("EXPORT_CHUNK_ROWS", "50000"))
+FORMATS = {
+    "csv": ("text/csv", "csv"),
+    "ndjson": ("application/x-ndjson", "ndjson"),
+    "parquet": ("application/vnd.apache.parquet", "parquet"),
+}
+
+COLUMNS = (
+    "timestamp", "id", "assessment_id", "candidate_id",
+    "narcissism_score", "machiavellianism_score", "psychopathy_score", "sadism_score",
+    "risk_level", "model_version", "raw_data", "responses",
+)
+FLOAT_COLUMNS = ("narcissism_score", "machiavellianism_score", "psychopathy_score", "sadism_score")
+SAFE_STRING_COLUMNS = ("timestamp", "id", "assessment_id", "candidate_id")  # never need quoting or escaping
+TEXT_COLUMNS = ("risk_level", "model_version")
+
+Cursor = Tuple[str, str]  # (timestamp, id) of the last row already received
+Batch = Dict[str, list]
+
+
+class _Seek:
+    """Rows still to skip before the range starts; each source consumes what it holds"""
+    __slots__ = ("rows",)
+
+    def __init__(self, rows: int):
+        self.rows = rows
+
+
+class ExportUnavailable(RuntimeError):
+    pass
+
+
+def parse_after(after: Optional[str]) -> Optional[Cursor]:
+    """`<timestamp>,<id>` as found in the last exported row"""
+    if not after:
+        return None
+    timestamp, _, row_id = after.rpartition(",")
+    if not timestamp or not row_id:
+        raise ValueError("after must be '<timestamp>,<id>'")
+    return _db_time(datetime.fromisoformat(timestamp.replace("T", " "))), row_id
+
+
+def parse_range(header: Optional[str]) -> Optional[Tuple[int, Optional[int]]]:
+    """`rows=a-b` / `rows=a-` -> (first, last or None)"""
+    if not header:
+        return None
+    unit, _, spec = header.partition("=")
+    first, _, last = spec.partition("-")
+    if unit.strip() != "rows" or "," in spec or not first.strip().isdigit():
+        raise ValueError("only a single 'rows=a-b' range is supported")
+    first_row, last_row = int(first), int(last) if last.strip() else None
+    if last_row is not None and last_row < first_row:
+        raise ValueError("range end before start")
+    return first_row, last_row
+
+
+def resolve_range(rows: Tuple[int, Optional[int]], total: int) -> Optional[Tuple[int, int]]:
+    """Clamp a parsed range to `total` rows; None if it starts past the end (416)"""
+    first, last = rows
+    if first >= total:
+        return None
+    return first, total - 1 if last is None else min(last, total - 1)
+
+
+# ----------------------------------------------------------------------
+# Reading
+# ----------------------------------------------------------------------
+def iter_batches(company_id: Any, after: Optional[Cursor] = None,
+                 rows: Optional[Tuple[int, Optional[int]]] = None) -> Iterator[Batch]:
+    """Column batches of at most CHUNK_ROWS rows, in (timestamp, id) order"""
+    first, last = rows or (0, None)
+    remaining = None if last is None else last - first + 1
+    for batch in _all_batches(_tenant(company_id), after, _Seek(first)):
+        if remaining is not None and len(batch["id"]) > remaining:
+            batch = {name: values[:remaining] for name, values in batch.items()}
+        yield batch
+        if remaining is not None:
+            remaining -= len(batch["id"])
+            if remaining <= 0:
+                return
+
+
+def count_rows(company_id: Any, after: Optional[Cursor] = None) -> int:
+    """Rows iter_batches() would yield without a range (an extra index/column scan)"""
+    company_id = _tenant(company_id)
+    start = _as_datetime(after[0]) if after else None
+    total = 0
+    for month in _archive_months(start):
+        for columns in partitioning.iter_archive(month):
+            if company_id is None or "company_id" in columns:
+                total += int(np.count_nonzero(_archive_mask(columns, company_id, after)[0]))
+    for name in partitioning.partitions_for(start):
+        total += _fetch(*_table_query(name, "COUNT(*)", company_id, after))[0][0]
+    return total
+
+
+def _tenant(company_id: Any) -> Optional[str]:
+    return None if company_id is None else str(company_id)
+
+
+def _archive_months(start: Optional[datetime]) -> list:
+    return [m for m in partitioning.archived_months() if start is None or m >= partitioning.month_of(start)]
+
+
+def _all_batches(company_id: Optional[str], after: Optional[Cursor], seek: _Seek) -> Iterator[Batch]:
+    start = _as_datetime(after[0]) if after else None
+    for month in _archive_months(start):
+        yield from _archive_batches(month, company_id, after, seek)
+    for name in reversed(partitioning.partitions_for(start)):
+        yield from _table_batches(name, company_id, after, seek)
+
+
+def _table_query(table: str, select: str, company_id: Optional[str],
+                 after: Optional[Cursor]) -> Tuple[str, Dict[str, Any]]:
+    bind = "%({})s" if partitioning.is_postgres() else ":{}"
+    where, params = [], {}
+    if company_id is not None:
+        where.append(f"company_id = {bind.format('company_id')}")
+        params["company_id"] = company_id
+    if after:
+        where.append(f"(timestamp, id) > ({bind.format('after_ts')}, {bind.format('after_id')})")
+        params.update(after_ts=after[0], after_id=after[1])
+    query = f"SELECT {select} FROM {table}"
+    return (query + " WHERE " + " AND ".join(where) if where else query), params
+
+
+def _table_batches(table: str, company_id: Optional[str], after: Optional[Cursor],
+                   seek: _Seek) -> Iterator[Batch]:
+    """One keyset query per batch; nothing is held open while the batch is streamed"""
+    key = _seek_table(table, company_id, after, seek)
+    if key is None and seek.rows:
+        return
+    columns = ", ".join(COLUMNS)
+    while True:
+        query, params = _table_query(table, columns, company_id, key or after)
+        rows = _fetch(f"{query} ORDER BY timestamp, id LIMIT {CHUNK_ROWS}", params)
+        if not rows:
+            return
+        key = (rows[-1][0], str(rows[-1][1]))
+        yield _columns(rows)
+        if len(rows) < CHUNK_ROWS:
+            return
+
+
+def _seek_table(table: str, company_id: Optional[str], after: Optional[Cursor],
+                seek: _Seek) -> Optional[Cursor]:
+    """Keyset position of the last skipped row (index only); None if nothing is skipped here"""
+    if not seek.rows:
+        return None
+    query, params = _table_query(table, "timestamp, id", company_id, after)
+    rows = _fetch(f"{query} ORDER BY timestamp, id LIMIT 1 OFFSET {seek.rows - 1}", params)
+    if rows:
+        seek.rows = 0
+        return rows[0][0], str(rows[0][1])
+    seek.rows -= _fetch(*_table_query(table, "COUNT(*)", company_id, after))[0][0]
+    return None
+
+
+def _fetch(query: str, params: Dict[str, Any]) -> list:
+    """Plain DBAPI cursor (SQLAlchemy Row objects would cost more than the fetch), closed before returning"""
+    with engine.connect() as conn:
+        cursor = conn.connection.driver_connection.cursor()
+        try:
+            cursor.execute(query, params)
+            return cursor.fetchall()
+        finally:
+            cursor.close()
+
+
+def _columns(rows: Sequence[Sequence[Any]]) -> Batch:
+    batch = dict(zip(COLUMNS, (list(column) for column in zip(*rows))))
+    if batch and batch["timestamp"] and not isinstance(batch["timestamp"][0], str):
+        batch["timestamp"] = [_db_time(ts) for ts in batch["timestamp"]]  # Postgres returns datetimes
+        for name in ("id", "assessment_id", "candidate_id"):
+            batch[name] = [None if v is None else str(v) for v in batch[name]]
+        batch["raw_data"] = [None if v is None else json.dumps(v, separators=(",", ":")) for v in batch["raw_data"]]
+        batch["responses"] = [None if v is None else bytes(v) for v in batch["responses"]]
+    return batch
+
+
+def _archive_batches(month, company_id: Optional[str], after: Optional[Cursor], seek: _Seek) -> Iterator[Batch]:
+    """Archive batches are stored in (timestamp, id) order: sorting within each one keeps the export order"""
+    for columns in partitioning.iter_archive(month):
+        if company_id is None or "company_id" in columns:
+            yield from _archive_rows(columns, company_id, after, seek)
+
+
+def _archive_mask(columns, company_id: Optional[str], after: Optional[Cursor]) -> Tuple[np.ndarray, np.ndarray]:
+    timestamps = np.array([_db_time(ts) for ts in columns["timestamp"].astype(datetime)], dtype=object)
+    mask = np.ones(timestamps.size, dtype=bool) if company_id is None else columns["company_id"] == company_id
+    if after:
+        mask &= (timestamps > after[0]) | ((timestamps == after[0]) & (columns["id"] > after[1]))
+    return mask, timestamps
+
+
+def _archive_rows(columns, company_id: Optional[str], after: Optional[Cursor], seek: _Seek) -> Iterator[Batch]:
+    mask, timestamps = _archive_mask(columns, company_id, after)
+    selected = np.flatnonzero(mask)
+    selected = selected[np.lexsort((columns["id"][selected], timestamps[selected]))]
+    skipped = min(seek.rows, selected.size)  # skipped rows are never decoded
+    seek.rows -= skipped
+    selected = selected[skipped:]
+    for start in range(0, selected.size, CHUNK_ROWS):
+        rows = [partitioning.archived_row(columns, int(i)) for i in selected[start:start + CHUNK_ROWS]]
+        yield {
+            "timestamp": [_db_time(r.timestamp) for r in rows],
+            "id": [str(r.id) for r in rows],
+            "assessment_id": [None if r.assessment_id is None else str(r.assessment_id) for r in rows],
+            "candidate_id": [None if r.candidate_id is None else str(r.candidate_id) for r in rows],
+            **{name: [getattr(r, name) for r in rows] for name in FLOAT_COLUMNS + ("risk_level", "model_version")},
+            "raw_data": [None if r.raw_data is None else json.dumps(r.raw_data, separators=(",", ":")) for r in rows],
+            "responses": [r.responses for r in rows],
+        }
+
+
+def _db_time(value: datetime) -> str:
+    return value.isoformat(" ", timespec="microseconds")
+
+
+def _as_datetime(value: str) -> datetime:
+    return datetime.fromisoformat(value)
+
+
+# ----------------------------------------------------------------------
+# Columnar batch -> output columns
+# ----------------------------------------------------------------------
+def output_columns(batch: Batch, include_responses: bool) -> Dict[str, list]:
+    """Drop the packed blob; optionally expand it into one column per item (vectorized decode)"""
+    columns = {name: values for name, values in batch.items() if name != "responses"}
+    if include_responses:
+        n = len(batch["id"])
+        matrix = np.zeros((n, len(response_codec.ITEM_BANKS[response_codec.CURRENT_BANK])), dtype=np.uint8)
+        for version, (positions, blobs) in response_codec.group_by_version(batch["responses"]).items():
+            _, values = response_codec.decode_batch(blobs)
+            matrix[positions, :values.shape[1]] = values  # banks only ever append items
+        for i, code in enumerate(response_codec.ITEM_BANKS[response_codec.CURRENT_BANK]):
+            column = matrix[:, i].tolist()
+            columns[code] = [v or None for v in column]
+    return columns
+
+
+# Both text encoders render each column to tokens in one pass (the per-type
+# decision is made once per column, not per cell), then stitch rows with a
+# %-template. Scores, labels and item answers have few distinct values, so
+# they are dictionary-encoded per batch: each distinct value is rendered once.
+
+def _dictionary(values: list, render, null: str) -> list:
+    lookup = {v: render(v) for v in set(values) if v is not None}
+    lookup[None] = null
+    return list(map(lookup.__getitem__, values))
+
+
+def _csv_tokens(name: str, values: list) -> list:
+    if name in SAFE_STRING_COLUMNS:
+        return ["" if v is None else v for v in values]
+    if name == "raw_data":
+        return ["" if v is None else '"' + v.replace('"', '""') + '"' for v in values]
+    if name in TEXT_COLUMNS:
+        return _dictionary(values, _csv_quote, "")
+    return _dictionary(values, repr, "")
+
+
+def _csv_quote(value: str) -> str:
+    if any(c in value for c in ',"\r\n'):
+        return '"' + value.replace('"', '""') + '"'
+    return value
+
+
+def _json_tokens(name: str, values: list) -> list:
+    if name in SAFE_STRING_COLUMNS:
+        return ["null" if v is None else '"' + v + '"' for v in values]
+    if name == "raw_data":
+        return ["null" if v is None else v for v in values]  # already JSON text
+    if name in TEXT_COLUMNS:
+        return _dictionary(values, json.dumps, "null")
+    return _dictionary(values, repr, "null")
+
+
+def encode_csv(batches: Iterator[Batch], include_responses: bool) -> Iterator[bytes]:
+    header = True
+    for batch in batches:
+        columns = output_columns(batch, include_responses)
+        if header:
+            yield (",".join(columns) + "\n").encode()
+            header = False
+        tokens = [_csv_tokens(name, values) for name, values in columns.items()]
+        template = ",".join(["%s"] * len(tokens)) + "\n"
+        yield "".join(map(template.__mod__, zip(*tokens))).encode()
+    if header:
+        yield (",".join(c for c in COLUMNS if c != "responses") + "\n").encode()
+
+
+def encode_ndjson(batches: Iterator[Batch], include_responses: bool) -> Iterator[bytes]:
+    for batch in batches:
+        columns = output_columns(batch, include_responses)
+        tokens = [_json_tokens(name, values) for name, values in columns.items()]
+        template = "{" + ",".join(f'"{name}":%s' for name in columns) + "}\n"
+        yield "".join(map(template.__mod__, zip(*tokens))).encode()
+
+
+def require(fmt: str) -> None:
+    """Raise ExportUnavailable before any byte is streamed if the format cannot be produced"""
+    if fmt == "parquet":
+        _pyarrow()
+
+
+def _pyarrow():
+    try:
+        import pyarrow as pa
+        import pyarrow.parquet as pq
+    except ImportError as exc:
+        raise ExportUnavailable("Parquet export needs pyarrow") from exc
+    return pa, pq
+
+
+def encode_parquet(batches: Iterator[Batch], include_responses: bool) -> Iterator[bytes]:
+    """One row group per batch; bytes are handed out as soon as each row group is written"""
+    pa, pq = _pyarrow()
+
+    sink = _DrainableSink()
+    writer = None
+    for batch in batches:
+        table = pa.table(output_columns(batch, include_responses))
+        if writer is None:
+            writer = pq.ParquetWriter(sink, table.schema, compression="zstd")
+        writer.write_table(table, row_group_size=CHUNK_ROWS)
+        yield sink.drain()
+    if writer is not None:
+        writer.close()
+    yield sink.drain()
+
+
+class _DrainableSink(io.RawIOBase):
+    def __init__(self):
+        self._buffer = bytearray()
+        self._position = 0
+
+    def writable(self) -> bool:
+        return True
+
+    def write(self, data) -> int:
+        self._buffer += data
+        self._position += len(data)
+        return len(data)
+
+    def tell(self) -> int:
+        return self._position
+
+    def drain(self) -> bytes:
+        data = bytes(self._buffer)
+        self._buffer.clear()
+        return data
+
+
+ENCODERS = {"csv": encode_csv, "ndjson": encode_ndjson, "parquet": encode_parquet}
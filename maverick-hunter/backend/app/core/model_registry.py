@@ -0,0 +1,174 @@
+"""
+Model Registry - versioned parameter sets with hot reload
+
+Layout on disk (MODEL_REGISTRY_DIR, default ./model_registry):
+
+    bifactor/
+        ACTIVE              <- text file with the version to serve
+        2026-10-01.json     <- {"LOADING_PSYCHOPATHY": 0.47, ...}
+
+A background watcher builds the new engine off the request path and then
+publishes it with a single reference assignment (RCU-style): requests that
+already hold the old version keep using it until they finish, and the old
+version is only dropped once its in-flight count drains to zero.
+"""
+
+import json
+import logging
+import os
+import threading
+from contextlib import contextmanager
+from typing import Any, Callable, Dict, Iterator, List, Optional
+
+logger = logging.getLogger(__name__)
+
+BUILTIN_VERSION = "builtin"
+REGISTRY_DIR = os.getenv("MODEL_REGISTRY_DIR", "./model_registry")
+POLL_SECONDS = float(os.getenv("MODEL_REGISTRY_POLL_SECONDS", "5"))
+
+
+class ModelVersion:
+    """An immutable engine plus the count of requests currently using it"""
+
+    def __init__(self, version: str, engine: Any):
+        self.version = version
+        self.engine = engine
+        self._in_flight = 0
+        self._lock = threading.Lock()
+
+    @property
+    def in_flight(self) -> int:
+        return self._in_flight
+
+    def acquire(self) -> None:
+        with self._lock:
+            self._in_flight += 1
+
+    def release(self) -> None:
+        with self._lock:
+            self._in_flight -= 1
+
+
+class ModelRegistry:
+    """
+    Serves one engine family (e.g. "bifactor") from versioned parameter files.
+
+    factory(params, version) must return a fully initialised engine; it runs
+    on the watcher thread, never on the request path.
+    """
+
+    def __init__(self, name: str, factory: Callable[[Dict[str, Any], str], Any],
+                 directory: str = REGISTRY_DIR):
+        self.name = name
+        self.factory = factory
+        self.directory = os.path.join(directory, name)
+        self._current = ModelVersion(BUILTIN_VERSION, factory({}, BUILTIN_VERSION))
+        self._retired: List[ModelVersion] = []
+        self._swap_lock = threading.Lock()
+        self._watcher: Optional[threading.Thread] = None
+        self._failed: Optional[tuple] = None  # (version, file signature) of the last failed load
+        self._stop = threading.Event()
+
+    # ------------------------------------------------------------------
+    # Read path (lock-free: a single attribute read)
+    # ------------------------------------------------------------------
+    @property
+    def current(self) -> ModelVersion:
+        return self._current
+
+    @contextmanager
+    def lease(self) -> Iterator[ModelVersion]:
+        """Pin the current version for the duration of a request"""
+        model = self._current
+        model.acquire()
+        try:
+            yield model
+        finally:
+            model.release()
+
+    # ------------------------------------------------------------------
+    # Write path
+    # ------------------------------------------------------------------
+    def load(self, version: str) -> ModelVersion:
+        """Build a version from disk and atomically publish it"""
+        if version == BUILTIN_VERSION:
+            params: Dict[str, Any] = {}
+        else:
+            with open(os.path.join(self.directory, f"{version}.json")) as f:
+                params = json.load(f)
+
+        candidate = ModelVersion(version, self.factory(params, version))
+
+        with self._swap_lock:
+            previous = self._current
+            if previous.version == version:
+                return previous
+            self._current = candidate
+            self._retired.append(previous)
+            self._drain()
+
+        logger.info("%s model swapped %s -> %s", self.name, previous.version, version)
+        return candidate
+
+    def active_version_on_disk(self) -> str:
+        try:
+            with open(os.path.join(self.directory, "ACTIVE")) as f:
+                return f.read().strip() or BUILTIN_VERSION
+        except FileNotFoundError:
+            return BUILTIN_VERSION
+
+    def status(self) -> Dict[str, Any]:
+        return {
+            "model": self.name,
+            "version": self._current.version,
+            "in_flight": self._current.in_flight,
+            "draining": {m.version: m.in_flight for m in self._retired},
+        }
+
+    def _file_signature(self, version: str) -> Optional[tuple]:
+        """(mtime, size) of the version's file; None if it does not exist"""
+        if version == BUILTIN_VERSION:
+            return None
+        try:
+            st = os.stat(os.path.join(self.directory, f"{version}.json"))
+        except OSError:
+            return None
+        return st.st_mtime_ns, st.st_size
+
+    def _drain(self) -> None:
+        """Forget retired versions once no request holds them"""
+        self._retired = [m for m in self._retired if m.in_flight > 0]
+
+    # ------------------------------------------------------------------
+    # Background watcher
+    # ------------------------------------------------------------------
+    def start_watcher(self, poll_seconds: float = POLL_SECONDS) -> None:
+        if self._watcher is not None:
+            return
+        self._poll_once()
+        self._watcher = threading.Thread(
+            target=self._watch, args=(poll_seconds,), name=f"{self.name}-registry", daemon=True
+        )
+        self._watcher.start()
+
+    def stop_watcher(self) -> None:
+        self._stop.set()
+
+    def _watch(self, poll_seconds: float) -> None:
+        while not self._stop.wait(poll_seconds):
+            self._poll_once()
+
+    def _poll_once(self) -> None:
+        try:
+            wanted = self.active_version_on_disk()
+            # A failed version is retried as soon as its file changes (or appears)
+            attempt = (wanted, self._file_signature(wanted))
+            if wanted != self._current.version and attempt != self._failed:
+                self._failed = attempt
+                self.load(wanted)
+                self._failed = None
+            with self._swap_lock:
+                self._drain()
+        except Exception:
+            # A broken parameter file must never take down the serving version
+            logger.exception("%s model reload failed; keeping %s", self.name, self._current.version)
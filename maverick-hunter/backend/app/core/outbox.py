@@ -0,0 +1,279 @@
+"""
+Result outbox - change-data-capture feed for downstream engines
+
+Every AssessmentResult insert appends a `result.created` event to
+`result_events` in the same transaction, so the feed never misses or
+invents a result. Writes go through a group committer: concurrent submits
+are collected for up to OUTBOX_GROUP_COMMIT_MS (or OUTBOX_GROUP_COMMIT_MAX
+writes) and committed together, one fsync for the whole group. If a group
+fails, its writes are retried one by one so a bad row only fails itself.
+
+Consumers (analytics, rollups, sketches, causal engine) tail the log by
+sequence number: read(after=seq) is a primary-key range scan, and each
+consumer's committed offset is kept in `result_event_offsets`. Readers in
+this process are woken as soon as a group commits; other processes fall
+back to re-checking every POLL_SECONDS. On Postgres, writers take an
+advisory lock before inserting so seq order is commit order across
+processes (a reader never sees seq N+1 before N).
+
+Events older than OUTBOX_RETENTION_HOURS that every registered consumer
+has committed past are pruned.
+"""
+
+import logging
+import os
+import queue
+import threading
+import time
+from concurrent.futures import Future
+from datetime import datetime, timedelta
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+from sqlalchemy import func, text
+
+from app.core import response_codec
+from app.models.database import SessionLocal, engine
+from app.models.schemas import AssessmentResult, ConsumerOffset, ResultEvent
+
+logger = logging.getLogger(__name__)
+
+GROUP_COMMIT_MAX = int(os.getenv("OUTBOX_GROUP_COMMIT_MAX", "128"))
+GROUP_COMMIT_WAIT = float(os.getenv("OUTBOX_GROUP_COMMIT_MS", "5")) / 1000
+RETENTION_HOURS = float(os.getenv("OUTBOX_RETENTION_HOURS", "168"))
+POLL_SECONDS = 1.0
+PRUNE_SECONDS = 3600.0
+MAX_READ = 10_000
+WRITER_LOCK = 0x6F7574626F78  # pg_advisory_xact_lock key ("outbox")
+
+Work = Callable[[Any], Any]
+
+
+# ----------------------------------------------------------------------
+# Write path
+# ----------------------------------------------------------------------
+def record_result(session, result: AssessmentResult) -> ResultEvent:
+    """Queue the result.created event in the caller's transaction"""
+    session.flush()  # column defaults (timestamp) are needed in the payload
+    event = ResultEvent(
+        event_type="result.created",
+        result_id=result.id,
+        company_id=result.company_id,
+        payload=result_payload(result),
+    )
+    session.add(event)
+    return event
+
+
+def result_payload(result: AssessmentResult) -> Dict[str, Any]:
+    return {
+        "id": str(result.id),
+        "assessment_id": None if result.assessment_id is None else str(result.assessment_id),
+        "candidate_id": None if result.candidate_id is None else str(result.candidate_id),
+        "company_id": None if result.company_id is None else str(result.company_id),
+        "timestamp": result.timestamp.isoformat(),
+        "narcissism": result.narcissism_score,
+        "machiavellianism": result.machiavellianism_score,
+        "psychopathy": result.psychopathy_score,
+        "sadism": result.sadism_score,
+        "classification": result.risk_level,
+        "model_version": result.model_version,
+        "raw_data": result.raw_data,
+        "responses": response_codec.decode(result.responses) if result.responses else None,
+    }
+
+
+class GroupCommitter:
+    def __init__(self, max_batch: int = GROUP_COMMIT_MAX, max_wait: float = GROUP_COMMIT_WAIT):
+        self.max_batch = max_batch
+        self.max_wait = max_wait
+        self.groups = 0
+        self.writes = 0
+        self._queue: "queue.Queue[Tuple[Work, Future]]" = queue.Queue()
+        self._stop = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+        self._last_prune = time.monotonic()
+
+    def submit(self, work: Work) -> Any:
+        """Run work(session) in the next group commit; blocks until it is durable"""
+        if self._thread is None or not self._thread.is_alive():
+            future: Future = Future()
+            self._commit([(work, future)])  # no committer thread (scripts, tests): commit alone
+            return future.result()
+        future = Future()
+        self._queue.put((work, future))
+        return future.result()
+
+    def start(self) -> None:
+        if self._thread is not None and self._thread.is_alive():
+            return
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._run, name="outbox-group-commit", daemon=True)
+        self._thread.start()
+
+    def stop(self) -> None:
+        """Commit whatever is queued, then stop"""
+        self._stop.set()
+        if self._thread is not None:
+            self._thread.join(timeout=5.0)
+
+    def status(self) -> Dict[str, Any]:
+        return {
+            "groups": self.groups,
+            "writes": self.writes,
+            "avg_group": round(self.writes / self.groups, 2) if self.groups else 0.0,
+            "queued": self._queue.qsize(),
+        }
+
+    def _run(self) -> None:
+        while not (self._stop.is_set() and self._queue.empty()):
+            try:
+                batch = [self._queue.get(timeout=0.5)]
+            except queue.Empty:
+                self._maybe_prune()
+                continue
+            deadline = time.monotonic() + self.max_wait
+            while len(batch) < self.max_batch:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                try:
+                    batch.append(self._queue.get(timeout=remaining))
+                except queue.Empty:
+                    break
+            self._commit(batch)
+            self._maybe_prune()
+
+    def _commit(self, batch: List[Tuple[Work, Future]]) -> None:
+        session = SessionLocal(expire_on_commit=False)
+        try:
+            if engine.dialect.name == "postgresql":
+                session.execute(text("SELECT pg_advisory_xact_lock(:key)"), {"key": WRITER_LOCK})
+            results = [work(session) for work, _ in batch]
+            session.commit()
+        except Exception as exc:
+            session.rollback()
+            if len(batch) > 1:
+                for item in batch:
+                    self._commit([item])
+            else:
+                batch[0][1].set_exception(exc)
+            return
+        finally:
+            session.close()
+        self.groups += 1
+        self.writes += len(batch)
+        for (_, future), value in zip(batch, results):
+            future.set_result(value)
+        feed.publish()
+
+    def _maybe_prune(self) -> None:
+        if time.monotonic() - self._last_prune < PRUNE_SECONDS:
+            return
+        self._last_prune = time.monotonic()
+        try:
+            prune()
+        except Exception:
+            logger.exception("outbox prune failed")
+
+
+# ----------------------------------------------------------------------
+# Read path
+# ----------------------------------------------------------------------
+class EventFeed:
+    """Wakes in-process readers when a group commits"""
+
+    def __init__(self):
+        self._changed = threading.Condition()
+        self._version = 0
+
+    def publish(self) -> None:
+        with self._changed:
+            self._version += 1
+            self._changed.notify_all()
+
+    def wait(self, version: int, timeout: float) -> int:
+        with self._changed:
+            self._changed.wait_for(lambda: self._version != version, timeout)
+            return self._version
+
+
+feed = EventFeed()
+
+
+def read(consumer: Optional[str] = None, after: Optional[int] = None,
+         limit: int = 1000, wait: float = 0.0) -> List[Dict[str, Any]]:
+    """
+    Events with seq > after (default: the consumer's committed offset), oldest
+    first. With wait > 0, blocks up to that many seconds for the first event.
+    """
+    if after is None:
+        after = committed_offset(consumer) if consumer else 0
+    limit = max(1, min(limit, MAX_READ))
+    deadline = time.monotonic() + wait
+    version = feed.wait(-1, 0)
+    while True:
+        events = _fetch(after, limit)
+        remaining = deadline - time.monotonic()
+        if events or remaining <= 0:
+            return events
+        version = feed.wait(version, min(remaining, POLL_SECONDS))
+
+
+def _fetch(after: int, limit: int) -> List[Dict[str, Any]]:
+    with SessionLocal() as session:
+        rows = (session.query(ResultEvent).filter(ResultEvent.seq > after)
+                .order_by(ResultEvent.seq).limit(limit).all())
+        return [{
+            "seq": row.seq,
+            "event_type": row.event_type,
+            "result_id": str(row.result_id),
+            "company_id": None if row.company_id is None else str(row.company_id),
+            "created_at": row.created_at.isoformat(),
+            "payload": row.payload,
+        } for row in rows]
+
+
+def committed_offset(consumer: str) -> int:
+    with SessionLocal() as session:
+        row = session.get(ConsumerOffset, consumer)
+        return row.seq if row else 0
+
+
+def commit_offset(consumer: str, seq: int) -> int:
+    """Advance the consumer's offset (never moves it backwards); returns the stored value"""
+    with SessionLocal() as session:
+        row = session.get(ConsumerOffset, consumer)
+        if row is None:
+            row = ConsumerOffset(consumer=consumer, seq=0)
+            session.add(row)
+        row.seq = max(row.seq, seq)
+        session.commit()
+        return row.seq
+
+
+def offsets() -> Dict[str, Any]:
+    with SessionLocal() as session:
+        head = session.query(func.max(ResultEvent.seq)).scalar() or 0
+        return {
+            "head": head,
+            "consumers": {row.consumer: {"seq": row.seq, "lag": head - row.seq,
+                                         "updated_at": row.updated_at.isoformat() if row.updated_at else None}
+                          for row in session.query(ConsumerOffset).all()},
+        }
+
+
+def prune(now: Optional[datetime] = None) -> int:
+    cutoff = (now or datetime.utcnow()) - timedelta(hours=RETENTION_HOURS)
+    with SessionLocal() as session:
+        committed = dict(session.query(ConsumerOffset.consumer, ConsumerOffset.seq).all())
+        head = session.query(func.max(ResultEvent.seq)).scalar() or 0
+        # The newest event always stays: tables created without AUTOINCREMENT would restart seq otherwise
+        query = session.query(ResultEvent).filter(ResultEvent.created_at < cutoff, ResultEvent.seq < head)
+        if committed:
+            query = query.filter(ResultEvent.seq <= min(committed.values()))
+        deleted = query.delete(synchronize_session=False)
+        session.commit()
+    return deleted
+
+
+committer = GroupCommitter()
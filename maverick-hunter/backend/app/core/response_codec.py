@@ -0,0 +1,114 @@
+"""
+Compact binary encoding for assessment responses
+
+A response set is stored as a fixed-size blob instead of a JSON object
+keyed by item code:
+
+    [bank version: 1 byte][missing bitmap: ceil(n/8)][3-bit values: ceil(3n/8)]
+
+Item codes never hit the row: bit i always means item i of the versioned
+item bank. Likert answers 1-5 are stored as 0-4 in 3 bits (little-endian
+bit order); unanswered items are flagged in the bitmap and stored as 0.
+For the 38-item bank this is 21 bytes per row vs ~500 bytes of JSON.
+
+Batch encode/decode work on (rows, items) uint8 matrices with NumPy bit
+packing, so scans and exports decode thousands of rows per call. JSON
+({code: value}) only exists at the API edge (encode() / decode()).
+
+Never reorder or edit a published bank: add a new version instead, old
+rows keep decoding against the bank they were written with.
+"""
+
+from typing import Dict, Iterable, List, Optional, Tuple
+
+import numpy as np
+
+from app.core.assessment import ALL_ITEMS
+
+LIKERT_MIN, LIKERT_MAX = 1, 5
+VALUE_BITS = 3
+
+ITEM_BANKS: Dict[int, Tuple[str, ...]] = {
+    1: tuple(item.code for item in ALL_ITEMS),
+}
+CURRENT_BANK = max(ITEM_BANKS)
+
+_INDEX = {version: {code: i for i, code in enumerate(codes)} for version, codes in ITEM_BANKS.items()}
+_WEIGHTS = (1 << np.arange(VALUE_BITS)).astype(np.uint8)
+
+
+def blob_size(version: int = CURRENT_BANK) -> int:
+    n = len(ITEM_BANKS[version])
+    return 1 + (n + 7) // 8 + (VALUE_BITS * n + 7) // 8
+
+
+def encode_batch(values: np.ndarray, version: int = CURRENT_BANK) -> np.ndarray:
+    """(rows, items) uint8 matrix, 0 = missing, 1-5 = answer -> (rows, blob_size) uint8"""
+    values = np.asarray(values, dtype=np.uint8)
+    rows, n = values.shape
+    if n != len(ITEM_BANKS[version]):
+        raise ValueError(f"expected {len(ITEM_BANKS[version])} items for bank v{version}, got {n}")
+    if values.max(initial=0) > LIKERT_MAX:
+        raise ValueError("Likert values must be 1-5 (0 = missing)")
+
+    missing = values == 0
+    codes = np.where(missing, 0, values - LIKERT_MIN).astype(np.uint8)
+    bits = np.unpackbits(codes[:, :, None], axis=2, bitorder="little")[:, :, :VALUE_BITS]
+    out = np.empty((rows, blob_size(version)), dtype=np.uint8)
+    bitmap_end = 1 + (n + 7) // 8
+    out[:, 0] = version
+    out[:, 1:bitmap_end] = np.packbits(missing, axis=1, bitorder="little")
+    out[:, bitmap_end:] = np.packbits(bits.reshape(rows, n * VALUE_BITS), axis=1, bitorder="little")
+    return out
+
+
+def decode_batch(blobs: np.ndarray) -> Tuple[int, np.ndarray]:
+    """(rows, blob_size) uint8 -> (bank version, (rows, items) uint8 matrix with 0 = missing)"""
+    blobs = np.asarray(blobs, dtype=np.uint8)
+    versions = np.unique(blobs[:, 0])
+    if versions.size != 1:
+        raise ValueError("decode_batch needs rows of a single bank version (see group_by_version)")
+    version = int(versions[0])
+    if version not in ITEM_BANKS or blobs.shape[1] != blob_size(version):
+        raise ValueError(f"unknown item bank v{version} or truncated blob")
+
+    rows, n = blobs.shape[0], len(ITEM_BANKS[version])
+    bitmap_end = 1 + (n + 7) // 8
+    missing = np.unpackbits(blobs[:, 1:bitmap_end], axis=1, count=n, bitorder="little").astype(bool)
+    bits = np.unpackbits(blobs[:, bitmap_end:], axis=1, count=n * VALUE_BITS, bitorder="little")
+    values = bits.reshape(rows, n, VALUE_BITS) @ _WEIGHTS + LIKERT_MIN
+    values[missing] = 0
+    return version, values
+
+
+def group_by_version(blobs: Iterable[bytes]) -> Dict[int, Tuple[List[int], np.ndarray]]:
+    """Stack raw blobs into one matrix per bank version: {version: (row positions, blob matrix)}"""
+    groups: Dict[int, List[Tuple[int, bytes]]] = {}
+    for i, blob in enumerate(blobs):
+        if blob:
+            groups.setdefault(blob[0], []).append((i, blob))
+    return {
+        version: ([i for i, _ in rows],
+                  np.frombuffer(b"".join(b for _, b in rows), dtype=np.uint8).reshape(len(rows), -1))
+        for version, rows in groups.items()
+    }
+
+
+# ----------------------------------------------------------------------
+# API edge
+# ----------------------------------------------------------------------
+def encode(answers: Dict[str, int], version: int = CURRENT_BANK) -> Optional[bytes]:
+    """{item code: 1-5} -> blob, or None if any code is outside the bank or a value out of range"""
+    index = _INDEX[version]
+    row = np.zeros((1, len(index)), dtype=np.uint8)
+    for code, value in answers.items():
+        i = index.get(code)
+        if i is None or not LIKERT_MIN <= value <= LIKERT_MAX:
+            return None
+        row[0, i] = value
+    return encode_batch(row, version)[0].tobytes()
+
+
+def decode(blob: bytes) -> Dict[str, int]:
+    version, values = decode_batch(np.frombuffer(blob, dtype=np.uint8)[None, :])
+    return {code: int(v) for code, v in zip(ITEM_BANKS[version], values[0]) if v}
@@ -2,12 +2,19 @@
 Maverick Hunter - FastAPI Main Application
 """
 
+import os
 from fastapi import FastAPI
 from fastapi.middleware.cors import CORSMiddleware
 from contextlib import asynccontextmanager
 
-from app.routes import assessments, candidates, results
+from app.routes import admin, assessments, candidates, results
 from app.models.database import init_db
+from app.core.bifactor import registry
+from app.core.tracing import TracedRoute, TracingMiddleware
+from app.core.admission import AdmissionMiddleware
+from app.core.api_keys import key_table
+from app.models import partitioning
+from app.core import outbox
 
 
 @asynccontextmanager
@@ -15,8 +22,20 @@ async def lifespan(app: FastAPI):
     """Startup and shutdown events"""
     # Startup
     init_db()
+    partitioning.run_maintenance()  # current month's partition must exist before the first insert
+    partitioning.start_maintenance()
+    outbox.committer.start()
+    key_table.start()
+    registry.start_watcher()
+    if os.getenv("MAVERICK_PREWARM") == "1":
+        from app.warmup import warm
+        warm()
     yield
     # Shutdown
+    registry.stop_watcher()
+    key_table.stop()
+    partitioning.stop_maintenance()
+    outbox.committer.stop()
 
 
 app = FastAPI(
@@ -38,6 +57,9 @@ app = FastAPI(
     lifespan=lifespan
 )
 
+# Tenant admission (innermost: CORS preflights and tracing wrap it)
+app.add_middleware(AdmissionMiddleware)
+
 # CORS
 app.add_middleware(
     CORSMiddleware,
@@ -47,10 +69,15 @@ app.add_middleware(
     allow_headers=["*"],
 )
 
+# Tracing (outermost, so spans cover every other middleware)
+app.add_middleware(TracingMiddleware)
+app.router.route_class = TracedRoute
+
 # Routes
 app.include_router(assessments.router, prefix="/api/v1/assessments", tags=["Assessments"])
 app.include_router(candidates.router, prefix="/api/v1/candidates", tags=["Candidates"])
 app.include_router(results.router, prefix="/api/v1/results", tags=["Results"])
+app.include_router(admin.router, prefix="/admin", tags=["Admin"])
 
 
 @app.get("/")
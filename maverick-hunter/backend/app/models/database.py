@@ -1,4 +1,6 @@
-from sqlalchemy import create_engine
+import re
+
+from sqlalchemy import MetaData, create_engine, inspect, text
 from sqlalchemy.ext.declarative import declarative_base
 from sqlalchemy.orm import sessionmaker
 from sqlalchemy.types import TypeDecorator, CHAR, String
@@ -6,6 +8,8 @@ from sqlalchemy.dialects.postgresql import UUID
 import uuid
 import os
 
+from app.core.tracing import instrument_sqlalchemy
+
 # --- INICIO DEL PARCHE MAVERICK ---
 class GUID(TypeDecorator):
     """
@@ -48,6 +52,7 @@ connect_args = {"check_same_thread": False} if "sqlite" in SQLALCHEMY_DATABASE_U
 engine = create_engine(
     SQLALCHEMY_DATABASE_URL, connect_args=connect_args
 )
+instrument_sqlalchemy(engine)
 SessionLocal = sessionmaker(autocommit=False, autoflush=False, bind=engine)
 
 Base = declarative_base()
@@ -61,3 +66,46 @@ def get_db():
 
 def init_db():
     Base.metadata.create_all(bind=engine)
+    add_missing_columns()
+
+
+def copy_table(table, name):
+    """`table`'s columns, keys and indexes under another name (indexes renamed after it)"""
+    metadata = MetaData()
+    for key in table.foreign_keys:
+        key.column.table.to_metadata(metadata)  # referenced tables, so the copy's foreign keys resolve
+    copy = table.to_metadata(metadata, name=name)
+    for index in copy.indexes:
+        if not index.name.startswith(f"ix_{name}_"):
+            index.name = index.name.replace(table.name, name, 1)
+    return copy
+
+
+def add_missing_columns():
+    """
+    create_all() never alters existing tables: add any new nullable columns
+    and missing indexes so databases created by older versions (e.g.
+    maverick.db) keep working.
+    On SQLite the month tables of a model (assessment_results_YYYY_MM, see
+    partitioning.py) are migrated like the model itself; Postgres partitions
+    inherit their parent's columns.
+    """
+    inspector = inspect(engine)
+    names = inspector.get_table_names()
+    with engine.begin() as conn:
+        for model in Base.metadata.sorted_tables:
+            tables = [model]
+            if engine.dialect.name != "postgresql":
+                month = re.compile(rf"{model.name}_\d{{4}}_\d{{2}}")
+                tables += [copy_table(model, name) for name in names if month.fullmatch(name)]
+            for table in tables:
+                if table.name not in names:
+                    continue
+                existing = {c["name"] for c in inspector.get_columns(table.name)}
+                for column in table.columns:
+                    if column.name in existing or not column.nullable:
+                        continue
+                    ddl_type = column.type.compile(dialect=engine.dialect)
+                    conn.execute(text(f'ALTER TABLE {table.name} ADD COLUMN {column.name} {ddl_type}'))
+                for index in table.indexes:
+                    index.create(conn, checkfirst=True)  # new columns' indexes and indexes added to the model
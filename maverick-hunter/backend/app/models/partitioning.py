@@ -0,0 +1,422 @@
+"""
+Time partitioning for assessment_results
+
+PostgreSQL: `assessment_results` is a native RANGE partitioned table on
+`timestamp` with one partition per month (assessment_results_YYYY_MM).
+Maintenance keeps PARTITION_MONTHS_AHEAD months created ahead of time;
+the planner prunes partitions for any query bounded on `timestamp`.
+
+SQLite: partition-by-convention. Inserts land in `assessment_results`
+(the hot table); once a month is closed, its rows are moved to
+assessment_results_YYYY_MM and deleted from the hot table. Readers use
+partitions_for() to visit only the tables that overlap their time range.
+
+On both: partitions older than ARCHIVE_AFTER_MONTHS are compacted into
+the columnar archive (ARCHIVE_DIR/assessment_results/YYYY-MM.npz, one
+compressed array per column and batch of ARCHIVE_BATCH_ROWS rows, raw_data
+as JSON) and dropped, so the hot table and its indexes stay bounded no
+matter how many years accumulate. Archives are written and read one batch
+at a time, and only the columns a reader touches are decompressed.
+"""
+
+import json
+import logging
+import os
+import threading
+import uuid
+import zipfile
+from collections.abc import Mapping
+from datetime import datetime
+from types import SimpleNamespace
+from typing import Any, Dict, Iterable, Iterator, List, Optional, Sequence, Tuple
+
+import numpy as np
+from sqlalchemy import Table, select, text
+
+from .database import copy_table, engine
+from .schemas import AssessmentResult
+
+logger = logging.getLogger(__name__)
+
+TABLE = "assessment_results"
+ARCHIVE_DIR = os.getenv("ARCHIVE_DIR", "./archive")
+MONTHS_AHEAD = int(os.getenv("PARTITION_MONTHS_AHEAD", "2"))
+ARCHIVE_AFTER_MONTHS = int(os.getenv("ARCHIVE_AFTER_MONTHS", "12"))
+MAINTENANCE_SECONDS = float(os.getenv("PARTITION_MAINTENANCE_SECONDS", "3600"))
+ARCHIVE_BATCH_ROWS = int(os.getenv("ARCHIVE_BATCH_ROWS", "50000"))
+
+Month = Tuple[int, int]
+
+UUID_COLUMNS = ("id", "candidate_id", "assessment_id", "company_id")
+FLOAT_COLUMNS = (
+    "narcissism_score", "machiavellianism_score", "psychopathy_score", "sadism_score",
+    "openness", "conscientiousness", "extraversion", "agreeableness", "neuroticism",
+)
+TEXT_COLUMNS = ("risk_level", "model_version")
+BINARY_COLUMNS = ("responses",)
+
+
+# ----------------------------------------------------------------------
+# Month arithmetic
+# ----------------------------------------------------------------------
+def month_of(ts: datetime) -> Month:
+    return ts.year, ts.month
+
+
+def add_months(month: Month, n: int) -> Month:
+    index = month[0] * 12 + month[1] - 1 + n
+    return index // 12, index % 12 + 1
+
+
+def month_start(month: Month) -> datetime:
+    return datetime(month[0], month[1], 1)
+
+
+def partition_name(month: Month) -> str:
+    return f"{TABLE}_{month[0]:04d}_{month[1]:02d}"
+
+
+def archive_path(month: Month) -> str:
+    return os.path.join(ARCHIVE_DIR, TABLE, f"{month[0]:04d}-{month[1]:02d}.npz")
+
+
+def _months_between(start: Month, end: Month) -> Iterator[Month]:
+    while start <= end:
+        yield start
+        start = add_months(start, 1)
+
+
+# ----------------------------------------------------------------------
+# Catalogue
+# ----------------------------------------------------------------------
+def is_postgres() -> bool:
+    return engine.dialect.name == "postgresql"
+
+
+def existing_partitions(conn) -> List[Month]:
+    if is_postgres():
+        rows = conn.execute(text(
+            "SELECT c.relname FROM pg_inherits i JOIN pg_class c ON c.oid = i.inhrelid "
+            "JOIN pg_class p ON p.oid = i.inhparent WHERE p.relname = :table"
+        ), {"table": TABLE}).fetchall()
+    else:
+        rows = conn.execute(text(
+            "SELECT name FROM sqlite_master WHERE type = 'table' AND name GLOB :pattern"
+        ), {"pattern": f"{TABLE}_[0-9][0-9][0-9][0-9]_[0-9][0-9]"}).fetchall()
+    months = []
+    for (name,) in rows:
+        suffix = name[len(TABLE) + 1:].split("_")
+        if len(suffix) == 2 and all(part.isdigit() for part in suffix):
+            months.append((int(suffix[0]), int(suffix[1])))
+    return sorted(months)
+
+
+def archived_months() -> List[Month]:
+    directory = os.path.join(ARCHIVE_DIR, TABLE)
+    if not os.path.isdir(directory):
+        return []
+    return sorted((int(f[:4]), int(f[5:7])) for f in os.listdir(directory) if f.endswith(".npz"))
+
+
+def _in_range(months: List[Month], start: Optional[datetime], end: Optional[datetime]) -> List[Month]:
+    lo = month_of(start) if start else None
+    hi = month_of(end) if end else None
+    return [m for m in months if (lo is None or m >= lo) and (hi is None or m <= hi)]
+
+
+def partitions_for(start: Optional[datetime] = None, end: Optional[datetime] = None) -> List[str]:
+    """
+    Tables to scan for rows with start <= timestamp < end (newest first).
+
+    On Postgres this is always the parent table: the planner prunes. On
+    SQLite it is the hot table plus only the month tables in range.
+    """
+    if is_postgres():
+        return [TABLE]
+    with engine.connect() as conn:
+        months = existing_partitions(conn)
+    return [TABLE] + [partition_name(m) for m in reversed(_in_range(months, start, end))]
+
+
+_tables: Dict[str, Table] = {}
+
+
+def partition_table(name: str) -> Table:
+    """Core Table for a month table: assessment_results' columns, types, primary key and indexes"""
+    if name == TABLE:
+        return AssessmentResult.__table__
+    table = _tables.get(name)
+    if table is None:
+        table = _tables[name] = copy_table(AssessmentResult.__table__, name)
+    return table
+
+
+def find_result(db, column: str, value: Any, start: Optional[datetime] = None) -> Optional[Any]:
+    """
+    First row with `column == value` and timestamp >= start: hot table and
+    in-range partitions first, then in-range archive months. Rows come back
+    with attribute access like AssessmentResult instances.
+    """
+    for name in partitions_for(start):
+        table = partition_table(name)
+        query = select(table).where(table.c[column] == value)
+        if start is not None:
+            query = query.where(table.c.timestamp >= start)
+        row = db.execute(query.limit(1)).first()
+        if row is not None:
+            return row
+
+    target = str(value)
+    for month in reversed(_in_range(archived_months(), start, None)):
+        for columns in iter_archive(month):
+            if column not in columns:
+                continue
+            hits = np.flatnonzero(columns[column] == target)
+            if hits.size:
+                return archived_row(columns, int(hits[0]))
+    return None
+
+
+# ----------------------------------------------------------------------
+# Maintenance
+# ----------------------------------------------------------------------
+def ensure_partitions(now: Optional[datetime] = None) -> List[str]:
+    """Postgres: create this month's partition and MONTHS_AHEAD more"""
+    if not is_postgres():
+        return []
+    current = month_of(now or datetime.utcnow())
+    created = []
+    with engine.begin() as conn:
+        if not conn.execute(text(
+            "SELECT 1 FROM pg_partitioned_table t JOIN pg_class c ON c.oid = t.partrelid WHERE c.relname = :table"
+        ), {"table": TABLE}).first():
+            logger.warning("%s is not partitioned (created before partitioning); skipping", TABLE)
+            return []
+        existing = set(existing_partitions(conn))
+        for month in _months_between(current, add_months(current, MONTHS_AHEAD)):
+            if month in existing:
+                continue
+            conn.execute(text(
+                f"CREATE TABLE {partition_name(month)} PARTITION OF {TABLE} "
+                f"FOR VALUES FROM ('{month_start(month):%Y-%m-%d}') TO ('{month_start(add_months(month, 1)):%Y-%m-%d}')"
+            ))
+            created.append(partition_name(month))
+    return created
+
+
+def roll_closed_months(now: Optional[datetime] = None) -> List[str]:
+    """SQLite: move rows of closed months out of the hot table into month tables"""
+    if is_postgres():
+        return []
+    current = month_start(month_of(now or datetime.utcnow()))
+    # By name: month tables migrated by add_missing_columns() may order their columns differently
+    columns = ", ".join(c.name for c in AssessmentResult.__table__.columns)
+    rolled = []
+    with engine.begin() as conn:
+        oldest = conn.execute(text(f"SELECT MIN(timestamp) FROM {TABLE} WHERE timestamp < :current"),
+                              {"current": _sqlite_time(current)}).scalar()
+        if oldest is None:
+            return []
+        for month in _months_between(month_of(_as_datetime(oldest)), add_months(month_of(current), -1)):
+            name = partition_name(month)
+            bounds = {"lo": _sqlite_time(month_start(month)), "hi": _sqlite_time(month_start(add_months(month, 1)))}
+            if conn.execute(text(f"SELECT 1 FROM {TABLE} WHERE timestamp >= :lo AND timestamp < :hi LIMIT 1"),
+                            bounds).first() is None:
+                continue
+            partition_table(name).create(conn, checkfirst=True)
+            moved = conn.execute(text(
+                f"INSERT INTO {name} ({columns}) SELECT {columns} FROM {TABLE} WHERE timestamp >= :lo AND timestamp < :hi"
+            ), bounds).rowcount
+            conn.execute(text(f"DELETE FROM {TABLE} WHERE timestamp >= :lo AND timestamp < :hi"), bounds)
+            rolled.append(name)
+            logger.info("rolled %d rows into %s", moved, name)
+    return rolled
+
+
+def archive_old_partitions(now: Optional[datetime] = None) -> List[str]:
+    """Compact partitions older than ARCHIVE_AFTER_MONTHS into the columnar archive and drop them"""
+    cutoff = add_months(month_of(now or datetime.utcnow()), -ARCHIVE_AFTER_MONTHS)
+    archived = []
+    with engine.connect() as conn:
+        months = [m for m in existing_partitions(conn) if m < cutoff]
+    for month in months:
+        name = partition_name(month)
+        with engine.begin() as conn:
+            rows = conn.execution_options(yield_per=ARCHIVE_BATCH_ROWS).execute(
+                text(f"SELECT * FROM {name} ORDER BY timestamp, id")).mappings()
+            count = write_archive(month, rows.partitions())
+            if is_postgres():
+                conn.execute(text(f"ALTER TABLE {TABLE} DETACH PARTITION {name}"))
+            conn.execute(text(f"DROP TABLE {name}"))
+        archived.append(name)
+        logger.info("archived %s (%d rows) to %s", name, count, archive_path(month))
+    return archived
+
+
+def backfill_company(company_id: uuid.UUID) -> Dict[str, Any]:
+    """
+    Assign every result stored without a tenant (written before company_id
+    existed, or with admission control off) to `company_id`: NULL columns in
+    the tables, and archives rewritten batch by batch. Tenant exports only
+    ever see rows carrying their company_id.
+    """
+    rows = 0
+    with engine.begin() as conn:
+        for name in partitions_for():
+            table = partition_table(name)
+            rows += conn.execute(
+                table.update().where(table.c.company_id.is_(None)).values(company_id=company_id)).rowcount
+    rewritten = []
+    for month in archived_months():
+        if any("company_id" not in columns or (columns["company_id"] == "").any() for columns in iter_archive(month)):
+            write_archive(month, _with_company(month, str(company_id)))
+            rewritten.append(archive_path(month))
+    return {"rows": rows, "archives": rewritten}
+
+
+def _with_company(month: Month, company_id: str) -> Iterator[List[Dict[str, Any]]]:
+    for columns in iter_archive(month):
+        batch = [vars(archived_row(columns, i)) for i in range(len(columns["id"]))]
+        for row in batch:
+            row["company_id"] = row["company_id"] or company_id
+        yield batch
+
+
+def run_maintenance(now: Optional[datetime] = None) -> Dict[str, List[str]]:
+    return {
+        "created": ensure_partitions(now),
+        "rolled": roll_closed_months(now),
+        "archived": archive_old_partitions(now),
+    }
+
+
+_stop = threading.Event()
+
+
+def start_maintenance(interval: float = MAINTENANCE_SECONDS) -> None:
+    def loop():
+        while not _stop.wait(interval):
+            try:
+                run_maintenance()
+            except Exception:
+                logger.exception("partition maintenance failed")
+
+    _stop.clear()
+    threading.Thread(target=loop, name="partition-maintenance", daemon=True).start()
+
+
+def stop_maintenance() -> None:
+    _stop.set()
+
+
+# ----------------------------------------------------------------------
+# Columnar archive
+# ----------------------------------------------------------------------
+def write_archive(month: Month, batches: Iterable[Sequence[Dict[str, Any]]]) -> int:
+    """
+    Rows (in timestamp, id order) batch by batch: each batch becomes one
+    compressed `<column>/<batch>` array per column, so only one batch is
+    ever held in memory. Returns the number of rows written.
+    """
+    path = archive_path(month)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    tmp = path + ".tmp.npz"
+    count = 0
+    with zipfile.ZipFile(tmp, "w", zipfile.ZIP_DEFLATED, allowZip64=True) as archive:
+        for batch, rows in enumerate(batches):
+            for name, values in _archive_columns(rows).items():
+                with archive.open(f"{name}/{batch:06d}.npy", "w", force_zip64=True) as member:
+                    np.lib.format.write_array(member, values, allow_pickle=False)
+            count += len(rows)
+    os.replace(tmp, path)
+    return count
+
+
+def _archive_columns(rows: Sequence[Dict[str, Any]]) -> Dict[str, np.ndarray]:
+    """One array per column; raw_data and blobs are concatenated bytes + offsets"""
+    columns: Dict[str, np.ndarray] = {}
+    for name in UUID_COLUMNS:
+        columns[name] = np.array(["" if r.get(name) is None else str(r[name]) for r in rows], dtype="U36")
+    for name in FLOAT_COLUMNS:
+        columns[name] = np.array([np.nan if r[name] is None else r[name] for r in rows], dtype=np.float64)
+    for name in TEXT_COLUMNS:
+        columns[name] = np.array(["" if r[name] is None else r[name] for r in rows], dtype=str)
+    columns["timestamp"] = np.array([_as_datetime(r["timestamp"]) for r in rows], dtype="datetime64[us]")
+
+    blobs = [_raw_json(r["raw_data"]) for r in rows]
+    columns["raw_offsets"] = np.cumsum([0] + [len(b) for b in blobs], dtype=np.int64)
+    columns["raw_json"] = np.frombuffer(b"".join(blobs), dtype=np.uint8)
+    for name in BINARY_COLUMNS:
+        blobs = [r.get(name) or b"" for r in rows]
+        columns[f"{name}_offsets"] = np.cumsum([0] + [len(b) for b in blobs], dtype=np.int64)
+        columns[name] = np.frombuffer(b"".join(blobs), dtype=np.uint8)
+    return columns
+
+
+class ArchiveBatch(Mapping):
+    """Columns of one archive batch, decompressed on first access"""
+
+    def __init__(self, archive, suffix: str):
+        self._archive = archive
+        self._suffix = suffix
+        self._names = [f[:len(f) - len(suffix)] for f in archive.files if f.endswith(suffix)]
+        self._loaded: Dict[str, np.ndarray] = {}
+
+    def __getitem__(self, name: str) -> np.ndarray:
+        if name not in self._loaded:
+            if name not in self._names:
+                raise KeyError(name)
+            self._loaded[name] = self._archive[name + self._suffix]
+        return self._loaded[name]
+
+    def __iter__(self) -> Iterator[str]:
+        return iter(self._names)
+
+    def __len__(self) -> int:
+        return len(self._names)
+
+
+def iter_archive(month: Month) -> Iterator[ArchiveBatch]:
+    """Batches of a month in row order; archives written before batching are a single batch"""
+    with np.load(archive_path(month)) as archive:
+        suffixes = sorted({f[f.index("/"):] for f in archive.files if "/" in f}) or [""]
+        for suffix in suffixes:
+            yield ArchiveBatch(archive, suffix)
+
+
+def archived_raw_data(columns: Dict[str, np.ndarray], i: int) -> Any:
+    start, end = columns["raw_offsets"][i], columns["raw_offsets"][i + 1]
+    return json.loads(columns["raw_json"][start:end].tobytes()) if end > start else None
+
+
+def archived_row(columns: Dict[str, np.ndarray], i: int) -> SimpleNamespace:
+    row: Dict[str, Any] = {}
+    for name in UUID_COLUMNS:
+        row[name] = uuid.UUID(columns[name][i]) if name in columns and columns[name][i] else None
+    for name in FLOAT_COLUMNS:
+        row[name] = None if np.isnan(columns[name][i]) else float(columns[name][i])
+    for name in TEXT_COLUMNS:
+        row[name] = str(columns[name][i]) or None
+    row["timestamp"] = columns["timestamp"][i].astype(datetime)
+    row["raw_data"] = archived_raw_data(columns, i)
+    for name in BINARY_COLUMNS:
+        offsets = columns.get(f"{name}_offsets")  # absent in archives written before the column existed
+        start, end = (offsets[i], offsets[i + 1]) if offsets is not None else (0, 0)
+        row[name] = columns[name][start:end].tobytes() if end > start else None
+    return SimpleNamespace(**row)
+
+
+def _raw_json(value: Any) -> bytes:
+    if value is None:
+        return b""
+    if isinstance(value, str):
+        return value.encode()  # SQLite text mode returns the stored JSON as-is
+    return json.dumps(value, separators=(",", ":")).encode()
+
+
+def _sqlite_time(value: datetime) -> str:
+    return value.isoformat(" ")  # the format SQLAlchemy stores DateTime in on SQLite
+
+
+def _as_datetime(value: Any) -> datetime:
+    return datetime.fromisoformat(value) if isinstance(value, str) else value
@@ -1,6 +1,6 @@
 from datetime import datetime
 from typing import Optional, List
-from sqlalchemy import Column, String, Integer, Float, DateTime, ForeignKey, Enum as SQLEnum, JSON, Text, Boolean
+from sqlalchemy import Column, String, Integer, Float, DateTime, ForeignKey, Enum as SQLEnum, JSON, Text, Boolean, LargeBinary, Index, BigInteger
 from sqlalchemy.orm import relationship
 import uuid
 import enum
@@ -32,11 +32,18 @@ class Candidate(Base):
     phone = Column(String, nullable=True)
     linkedin_url = Column(String, nullable=True)
     created_at = Column(DateTime, default=datetime.utcnow)
+    cluster_id = Column(GUID(), nullable=True, index=True)  # Oldest candidate of the same person (core/dedupe.py)
     
     # Relaciones
     results = relationship("AssessmentResult", back_populates="candidate")
     assessments = relationship("Assessment", back_populates="candidate")
 
+class CandidateBlockKey(Base):
+    """Blocking keys for incremental duplicate detection"""
+    __tablename__ = "candidate_block_keys"
+    key = Column(String, primary_key=True)
+    candidate_id = Column(GUID(), ForeignKey("candidates.id"), primary_key=True)
+
 class Assessment(Base):
     __tablename__ = "assessments"
     id = Column(GUID(), primary_key=True, default=uuid.uuid4)
@@ -47,9 +54,18 @@ class Assessment(Base):
     candidate = relationship("Candidate", back_populates="assessments")
 
 class AssessmentResult(Base):
+    # Monthly RANGE partitions on Postgres, month tables on SQLite (see partitioning.py).
+    # Postgres requires the partition key in the primary key.
     __tablename__ = "assessment_results"
+    __table_args__ = (
+        Index("ix_assessment_results_company_time", "company_id", "timestamp", "id"),  # export order
+        Index("ix_assessment_results_time", "timestamp", "id"),  # export order without a tenant (admission off)
+        {"postgresql_partition_by": "RANGE (timestamp)"},
+    )
     id = Column(GUID(), primary_key=True, default=uuid.uuid4)
     candidate_id = Column(GUID(), ForeignKey("candidates.id"))
+    company_id = Column(GUID(), ForeignKey("companies.id"), nullable=True)  # Tenant that submitted it
+    assessment_id = Column(GUID(), ForeignKey("assessments.id"), nullable=True, index=True)
     narcissism_score = Column(Float)
     machiavellianism_score = Column(Float)
     psychopathy_score = Column(Float)
@@ -61,10 +77,33 @@ class AssessmentResult(Base):
     neuroticism = Column(Float)
     risk_level = Column(String)
     raw_data = Column(JSON)
-    timestamp = Column(DateTime, default=datetime.utcnow)
+    responses = Column(LargeBinary, nullable=True)  # Packed answers, see core/response_codec.py
+    model_version = Column(String, nullable=True)  # Bifactor parameter set used for scoring
+    timestamp = Column(DateTime, primary_key=True, default=datetime.utcnow)
 
     candidate = relationship("Candidate", back_populates="results")
 
+class ResultEvent(Base):
+    """Append-only outbox, written in the same transaction as the result (see core/outbox.py)"""
+    __tablename__ = "result_events"
+    # AUTOINCREMENT: without it SQLite reuses seq values once prune() empties the table,
+    # and consumers whose offset is past them would silently skip the new events
+    __table_args__ = {"sqlite_autoincrement": True}
+    seq = Column(BigInteger().with_variant(Integer, "sqlite"), primary_key=True, autoincrement=True)
+    event_type = Column(String, nullable=False)
+    result_id = Column(GUID(), nullable=False)
+    company_id = Column(GUID(), nullable=True)
+    payload = Column(JSON, nullable=False)
+    created_at = Column(DateTime, default=datetime.utcnow, nullable=False)
+
+
+class ConsumerOffset(Base):
+    """Last event seq each downstream consumer has processed"""
+    __tablename__ = "result_event_offsets"
+    consumer = Column(String, primary_key=True)
+    seq = Column(BigInteger, nullable=False, default=0)
+    updated_at = Column(DateTime, default=datetime.utcnow, onupdate=datetime.utcnow)
+
 # --- Alias para compatibilidad con código legacy ---
 # Si tu código viejo busca "Result", le damos "AssessmentResult"
 Result = AssessmentResult
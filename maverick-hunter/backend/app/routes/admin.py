@@ -0,0 +1,95 @@
+"""
+Admin Routes - operational endpoints (token protected)
+"""
+
+from fastapi import APIRouter, Depends, HTTPException, Query
+from fastapi.responses import PlainTextResponse, Response
+from typing import Optional
+from uuid import UUID
+
+from app.core import admission, dedupe, outbox, profiler
+from app.core.admin_auth import require_admin
+from app.models import partitioning
+from app.models.database import SessionLocal
+from app.models.schemas import Company
+from app.core.api_keys import key_table
+from app.core.tracing import TracedRoute
+
+router = APIRouter(route_class=TracedRoute, dependencies=[Depends(require_admin)])
+
+
+@router.post("/profile")
+def profile_worker(
+    seconds: float = Query(10.0, description="Sampling window (max 60s)"),
+    hz: int = Query(100, description="Samples per second"),
+    format: str = Query("collapsed", pattern="^(collapsed|svg)$"),
+    mode: str = Query("auto", pattern="^(auto|native|python)$")
+):
+    """
+    Sample this worker and return a collapsed-stack file or a flamegraph SVG.
+    Runs in the threadpool, so the event loop keeps serving (and is sampled).
+    """
+    try:
+        stacks, backend = profiler.profile(seconds, hz, mode)
+    except profiler.ProfilerBusy as e:
+        raise HTTPException(status_code=409, detail=str(e))
+    except RuntimeError as e:
+        raise HTTPException(status_code=501, detail=f"Native profiling unavailable: {e}")
+
+    headers = {"X-Profiler-Backend": backend}
+    if format == "svg":
+        svg = profiler.flamegraph_svg(stacks, title=f"maverick-backend ({backend}, {seconds}s)")
+        return Response(svg, media_type="image/svg+xml", headers=headers)
+    return PlainTextResponse(profiler.collapsed(stacks), headers=headers)
+
+
+@router.get("/admission")
+def admission_status():
+    """Free slots, queue depths and per-tenant admitted / rate-limited / shed counts"""
+    return admission.controller.status()
+
+
+@router.get("/events")
+def tail_events(
+    consumer: Optional[str] = Query(None, description="Start after this consumer's committed offset"),
+    after: Optional[int] = Query(None, description="Start after this seq (overrides consumer)"),
+    limit: int = Query(1000, ge=1, le=outbox.MAX_READ),
+    wait: float = Query(0.0, ge=0.0, le=30.0, description="Long-poll seconds when nothing is pending")
+):
+    """Result events in seq order (outbox tail for downstream consumers)"""
+    events = outbox.read(consumer, after, limit, wait)
+    return {"events": events, "next": events[-1]["seq"] if events else after}
+
+
+@router.put("/events/offsets/{consumer:path}")  # names may contain "/"
+def commit_event_offset(consumer: str, seq: int = Query(..., ge=0)):
+    """Record that `consumer` has durably processed every event up to `seq`"""
+    return {"consumer": consumer, "seq": outbox.commit_offset(consumer, seq)}
+
+
+@router.get("/events/offsets")
+def event_offsets():
+    """Head seq, per-consumer offset and lag, group-commit stats"""
+    return {**outbox.offsets(), "group_commit": outbox.committer.status()}
+
+
+@router.post("/results/backfill-company")
+def backfill_result_company(company_id: UUID = Query(..., description="Tenant that owns the untagged results")):
+    """Attribute results stored without a company (legacy / admission off) so the tenant export includes them"""
+    with SessionLocal() as session:
+        if session.get(Company, company_id) is None:
+            raise HTTPException(status_code=404, detail="Company not found")
+    return partitioning.backfill_company(company_id)
+
+
+@router.get("/duplicates")
+def duplicate_candidates(limit: int = Query(100, ge=1, le=1000)):
+    """Candidate clusters judged to be the same person, largest first"""
+    with SessionLocal() as session:
+        return dedupe.clusters(session, limit)
+
+
+@router.get("/api-keys")
+def api_key_usage():
+    """Loaded key count, invalid attempts and per-company request counters (no key material)"""
+    return key_table.status()
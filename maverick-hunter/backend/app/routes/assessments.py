@@ -1,26 +1,39 @@
-from fastapi import APIRouter, Depends, HTTPException
+from fastapi import APIRouter, Depends, HTTPException, Request
+from sqlalchemy import or_
 from sqlalchemy.orm import Session
 from app.models.database import get_db
 # Importamos TODO lo que definimos en schemas
 from app.models.schemas import Assessment, Candidate, Company, Response, Result, AssessmentStatus
+from app.core.assessment import calculate_all_scores
+from app.core import dedupe, outbox, response_codec
+from app.core.bifactor import PsychometricScores, registry
+from app.core.tracing import TracedRoute, span
 from pydantic import BaseModel
-from typing import List
+from typing import List, Optional
+import uuid
 
-router = APIRouter()
+router = APIRouter(route_class=TracedRoute)
+
+class AlreadySubmitted(Exception):
+    """The assessment was completed by an earlier (or concurrent) submit"""
 
 class AssessmentCreate(BaseModel):
     candidate_email: str
     candidate_name: str
+    candidate_phone: Optional[str] = None
+    candidate_linkedin_url: Optional[str] = None
 
 @router.post("/create")
 def create_assessment(data: AssessmentCreate, db: Session = Depends(get_db)):
     # 1. Buscar o crear candidato
     candidate = db.query(Candidate).filter(Candidate.email == data.candidate_email).first()
     if not candidate:
-        candidate = Candidate(email=data.candidate_email, full_name=data.candidate_name)
+        candidate = Candidate(email=data.candidate_email, full_name=data.candidate_name,
+                              phone=data.candidate_phone, linkedin_url=data.candidate_linkedin_url)
         db.add(candidate)
         db.commit()
         db.refresh(candidate)
+        dedupe.link_candidate(db, candidate)  # same person under another email -> same cluster
     
     # 2. Crear assessment
     new_assessment = Assessment(candidate_id=candidate.id)
@@ -30,6 +43,69 @@ def create_assessment(data: AssessmentCreate, db: Session = Depends(get_db)):
     return {"status": "created", "assessment_id": str(new_assessment.id)}
 
 @router.post("/{assessment_id}/submit")
-def submit_assessment(assessment_id: str, responses: List[Response], db: Session = Depends(get_db)):
-    # Lógica simplificada para que compile
-    return {"status": "received", "count": len(responses)}
+def submit_assessment(assessment_id: str, responses: List[Response], request: Request, db: Session = Depends(get_db)):
+    assessment = db.query(Assessment).filter(Assessment.id == assessment_id).first()
+    if not assessment:
+        raise HTTPException(status_code=404, detail="Assessment not found")
+    if assessment.status == AssessmentStatus.COMPLETED.value:
+        raise HTTPException(status_code=409, detail="Assessment already submitted")
+
+    answers = {r.question_id: r.answer_value for r in responses}
+    scores = calculate_all_scores(answers)
+    packed = response_codec.encode(answers)  # None for codes outside the item bank: keep those as JSON
+
+    # Pin one model version for the whole request (hot reloads can't split it)
+    with registry.lease() as model, span("engine.bifactor", model_version=model.version):
+        analysis = model.engine.analyze(PsychometricScores(**scores))
+
+    result = Result(
+        id=uuid.uuid4(),
+        candidate_id=assessment.candidate_id,
+        assessment_id=assessment.id,
+        company_id=getattr(request.state, "company_id", None),  # set by admission control
+        narcissism_score=scores["narcissism"],
+        machiavellianism_score=scores["machiavellianism"],
+        psychopathy_score=scores["psychopathy"],
+        sadism_score=scores["sadism"],
+        risk_level=analysis.classification.value,
+        responses=packed,
+        raw_data={
+            **({"responses": answers} if packed is None else {}),
+            "vigilance": scores["vigilance"],
+            "psycap": scores["psycap"],
+            "g_factor": analysis.g_factor,
+            "s_agency": analysis.s_agency,
+            "confidence": analysis.confidence,
+            "eib_prediction": analysis.eib_prediction,
+            "cwb_o_risk": analysis.cwb_o_risk,
+            "cwb_i_risk": analysis.cwb_i_risk,
+        },
+        model_version=model.version,
+    )
+
+    def write(session):
+        # Claim the assessment first: only one submit may flip it to completed
+        claimed = session.query(Assessment).filter(
+            Assessment.id == assessment.id,
+            or_(Assessment.status.is_(None), Assessment.status != AssessmentStatus.COMPLETED.value),
+        ).update({"status": AssessmentStatus.COMPLETED.value}, synchronize_session=False)
+        if not claimed:
+            raise AlreadySubmitted(assessment_id)
+        session.add(result)
+        outbox.record_result(session, result)
+
+    # Result, status and outbox event commit together, grouped with concurrent submits
+    try:
+        outbox.committer.submit(write)
+    except AlreadySubmitted:
+        raise HTTPException(status_code=409, detail="Assessment already submitted")
+
+    return {
+        "status": "completed",
+        "count": len(responses),
+        "result_id": str(result.id),
+        "classification": analysis.classification.value,
+        "g_factor": analysis.g_factor,
+        "s_agency": analysis.s_agency,
+        "model_version": model.version,
+    }
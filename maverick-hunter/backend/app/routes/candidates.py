@@ -9,9 +9,10 @@ from pydantic import BaseModel, EmailStr, ConfigDict
 from uuid import UUID
 
 from app.models.database import get_db
+from app.core.tracing import TracedRoute
 from app.models.schemas import Candidate, Assessment
 
-router = APIRouter()
+router = APIRouter(route_class=TracedRoute)
 
 
 class CandidateResponse(BaseModel):
@@ -2,16 +2,25 @@
 Results Routes
 """
 
-from fastapi import APIRouter, Depends, HTTPException
+from fastapi import APIRouter, Depends, Header, HTTPException, Query, Request
+from fastapi.responses import StreamingResponse
+from sqlalchemy import select
 from sqlalchemy.orm import Session
-from typing import List
+from typing import Dict, List, Optional
 from pydantic import BaseModel, ConfigDict
 from uuid import UUID
 
 from app.models.database import get_db
-from app.models.schemas import Result, Assessment
+from app.core.tracing import TracedRoute
+from app.models.schemas import Assessment
+from app.models.partitioning import find_result, partition_table, partitions_for
+from app.core import admission, export, response_codec
+from app.core.bifactor import PsychometricScores, registry
 
-router = APIRouter()
+router = APIRouter(route_class=TracedRoute)
+
+BIFACTOR_OUTPUTS = ("g_factor", "s_agency", "confidence", "eib_prediction", "cwb_o_risk", "cwb_i_risk")
+SCORE_COLUMNS = ("narcissism_score", "machiavellianism_score", "psychopathy_score", "sadism_score")
 
 
 class ResultDetail(BaseModel):
@@ -39,42 +48,122 @@ class ResultDetail(BaseModel):
     cwb_o_risk: float
     cwb_i_risk: float
     
+    # Item answers {code: 1-5}
+    responses: Optional[Dict[str, int]] = None
+    
     model_config = ConfigDict(from_attributes=True)
 
 
 @router.get("/assessment/{assessment_id}", response_model=ResultDetail)
-async def get_result_by_assessment(assessment_id: UUID, db: Session = Depends(get_db)):
-    """Get result for a specific assessment"""
-    result = db.query(Result).filter(Result.assessment_id == assessment_id).first()
-    if not result:
+def get_result_by_assessment(assessment_id: UUID, request: Request, db: Session = Depends(get_db)):
+    """Get result for a specific assessment (only the calling company's)"""
+    assessment = db.get(Assessment, assessment_id)
+    if not assessment:
+        raise HTTPException(status_code=404, detail="Assessment not found")
+    # Results are written after the assessment is created: only scan partitions from then on
+    result = find_result(db, "assessment_id", assessment_id, start=assessment.created_at)
+    if not result or not _visible(request, result.company_id):
         raise HTTPException(status_code=404, detail="Result not found")
     
+    # Bifactor outputs are persisted in raw_data by the submit endpoint
+    raw = result.raw_data or {}
+    if any(raw.get(key) is None for key in BIFACTOR_OUTPUTS):
+        raw = {**_derive_bifactor(result, raw), **{k: v for k, v in raw.items() if v is not None}}
     return ResultDetail(
         id=result.id,
         assessment_id=result.assessment_id,
-        narcissism=result.narcissism,
-        machiavellianism=result.machiavellianism,
-        psychopathy=result.psychopathy,
-        sadism=result.sadism,
-        vigilance=result.vigilance,
-        psycap=result.psycap,
-        g_factor=result.g_factor,
-        s_agency=result.s_agency,
-        classification=result.classification,
-        confidence=result.confidence,
-        eib_prediction=result.eib_prediction,
-        cwb_o_risk=result.cwb_o_risk,
-        cwb_i_risk=result.cwb_i_risk
+        narcissism=result.narcissism_score,
+        machiavellianism=result.machiavellianism_score,
+        psychopathy=result.psychopathy_score,
+        sadism=result.sadism_score,
+        vigilance=raw.get("vigilance", 0.5),
+        psycap=raw.get("psycap", 0.5),
+        g_factor=raw["g_factor"],
+        s_agency=raw["s_agency"],
+        classification=result.risk_level,
+        confidence=raw["confidence"],
+        eib_prediction=raw["eib_prediction"],
+        cwb_o_risk=raw["cwb_o_risk"],
+        cwb_i_risk=raw["cwb_i_risk"],
+        responses=response_codec.decode(result.responses) if result.responses else raw.get("responses")
     )
 
 
+def _visible(request: Request, company_id) -> bool:
+    """Another tenant's rows look like missing ones; without admission control there is one tenant"""
+    tenant = getattr(request.state, "company_id", None)
+    return tenant is None or (company_id is not None and str(company_id) == tenant)
+
+
+def _derive_bifactor(result, raw: dict) -> dict:
+    """Rows written before submit stored the bifactor outputs: recompute them from the stored scores"""
+    scores = [getattr(result, column) for column in SCORE_COLUMNS]
+    if any(score is None for score in scores):
+        raise HTTPException(status_code=422, detail="Result has neither bifactor outputs nor Dark Tetrad scores")
+    with registry.lease() as model:
+        analysis = model.engine.analyze(PsychometricScores(
+            *scores, vigilance=raw.get("vigilance", 0.5), psycap=raw.get("psycap", 0.5)))
+    return {key: getattr(analysis, key) for key in BIFACTOR_OUTPUTS}
+
+
+@router.get("/export")
+def export_results(
+    request: Request,
+    format: str = Query("ndjson", pattern="^(csv|ndjson|parquet)$"),
+    after: Optional[str] = Query(None, description="'<timestamp>,<id>' of the last row received, to resume"),
+    include_responses: bool = Query(False, description="One column per item instead of none"),
+    range_header: Optional[str] = Header(None, alias="Range", description="rows=a-b (0-based, inclusive)")
+):
+    """
+    Stream every result of the calling company (chunked, constant memory), or
+    every result when admission control is off (single tenant).
+    Ordered by (timestamp, id); see core/export.py for resume and ranges.
+    """
+    company_id = getattr(request.state, "company_id", None)
+    if company_id is None and admission.ENABLED:
+        raise HTTPException(status_code=401, detail="Export requires an X-API-Key")
+    try:
+        cursor = export.parse_after(after)
+    except ValueError as e:
+        raise HTTPException(status_code=400, detail=str(e))
+    try:
+        rows = export.parse_range(range_header)
+    except ValueError as e:
+        raise HTTPException(status_code=416, detail=str(e))
+    try:
+        export.require(format)
+    except export.ExportUnavailable as e:
+        raise HTTPException(status_code=501, detail=str(e))
+
+    media_type, extension = export.FORMATS[format]
+    headers = {
+        "Accept-Ranges": "rows",
+        "Content-Disposition": f'attachment; filename="results.{extension}"',
+    }
+    if rows:
+        total = export.count_rows(company_id, cursor)
+        resolved = export.resolve_range(rows, total)
+        if resolved is None:
+            raise HTTPException(status_code=416, detail="Range starts past the last row",
+                                headers={"Content-Range": f"rows */{total}"})
+        rows = resolved
+        headers["Content-Range"] = f"rows {rows[0]}-{rows[1]}/{total}"
+    body = export.ENCODERS[format](export.iter_batches(company_id, cursor, rows), include_responses)
+    return StreamingResponse(body, status_code=206 if rows else 200, media_type=media_type, headers=headers)
+
+
 @router.get("/company/{company_id}/dashboard", response_model=dict)
-async def get_company_dashboard(company_id: UUID, db: Session = Depends(get_db)):
-    """Get aggregated results dashboard for a company"""
-    results = db.query(Result).join(Assessment).filter(
-        Assessment.company_id == company_id
-    ).all()
-    
+def get_company_dashboard(company_id: UUID, request: Request, db: Session = Depends(get_db)):
+    """Get aggregated results dashboard for a company (hot table and month partitions, not archives)"""
+    if not _visible(request, company_id):
+        raise HTTPException(status_code=404, detail="Company not found")
+    results = []
+    for name in partitions_for():
+        table = partition_table(name)
+        results += db.execute(
+            select(table.c.risk_level, table.c.raw_data).where(table.c.company_id == company_id)
+        ).all()
+
     if not results:
         return {
             "total_assessments": 0,
@@ -89,10 +178,11 @@ async def get_company_dashboard(company_id: UUID, db: Session = Depends(get_db))
     total_s = 0
     
     for r in results:
-        cls = r.classification
+        cls = r.risk_level
         breakdown[cls] = breakdown.get(cls, 0) + 1
-        total_g += r.g_factor
-        total_s += r.s_agency
+        raw = r.raw_data or {}
+        total_g += raw.get("g_factor") or 0
+        total_s += raw.get("s_agency") or 0
     
     return {
         "total_assessments": len(results),
@@ -1,5 +1,3 @@
-import numpy as np
-
 class AuctionStrategist:
     """
     Implementa estrategias de Equilibrio de Nash Bayesiano para subastas.
@@ -0,0 +1,308 @@
+"""
+Trazabilidad distribuida (W3C Trace Context)
+
+- TracingMiddleware continúa el `traceparent` del llamador (o inicia una traza),
+  abre el span de servidor y devuelve el id de traza en `x-trace-id`.
+- TracedRoute separa cada petición en spans de `validation` y `endpoint`.
+- span("engine.auction") envuelve el cálculo de los motores.
+- inject(headers) propaga el contexto en las llamadas HTTP salientes.
+
+Los spans se acumulan y se exportan por lotes desde un hilo en segundo plano a
+TRACE_COLLECTOR_URL (tools/trace_collector.py es el stand-in local). El
+muestreo se decide una sola vez en la raíz (TRACE_SAMPLE_RATIO); las
+peticiones no muestreadas solo pagan el parseo de una cabecera y un contextvar.
+"""
+
+import atexit
+import contextvars
+import functools
+import inspect
+import json
+import logging
+import os
+import random
+import threading
+import time
+import urllib.request
+from collections import deque
+from typing import Any, Callable, Dict, List, Optional
+
+from fastapi.routing import APIRoute
+
+logger = logging.getLogger(__name__)
+
+SERVICE_NAME = os.getenv("SERVICE_NAME", "strategy-engine")
+COLLECTOR_URL = os.getenv("TRACE_COLLECTOR_URL") or None
+SAMPLE_RATIO = float(os.getenv("TRACE_SAMPLE_RATIO", "0.1"))
+EXPORT_INTERVAL = float(os.getenv("TRACE_EXPORT_INTERVAL", "1.0"))
+MAX_BATCH = 512
+MAX_QUEUE = 20_000
+
+
+class Span:
+    __slots__ = ("trace_id", "span_id", "parent_id", "name", "start_ns", "end_ns", "attributes", "status", "_token")
+
+    def __init__(self, trace_id: str, parent_id: Optional[str], name: str):
+        self.trace_id = trace_id
+        self.span_id = "%016x" % random.getrandbits(64)
+        self.parent_id = parent_id
+        self.name = name
+        self.start_ns = time.time_ns()
+        self.end_ns = 0
+        self.attributes: Dict[str, Any] = {}
+        self.status = "ok"
+        self._token = None
+
+    def __enter__(self) -> "Span":
+        self._token = _current.set(TraceContext(self.trace_id, self.span_id, True))
+        return self
+
+    def __exit__(self, exc_type, exc, tb) -> bool:
+        if exc_type is not None:
+            self.status = f"error: {exc_type.__name__}"
+        _current.reset(self._token)
+        self.end()
+        return False
+
+    def set(self, key: str, value: Any) -> None:
+        self.attributes[key] = value
+
+    def end(self) -> None:
+        if not self.end_ns:
+            self.end_ns = time.time_ns()
+            _exporter.enqueue(self)
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            "service": SERVICE_NAME,
+            "trace_id": self.trace_id,
+            "span_id": self.span_id,
+            "parent_id": self.parent_id,
+            "name": self.name,
+            "start_ns": self.start_ns,
+            "duration_us": (self.end_ns - self.start_ns) // 1000,
+            "attributes": self.attributes,
+            "status": self.status,
+        }
+
+
+class _NoopSpan:
+    """Sustituto compartido para trabajo no muestreado: todo es no-op"""
+
+    def __enter__(self) -> "_NoopSpan":
+        return self
+
+    def __exit__(self, exc_type, exc, tb) -> bool:
+        return False
+
+    def set(self, key: str, value: Any) -> None:
+        pass
+
+    def end(self) -> None:
+        pass
+
+
+NOOP_SPAN = _NoopSpan()
+
+
+class TraceContext:
+    __slots__ = ("trace_id", "span_id", "sampled")
+
+    def __init__(self, trace_id: str, span_id: Optional[str], sampled: bool):
+        self.trace_id = trace_id
+        self.span_id = span_id
+        self.sampled = sampled
+
+
+_current: contextvars.ContextVar[Optional[TraceContext]] = contextvars.ContextVar("trace_context", default=None)
+
+
+# ----------------------------------------------------------------------
+# API de spans
+# ----------------------------------------------------------------------
+def start_span(name: str) -> Any:
+    """Inicia un hijo del span actual (el llamador debe hacer end())"""
+    ctx = _current.get()
+    if ctx is None or not ctx.sampled:
+        return NOOP_SPAN
+    return Span(ctx.trace_id, ctx.span_id, name)
+
+
+def span(name: str, **attributes: Any) -> Any:
+    """Span hijo alrededor de un bloque, p.ej. `with span("engine.auction"):`"""
+    ctx = _current.get()
+    if ctx is None or not ctx.sampled:
+        return NOOP_SPAN
+    s = Span(ctx.trace_id, ctx.span_id, name)
+    if attributes:
+        s.attributes.update(attributes)
+    return s
+
+
+def inject(headers: Optional[Dict[str, str]] = None) -> Dict[str, str]:
+    """Añade el `traceparent` actual a las cabeceras de una petición saliente"""
+    headers = dict(headers or {})
+    ctx = _current.get()
+    if ctx is not None and ctx.span_id is not None:
+        headers["traceparent"] = f"00-{ctx.trace_id}-{ctx.span_id}-{'01' if ctx.sampled else '00'}"
+    return headers
+
+
+_HEX = frozenset("0123456789abcdef")
+
+
+def _is_hex(value: str, length: int) -> bool:
+    return len(value) == length and _HEX.issuperset(value)
+
+
+def parse_traceparent(value: Optional[str]) -> Optional[TraceContext]:
+    """`version-trace_id-parent_id-flags` en hex minúscula; ids a cero o versión ff no valen"""
+    if not value:
+        return None
+    parts = value.strip().split("-")
+    if len(parts) < 4:
+        return None
+    version, trace_id, parent_id, flags = parts[:4]
+    if not (_is_hex(version, 2) and _is_hex(trace_id, 32) and _is_hex(parent_id, 16) and _is_hex(flags, 2)):
+        return None
+    if version == "ff" or (version == "00" and len(parts) != 4):
+        return None
+    if trace_id == "0" * 32 or parent_id == "0" * 16:
+        return None
+    return TraceContext(trace_id, parent_id, bool(int(flags, 16) & 0x01))
+
+
+# ----------------------------------------------------------------------
+# Middleware ASGI + clase de ruta
+# ----------------------------------------------------------------------
+class TracingMiddleware:
+    """Middleware ASGI puro (sin el sobrecoste de BaseHTTPMiddleware)"""
+
+    def __init__(self, app):
+        self.app = app
+
+    async def __call__(self, scope, receive, send):
+        if scope["type"] != "http":
+            await self.app(scope, receive, send)
+            return
+
+        parent = None
+        for key, value in scope["headers"]:
+            if key == b"traceparent":
+                parent = parse_traceparent(value.decode("latin-1"))
+                break
+        if parent is None:
+            parent = TraceContext("%032x" % random.getrandbits(128), None, random.random() < SAMPLE_RATIO)
+
+        server = Span(parent.trace_id, parent.span_id, f"{scope['method']} {scope['path']}") if parent.sampled else NOOP_SPAN
+        span_id = server.span_id if parent.sampled else parent.span_id
+        token = _current.set(TraceContext(parent.trace_id, span_id, parent.sampled))
+        trace_header = (b"x-trace-id", parent.trace_id.encode())
+
+        async def send_with_trace(message):
+            if message["type"] == "http.response.start":
+                message.setdefault("headers", [])
+                message["headers"] = list(message["headers"]) + [trace_header]
+                server.set("http.status_code", message["status"])
+            await send(message)
+
+        try:
+            await self.app(scope, receive, send_with_trace)
+        finally:
+            _current.reset(token)
+            server.end()
+
+
+_validation_span: contextvars.ContextVar[Any] = contextvars.ContextVar("validation_span", default=NOOP_SPAN)
+
+
+def _trace_endpoint(endpoint: Callable) -> Callable:
+    """Cierra el span `validation` y envuelve el endpoint en su propio span"""
+    if getattr(endpoint, "__traced__", False):
+        return endpoint  # include_router reconstruye rutas con endpoints ya envueltos
+    name = f"endpoint.{endpoint.__name__}"
+
+    if inspect.iscoroutinefunction(endpoint):
+        @functools.wraps(endpoint)
+        async def traced(*args, **kwargs):
+            _validation_span.get().end()
+            with span(name):
+                return await endpoint(*args, **kwargs)
+    else:
+        @functools.wraps(endpoint)
+        def traced(*args, **kwargs):
+            _validation_span.get().end()
+            with span(name):
+                return endpoint(*args, **kwargs)
+    traced.__traced__ = True
+    return traced
+
+
+class TracedRoute(APIRoute):
+    """APIRoute que mide por separado el parseo/validación y el tiempo del endpoint"""
+
+    def __init__(self, path: str, endpoint: Callable, **kwargs):
+        super().__init__(path, _trace_endpoint(endpoint), **kwargs)
+
+    def get_route_handler(self) -> Callable:
+        handler = super().get_route_handler()
+
+        async def traced_handler(request):
+            validation = start_span("validation")
+            token = _validation_span.set(validation)
+            try:
+                return await handler(request)
+            finally:
+                validation.end()  # no-op si el endpoint ya lo cerró
+                _validation_span.reset(token)
+
+        return traced_handler
+
+
+# ----------------------------------------------------------------------
+# Exportador por lotes
+# ----------------------------------------------------------------------
+class BatchExporter:
+    def __init__(self, url: Optional[str]):
+        self.url = url
+        self._queue: deque = deque(maxlen=MAX_QUEUE)  # bajo sobrecarga se descartan los más antiguos
+        self._thread: Optional[threading.Thread] = None
+        self._lock = threading.Lock()
+
+    def enqueue(self, s: Span) -> None:
+        if self.url is None:
+            return
+        self._queue.append(s)
+        if self._thread is None:
+            self._start()
+
+    def _start(self) -> None:
+        with self._lock:
+            if self._thread is None:
+                self._thread = threading.Thread(target=self._run, name="trace-exporter", daemon=True)
+                self._thread.start()
+                atexit.register(self.flush)  # el hilo es daemon: sin esto se pierde el último lote
+
+    def _drain(self) -> List[Dict[str, Any]]:
+        batch = []
+        while self._queue and len(batch) < MAX_BATCH:
+            batch.append(self._queue.popleft().to_dict())
+        return batch
+
+    def flush(self) -> None:
+        while self._queue:
+            batch = self._drain()
+            body = json.dumps({"spans": batch}).encode()
+            req = urllib.request.Request(self.url, data=body, headers={"Content-Type": "application/json"})
+            try:
+                urllib.request.urlopen(req, timeout=2.0).close()
+            except Exception as exc:
+                logger.debug("Exportación de trazas fallida (%d spans descartados): %s", len(batch), exc)
+
+    def _run(self) -> None:
+        while True:
+            time.sleep(EXPORT_INTERVAL)
+            self.flush()
+
+
+_exporter = BatchExporter(COLLECTOR_URL)
@@ -1,12 +1,15 @@
 from fastapi import FastAPI
 from pydantic import BaseModel, Field
 from app.core.nash_equilibrium import AuctionStrategist
+from app.core.tracing import TracedRoute, TracingMiddleware, span
 
 app = FastAPI(
     title="Dark Agency Strategy Engine",
     version="1.0.0",
     description="Motor de Teoría de Juegos y Decisiones Estratégicas (Nash/Bayes)"
 )
+app.add_middleware(TracingMiddleware)
+app.router.route_class = TracedRoute
 
 class AuctionRequest(BaseModel):
     valuation: float = Field(..., description="Cuánto valoras el proyecto/objeto", gt=0)
@@ -19,11 +22,12 @@ def calculate_bid(request: AuctionRequest):
     risk_map = {"neutral": 0.0, "averse": 0.5, "lover": -0.2}
     risk_val = risk_map.get(request.risk_profile, 0.0)
     
-    strategy = AuctionStrategist.optimal_bid_first_price(
-        request.valuation, 
-        request.competitors, 
-        risk_val
-    )
+    with span("engine.auction", competitors=request.competitors):
+        strategy = AuctionStrategist.optimal_bid_first_price(
+            request.valuation, 
+            request.competitors, 
+            risk_val
+        )
     
     return {
         "inputs": request.dict(),
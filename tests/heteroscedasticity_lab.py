@@ -6,11 +6,12 @@ from statsmodels.stats.diagnostic import het_white
 # --- LABORATORIO AVANZADO: HETEROCEDASTICIDAD Y WLS ---
 
 # 1. GENERACIÓN DE DATOS
-np.random.seed(42)
+# Generador Philox (basado en contador) en lugar del estado global de np.random
+rng = np.random.Generator(np.random.Philox(key=42))
 N = 200
-X = np.random.uniform(1, 10, N)
+X = rng.uniform(1, 10, N)
 # Heterocedasticidad fuerte: Varianza crece con X
-u = np.random.normal(0, X**2 * 0.5, N) 
+u = rng.normal(0, X**2 * 0.5, N) 
 Y = 10 + 2*X + u
 
 # 2. OLS (MCO) - EL MODELO INEFICIENTE
@@ -0,0 +1,80 @@
+import os
+import sys
+import threading
+
+import numpy as np
+import pandas as pd
+
+# --- LABORATORIO: PERFIL POR MUESTREO DE UNA CARGA 2SLS ---
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "geo-causal-engine"))
+os.environ["PROFILER_TOKEN"] = "lab-token"
+
+from app.core import profiler
+from app.core.econometrics import CausalInferenceEngine
+
+# 1. GENERACIÓN DE DATOS (IV con endogeneidad real)
+rng = np.random.Generator(np.random.Philox(key=42))
+N = 5000
+z1, z2, w = rng.normal(size=(3, N))
+u = rng.normal(size=N)
+x = 0.8 * z1 + 0.5 * z2 + 0.6 * u + rng.normal(size=N)  # x correlacionada con el error
+y = 1.0 + 2.0 * x + 0.5 * w + u
+df = pd.DataFrame({"y": y, "x": x, "w": w, "z1": z1, "z2": z2})
+
+# 2. CARGA SINTÉTICA: estimate_2sls en bucle en un hilo aparte (como un worker ocupado)
+stop = threading.Event()
+fits = [0]
+
+
+def carga():
+    while not stop.is_set():
+        out = CausalInferenceEngine.estimate_2sls(df, "y", ["w"], "x", ["z1", "z2"])
+        assert "error" not in out, out
+        fits[0] += 1
+
+
+worker = threading.Thread(target=carga, name="worker-2sls")
+worker.start()
+
+# 3. PERFIL (backend python: no requiere py-spy ni ptrace)
+try:
+    stacks, backend = profiler.profile(seconds=3.0, hz=200, mode="python")
+finally:
+    stop.set()
+    worker.join()
+
+total = sum(stacks.values())
+en_2sls = sum(n for stack, n in stacks.items() if "estimate_2sls" in stack)
+
+print(">>> PERFIL DE estimate_2sls <<<")
+print(f"Backend: {backend} | Ajustes completados: {fits[0]} | Muestras: {total}")
+print(f"Muestras dentro de estimate_2sls: {en_2sls} ({100 * en_2sls / max(total, 1):.1f}%)")
+for stack, n in stacks.most_common(5):
+    print(f"{n:>5}  ...{stack[-110:]}")
+
+assert fits[0] > 0 and total > 0
+assert any(stack.startswith("worker-2sls;") for stack in stacks), "Falta el hilo del worker"
+assert en_2sls > 0, "El perfil no capturó estimate_2sls"
+
+# 4. FORMATOS DE SALIDA
+lineas = profiler.collapsed(stacks).splitlines()
+assert all(line.rsplit(" ", 1)[1].isdigit() for line in lineas)
+svg = profiler.flamegraph_svg(stacks, title="estimate_2sls")
+assert svg.startswith("<svg") and "estimate_2sls" in svg
+with open("profile_2sls.svg", "w") as f:
+    f.write(svg)
+print("Flamegraph escrito en profile_2sls.svg")
+
+# 5. AUTENTICACIÓN Y EXCLUSIÓN MUTUA
+assert profiler.check_token("lab-token")
+assert not profiler.check_token("otro") and not profiler.check_token(None)
+profiler._busy.acquire()
+try:
+    profiler.profile(seconds=0.1)
+    raise AssertionError("Se permitieron dos perfiles simultáneos")
+except profiler.ProfilerBusy:
+    pass
+finally:
+    profiler._busy.release()
+print("OK")
@@ -5,13 +5,14 @@ from statsmodels.tsa.stattools import adfuller
 
 # --- LABORATORIO DE SERIES DE TIEMPO ---
 
-np.random.seed(42)
+# Generador Philox (basado en contador) en lugar del estado global de np.random
+rng = np.random.Generator(np.random.Philox(key=42))
 n = 100
 
 # 1. CAMINATA ALEATORIA (Random Walk) - NO ESTACIONARIA
 # El precio de hoy es el precio de ayer + un shock.
 # Esto simula una acción real (ej: Apple).
-precio = np.cumsum(np.random.normal(0, 1, n)) 
+precio = np.cumsum(rng.normal(0, 1, n)) 
 
 # 2. RUIDO BLANCO (White Noise) - ESTACIONARIO
 # Retornos diarios: sube y baja alrededor de 0.
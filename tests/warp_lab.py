@@ -0,0 +1,64 @@
+import json
+import os
+import sys
+import tempfile
+
+import numpy as np
+
+# --- LABORATORIO: CONSERVACIÓN DE MASA AL REPROYECTAR POBLACIÓN ---
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "geo-causal-engine"))
+
+from app.core.raster_io import GeoTransform, NpyRaster, Window
+from app.core.warp import WarpedRaster, transformer
+
+# 1. POBLACIÓN SINTÉTICA EN UTM 18S (100 m), CON HUECOS DE NODATA
+rng = np.random.Generator(np.random.Philox(key=7))
+H = W = 800
+poblacion = rng.poisson(rng.gamma(0.5, 40, size=(H, W))).astype(np.float32)
+poblacion[200:260, 300:420] = -1                   # hueco grande (nube, sin censo)
+poblacion[rng.random((H, W)) < 0.02] = -1          # huecos dispersos
+total_origen = poblacion[poblacion != -1].sum(dtype=np.float64)
+
+carpeta = tempfile.mkdtemp()
+ruta = os.path.join(carpeta, "poblacion.npy")
+np.save(ruta, poblacion)
+origen_t = GeoTransform(300000.0, 100.0, 8700000.0, -100.0)
+with open(os.path.join(carpeta, "poblacion.json"), "w") as f:
+    json.dump({"transform": origen_t.to_list(), "crs": "EPSG:32718", "nodata": -1}, f)
+origen = NpyRaster(ruta)
+
+# Extensión del origen en grados
+lon, lat = transformer("EPSG:32718", "EPSG:4326")(
+    np.array([300000.0, 380000.0, 300000.0, 380000.0]), np.array([8700000.0, 8700000.0, 8620000.0, 8620000.0]))
+
+print(">>> SUMA DE POBLACIÓN UTM -> EPSG:4326 <<<")
+print(f"Total origen: {total_origen:,.0f}")
+
+
+def reproyectar(res, max_pixels=None):
+    # Rejilla destino que desborda el origen: las huellas del borde cruzan su límite
+    x0 = np.floor(lon.min() / res) * res - res
+    y1 = np.ceil(lat.max() / res) * res + res
+    w = int(np.ceil((lon.max() - x0) / res)) + 2
+    h = int(np.ceil((y1 - lat.min()) / res)) + 2
+    warped = WarpedRaster(origen, GeoTransform(x0, res, y1, -res), (h, w), "EPSG:4326", "sum")
+    if max_pixels is not None:
+        warped.AREA_MAX_PIXELS = max_pixels
+    out = warped.read(Window(0, 0, h, w))
+    return out[out != -1].sum(dtype=np.float64)
+
+
+# 2. LECTURA COMPLETA: LA MASA SE CONSERVA
+for res in (0.0005, 0.002, 0.01, 0.05):
+    total = reproyectar(res)
+    error = 100 * (total / total_origen - 1)
+    print(f"{res:>7}°: {total:>14,.0f} ({error:+.3f}%)")
+    assert abs(error) < 0.2, f"La suma no se conserva a {res}°: {error:+.3f}%"
+
+# 3. LECTURA DIEZMADA (ventana mayor que AREA_MAX_PIXELS): estimación sin sesgo apreciable
+total = reproyectar(0.01, max_pixels=1 << 16)
+error = 100 * (total / total_origen - 1)
+print(f"Diezmada (0.01°): {total:,.0f} ({error:+.3f}%)")
+assert abs(error) < 2.0, f"Estimación diezmada demasiado lejos: {error:+.3f}%"
+print("OK")
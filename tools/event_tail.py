@@ -0,0 +1,96 @@
+"""
+Consumidor del outbox de resultados de maverick-backend (CDC hacia el data lake).
+
+Sigue GET /admin/events con long-poll, escribe cada evento como una línea
+NDJSON en <out>/result_events/dt=AAAA-MM-DD/<consumer>.ndjson (fuente de dbt)
+y solo después de fsync confirma el offset con PUT /admin/events/offsets.
+Si se corta, retoma desde el último offset confirmado: entrega al menos una
+vez, así que los modelos aguas abajo deben deduplicar por `seq`.
+
+    PROFILER_TOKEN=... python tools/event_tail.py --base http://localhost:8000 --consumer analytics
+"""
+
+import argparse
+import calendar
+import json
+import os
+import sys
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+
+
+def request(method: str, url: str, token: str, timeout: float) -> dict:
+    req = urllib.request.Request(url, method=method, headers={"X-Admin-Token": token})
+    with urllib.request.urlopen(req, timeout=timeout) as resp:
+        return json.loads(resp.read())
+
+
+def commit(base: str, consumer: str, seq: int, token: str) -> bool:
+    """PUT del offset; si falla se reintenta con el siguiente lote (el offset nunca retrocede)"""
+    try:
+        request("PUT", f"{base}/admin/events/offsets/{urllib.parse.quote(consumer, safe='')}?seq={seq}", token, 10)
+        return True
+    except (urllib.error.URLError, OSError) as exc:
+        print(f"Error confirmando offset {seq} ({exc}); se confirmará con el siguiente lote", file=sys.stderr)
+        return False
+
+
+def write_batch(out_dir: str, consumer: str, events: list) -> None:
+    by_day = {}
+    for event in events:
+        by_day.setdefault(event["created_at"][:10], []).append(event)
+    for day, day_events in by_day.items():
+        directory = os.path.join(out_dir, "result_events", f"dt={day}")
+        os.makedirs(directory, exist_ok=True)
+        with open(os.path.join(directory, f"{consumer}.ndjson"), "a") as f:
+            f.writelines(json.dumps(e, separators=(",", ":")) + "\n" for e in day_events)
+            f.flush()
+            os.fsync(f.fileno())
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--base", default="http://localhost:8000")
+    parser.add_argument("--consumer", default="analytics")
+    parser.add_argument("--out", default="lake")
+    parser.add_argument("--batch", type=int, default=1000)
+    parser.add_argument("--wait", type=float, default=20.0, help="segundos de long-poll")
+    parser.add_argument("--token", default=os.getenv("PROFILER_TOKEN"))
+    parser.add_argument("--once", action="store_true", help="vaciar lo pendiente y salir")
+    args = parser.parse_args()
+    if not args.token:
+        print("Falta --token o PROFILER_TOKEN", file=sys.stderr)
+        return 2
+
+    consumer_url = f"{args.base}/admin/events?consumer={urllib.parse.quote(args.consumer, safe='')}&limit={args.batch}"
+    after = None
+    pending = None  # último seq escrito cuyo offset no se pudo confirmar
+    while True:
+        url = consumer_url if after is None else f"{args.base}/admin/events?after={after}&limit={args.batch}"
+        try:
+            page = request("GET", f"{url}&wait={0 if args.once else args.wait}", args.token, args.wait + 10)
+        except (urllib.error.URLError, OSError) as exc:
+            print(f"Error leyendo eventos ({exc}); reintento en 2s", file=sys.stderr)
+            after = None  # retomar desde el offset confirmado
+            time.sleep(2)
+            continue
+
+        events = page["events"]
+        if events:
+            write_batch(args.out, args.consumer, events)
+            after = events[-1]["seq"]
+            pending = None if commit(args.base, args.consumer, after, args.token) else after
+            lag = time.time() - calendar.timegm(time.strptime(events[-1]["created_at"][:19], "%Y-%m-%dT%H:%M:%S"))
+            print(f"{args.consumer}: {len(events)} eventos hasta seq {after} (frescura {lag:.1f}s)")
+        elif pending is not None:
+            pending = None if commit(args.base, args.consumer, pending, args.token) else pending
+            if pending is not None:
+                time.sleep(2)
+        elif args.once:
+            return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
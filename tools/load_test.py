@@ -0,0 +1,503 @@
+"""
+Harness de carga extremo a extremo (modelo abierto) para la suite.
+
+Las llegadas siguen un proceso de Poisson por escenario: cada sesión arranca
+en su instante programado aunque las anteriores no hayan terminado, y la
+latencia de sesión se mide desde ese instante (sin omisión coordinada). Si el
+sistema no da abasto, lo que cae es el throughput logrado frente al ofrecido.
+
+Escenarios:
+  maverick  create -> submit (38 ítems) -> result        (maverick-backend)
+  bulk      create -> submit de un tenant en clase batch (maverick-backend)
+  founders  lote de N /assess concurrentes               (founder-risk-ai)
+  geo       /infer-political-structure                   (geo-causal-engine)
+  strategy  /optimize-bid                                (strategy-engine)
+  stubs     servicios del docker-compose sin directorio  (stand-ins)
+
+Cada servicio real se levanta con uvicorn en un proceso propio sobre SQLite
+desechable, con dos empresas sembradas (interactiva y bulk) para la admisión
+por tenant de Maverick. Los 429 de backpressure se cuentan aparte ("429"),
+no como errores.
+
+Los servicios que no existen en el árbol (stress-test-engine, quant-engine,
+causal-engine) o los que se pidan con --stub se sustituyen por stand-ins ASGI
+dentro de este proceso con latencia log-normal configurable; --target apunta
+un servicio a una URL externa. Los payloads salen de
+tools/synthetic_population.py.
+
+Uso:
+    python tools/load_test.py --duration 30
+    python tools/load_test.py --rate maverick=20 --rate geo=0 --duration 60
+    python tools/load_test.py --rate bulk=300 --rate geo=0 --rate strategy=0 --rate founders=0
+    python tools/load_test.py --stub geo-causal-engine --target strategy-engine=http://staging:8004
+    python tools/load_test.py --update-baseline
+"""
+
+import argparse
+import asyncio
+import json
+import math
+import os
+import random
+import subprocess
+import sqlite3
+import sys
+import tempfile
+import threading
+import time
+import urllib.error
+import urllib.request
+import uuid
+from collections import defaultdict
+from typing import Callable, Dict, List, Optional, Tuple
+
+import httpx
+
+from startup_benchmark import REPO_ROOT, SERVICES, STARTUP_TIMEOUT, free_port
+from synthetic_population import PopulationGenerator, make_rng
+
+BASELINE_PATH = os.path.join(REPO_ROOT, "tools", "load_baseline.json")
+
+# Servicios declarados en docker-compose.yml cuyo directorio no existe
+MISSING_SERVICES = ["stress-test-engine", "quant-engine", "causal-engine"]
+
+# escenario -> (servicio, llegadas/s por defecto)
+SCENARIOS = {
+    "maverick": ("maverick-backend", 5.0),
+    "bulk": ("maverick-backend", 0.0),
+    "founders": ("founder-risk-ai", 1.0),
+    "geo": ("geo-causal-engine", 10.0),
+    "strategy": ("strategy-engine", 20.0),
+    "stubs": (None, 0.0),
+}
+
+FOUNDER_BATCH = 10
+PAYLOAD_POOL = 2000
+MAX_IN_FLIGHT = 2000
+TENANTS = {"interactive": "load-test-interactive", "bulk": "load-test-bulk"}
+
+
+# ---------------------------------------------------------------------
+# Servicios: procesos reales y stand-ins
+# ---------------------------------------------------------------------
+def launch_service(name: str, env: dict) -> Tuple[subprocess.Popen, str]:
+    service_dir, health_path = SERVICES[name]
+    port = free_port()
+    base = f"http://127.0.0.1:{port}"
+    proc = subprocess.Popen(
+        [sys.executable, "-m", "uvicorn", "app.main:app", "--host", "127.0.0.1", "--port", str(port),
+         "--log-level", "warning"],
+        cwd=os.path.join(REPO_ROOT, service_dir), env=env,
+        stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+    )
+    deadline = time.perf_counter() + STARTUP_TIMEOUT
+    while time.perf_counter() < deadline:
+        if proc.poll() is not None:
+            raise RuntimeError(f"{name} terminó al arrancar:\n{proc.stderr.read().decode()}")
+        try:
+            with urllib.request.urlopen(base + health_path, timeout=1.0) as resp:
+                if resp.status == 200:
+                    return proc, base
+        except (urllib.error.URLError, ConnectionError, OSError):
+            time.sleep(0.05)
+    proc.terminate()
+    raise TimeoutError(f"{name} no respondió en {STARTUP_TIMEOUT}s")
+
+
+def seed_tenants(db_path: str, base: str) -> Dict[str, str]:
+    """
+    Empresas con api_key en el SQLite desechable (tras init_db del backend).
+    Espera a que la tabla de claves en memoria las recoja del changelog.
+    """
+    with sqlite3.connect(db_path) as conn:
+        for name, api_key in TENANTS.items():
+            conn.execute("INSERT OR IGNORE INTO companies (id, name, api_key, is_active) VALUES (?, ?, ?, 1)",
+                         (str(uuid.uuid4()), f"load-test {name}", api_key))
+    deadline = time.perf_counter() + STARTUP_TIMEOUT
+    while time.perf_counter() < deadline:
+        req = urllib.request.Request(base + "/api/v1/candidates/?limit=1",
+                                     headers={"X-API-Key": TENANTS["interactive"]})
+        try:
+            with urllib.request.urlopen(req, timeout=1.0):
+                return dict(TENANTS)
+        except urllib.error.HTTPError:
+            time.sleep(0.1)
+    raise TimeoutError("maverick-backend no cargó las claves sembradas")
+
+
+class StandIn:
+    """
+    Servicio sustituto en proceso: responde 200 a cualquier ruta tras una
+    latencia log-normal (mediana y sigma configurables). Devuelve un
+    assessment_id para que los escenarios con varios pasos puedan continuar.
+    """
+
+    def __init__(self, name: str, median_ms: float, sigma: float, seed: int):
+        self.name = name
+        self.median_ms = median_ms
+        self.sigma = sigma
+        self.rng = random.Random(seed)
+        self.server = None
+        self.base = None
+
+    async def __call__(self, scope, receive, send):
+        if scope["type"] == "lifespan":
+            while (await receive())["type"] != "lifespan.shutdown":
+                await send({"type": "lifespan.startup.complete"})
+            await send({"type": "lifespan.shutdown.complete"})
+            return
+        await asyncio.sleep(self.median_ms / 1000 * math.exp(self.rng.gauss(0, self.sigma)))
+        body = json.dumps({"stand_in": self.name, "status": "ok", "assessment_id": str(uuid.uuid4())}).encode()
+        await send({"type": "http.response.start", "status": 200,
+                    "headers": [(b"content-type", b"application/json")]})
+        await send({"type": "http.response.body", "body": body})
+
+    def start(self) -> str:
+        import uvicorn
+
+        port = free_port()
+        self.server = uvicorn.Server(uvicorn.Config(self, host="127.0.0.1", port=port, log_level="warning"))
+        threading.Thread(target=self.server.run, name=f"stand-in-{self.name}", daemon=True).start()
+        while not self.server.started:
+            time.sleep(0.01)
+        self.base = f"http://127.0.0.1:{port}"
+        return self.base
+
+    def stop(self) -> None:
+        if self.server is not None:
+            self.server.should_exit = True
+
+
+# ---------------------------------------------------------------------
+# Registro de latencias
+# ---------------------------------------------------------------------
+class StepFailed(Exception):
+    pass
+
+
+class StepRejected(StepFailed):
+    """429: backpressure deliberada del servicio, no un fallo"""
+
+
+class Recorder:
+    def __init__(self):
+        self.latencies: Dict[Tuple[str, str], List[float]] = defaultdict(list)
+        self.errors: Dict[Tuple[str, str], int] = defaultdict(int)
+        self.rejected: Dict[Tuple[str, str], int] = defaultdict(int)
+        self.last_error: Dict[Tuple[str, str], str] = {}
+        self.offered: Dict[str, int] = defaultdict(int)
+        self.dropped: Dict[str, int] = defaultdict(int)
+
+    def record(self, scenario: str, step: str, seconds: float, ok: bool, error: str = "") -> None:
+        if ok:
+            self.latencies[(scenario, step)].append(seconds * 1000)
+        else:
+            self.errors[(scenario, step)] += 1
+            self.last_error[(scenario, step)] = error
+
+    def report(self, duration: float) -> Dict[str, dict]:
+        rows = {}
+        for key in sorted(set(self.latencies) | set(self.errors) | set(self.rejected)):
+            samples = sorted(self.latencies[key])
+            n = len(samples)
+            pct = (lambda q: samples[min(n - 1, int(q * n))] if n else float("nan"))
+            scenario, step = key
+            rows[f"{scenario}/{step}"] = {
+                "n": n,
+                "errors": self.errors[key],
+                "rejected": self.rejected[key],
+                "p50_ms": round(pct(0.50), 2),
+                "p90_ms": round(pct(0.90), 2),
+                "p99_ms": round(pct(0.99), 2),
+                "max_ms": round(samples[-1], 2) if n else float("nan"),
+                "rps": round(n / duration, 2),
+            }
+            if step == "session":
+                rows[f"{scenario}/{step}"]["offered"] = self.offered[scenario]
+                rows[f"{scenario}/{step}"]["offered_rps"] = round(self.offered[scenario] / duration, 2)
+                rows[f"{scenario}/{step}"]["dropped"] = self.dropped[scenario]
+        return rows
+
+
+class Context:
+    def __init__(self, client: httpx.AsyncClient, urls: Dict[str, str], recorder: Recorder, seed: int,
+                 api_keys: Dict[str, str]):
+        self.client = client
+        self.urls = urls
+        self.api_keys = api_keys
+        self.recorder = recorder
+        self.rng = random.Random(seed)
+        population = PopulationGenerator(seed)
+        self.items = [item.code for item in population.items]
+        self.candidates = population.candidates(make_rng("candidates", 0, seed), PAYLOAD_POOL)
+        self.founders = population.founders(make_rng("founders", 0, seed), PAYLOAD_POOL)
+        self.regions = population.regions(make_rng("regions", 0, seed), PAYLOAD_POOL)
+
+    async def call(self, scenario: str, step: str, service: str, method: str, path: str, **kwargs) -> dict:
+        start = time.perf_counter()
+        try:
+            resp = await self.client.request(method, self.urls[service] + path, **kwargs)
+            if resp.status_code == 429:
+                self.recorder.rejected[(scenario, step)] += 1
+                raise StepRejected(f"{scenario}/{step}: 429")
+            ok = resp.status_code < 400
+            error = "" if ok else f"HTTP {resp.status_code}: {resp.text[:120]}"
+        except httpx.HTTPError as e:
+            ok = False
+            error = f"{type(e).__name__}: {e}"
+        self.recorder.record(scenario, step, time.perf_counter() - start, ok, error)
+        if not ok:
+            raise StepFailed(f"{scenario}/{step}")
+        return resp.json()
+
+    def row(self, columns: Dict, i: int) -> Dict[str, float]:
+        return {k: v[i].item() for k, v in columns.items()}
+
+
+# ---------------------------------------------------------------------
+# Escenarios
+# ---------------------------------------------------------------------
+async def maverick_create_submit(ctx: Context, scenario: str, headers: Dict[str, str]) -> str:
+    i = ctx.rng.randrange(PAYLOAD_POOL)
+    created = await ctx.call(scenario, "create", "maverick-backend", "POST", "/api/v1/assessments/create",
+                             headers=headers,
+                             json={"candidate_email": f"load-{uuid.uuid4().hex}@example.com",
+                                   "candidate_name": f"Candidato {i}"})
+    assessment_id = created["assessment_id"]
+    answers = [{"question_id": code, "answer_value": int(ctx.candidates[code.lower()][i])} for code in ctx.items]
+    await ctx.call(scenario, "submit", "maverick-backend", "POST",
+                   f"/api/v1/assessments/{assessment_id}/submit", headers=headers, json=answers)
+    return assessment_id
+
+
+async def scenario_maverick(ctx: Context) -> None:
+    headers = {"X-API-Key": ctx.api_keys["interactive"]}
+    assessment_id = await maverick_create_submit(ctx, "maverick", headers)
+    await ctx.call("maverick", "result", "maverick-backend", "GET", f"/api/v1/results/assessment/{assessment_id}",
+                   headers=headers)
+
+
+async def scenario_bulk(ctx: Context) -> None:
+    # Re-scoring masivo de un solo tenant: no debe mover el p99 de "maverick"
+    await maverick_create_submit(ctx, "bulk", {"X-API-Key": ctx.api_keys["bulk"], "X-Traffic-Class": "batch"})
+
+
+async def scenario_founders(ctx: Context) -> None:
+    async def assess(i: int):
+        f = ctx.row(ctx.founders, i)
+        payload = {
+            "founder_name": f"Fundador {i}", "startup_name": f"Startup {i}",
+            "narcissism": f["narcissism"], "machiavellianism": f["machiavellianism"],
+            "psychopathy": f["psychopathy"], "sadism": f["sadism"],
+            "vigilance": f["vigilance"], "psycap": f["psycap"], "pops": f["pops"],
+            "market_chaos": f["market_chaos"], "regulatory_burden": f["regulatory_burden"],
+            "corruption_index": f["corruption_index"],
+        }
+        await ctx.call("founders", "assess", "founder-risk-ai", "POST", "/api/v1/assess", json=payload)
+
+    results = await asyncio.gather(*(assess(ctx.rng.randrange(PAYLOAD_POOL)) for _ in range(FOUNDER_BATCH)),
+                                   return_exceptions=True)
+    if any(isinstance(r, Exception) for r in results):
+        raise StepFailed("founders/assess")
+
+
+async def scenario_geo(ctx: Context) -> None:
+    region = ctx.row(ctx.regions, ctx.rng.randrange(PAYLOAD_POOL))
+    await ctx.call("geo", "infer", "geo-causal-engine", "POST", "/infer-political-structure", json=region)
+
+
+async def scenario_strategy(ctx: Context) -> None:
+    payload = {
+        "valuation": round(ctx.rng.lognormvariate(11, 1), 2),
+        "competitors": ctx.rng.randint(2, 12),
+        "risk_profile": ctx.rng.choice(["neutral", "averse", "lover"]),
+    }
+    await ctx.call("strategy", "optimize_bid", "strategy-engine", "POST", "/optimize-bid", json=payload)
+
+
+async def scenario_stubs(ctx: Context) -> None:
+    service = ctx.rng.choice(MISSING_SERVICES)
+    await ctx.call("stubs", service, service, "POST", "/predict", json={})
+
+
+SCENARIO_FUNCS: Dict[str, Callable] = {
+    "maverick": scenario_maverick,
+    "bulk": scenario_bulk,
+    "founders": scenario_founders,
+    "geo": scenario_geo,
+    "strategy": scenario_strategy,
+    "stubs": scenario_stubs,
+}
+
+
+# ---------------------------------------------------------------------
+# Generador de llegadas (modelo abierto)
+# ---------------------------------------------------------------------
+async def open_model(name: str, rate: float, duration: float, ctx: Context, seed: int) -> None:
+    loop = asyncio.get_running_loop()
+    arrivals = random.Random(f"{seed}-{name}")
+    in_flight = set()
+    start = loop.time()
+    scheduled = start
+
+    async def session(at: float) -> None:
+        try:
+            await SCENARIO_FUNCS[name](ctx)
+            ctx.recorder.record(name, "session", loop.time() - at, True)
+        except StepRejected:
+            ctx.recorder.rejected[(name, "session")] += 1
+        except (StepFailed, KeyError, ValueError) as e:
+            ctx.recorder.record(name, "session", loop.time() - at, False, str(e))
+
+    while True:
+        scheduled += arrivals.expovariate(rate)
+        if scheduled - start > duration:
+            break
+        delay = scheduled - loop.time()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        ctx.recorder.offered[name] += 1
+        if len(in_flight) >= MAX_IN_FLIGHT:
+            ctx.recorder.dropped[name] += 1
+            continue
+        task = asyncio.create_task(session(scheduled))
+        in_flight.add(task)
+        task.add_done_callback(in_flight.discard)
+
+    if in_flight:
+        await asyncio.wait(in_flight)
+
+
+async def drive(rates: Dict[str, float], duration: float, urls: Dict[str, str], seed: int,
+                api_keys: Dict[str, str]) -> Recorder:
+    recorder = Recorder()
+    limits = httpx.Limits(max_connections=512, max_keepalive_connections=512)
+    async with httpx.AsyncClient(limits=limits, timeout=30.0) as client:
+        ctx = Context(client, urls, recorder, seed, api_keys)
+        await asyncio.gather(*(open_model(name, rate, duration, ctx, seed)
+                               for name, rate in rates.items() if rate > 0))
+    return recorder
+
+
+# ---------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------
+def parse_pairs(values: Optional[List[str]], cast=str) -> Dict[str, object]:
+    pairs = {}
+    for value in values or []:
+        key, _, raw = value.partition("=")
+        pairs[key] = cast(raw)
+    return pairs
+
+
+def check_regressions(rows: Dict[str, dict], baseline: Dict[str, dict], tolerance: float) -> List[str]:
+    regressions = []
+    for key, row in rows.items():
+        if row["n"] + row["errors"] and row["errors"] / (row["n"] + row["errors"]) > 0.01:
+            regressions.append(f"{key}: {row['errors']} errores")
+        base = baseline.get(key)
+        if base and row["p99_ms"] > base["p99_ms"] * (1 + tolerance):
+            regressions.append(f"{key}: p99 {row['p99_ms']} ms (base {base['p99_ms']})")
+        # Las sesiones rechazadas con 429 cuentan como atendidas: la backpressure es el comportamiento esperado
+        if "offered" in row and row["n"] + row["rejected"] < row["offered"] * (1 - tolerance):
+            regressions.append(f"{key}: {row['rps']} sesiones/s de {row['offered_rps']} ofrecidas")
+    return regressions
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description="Pruebas de carga de modelo abierto para la suite")
+    parser.add_argument("--duration", type=float, default=30.0, help="Segundos de llegadas")
+    parser.add_argument("--rate", action="append", metavar="ESCENARIO=RPS",
+                        help=f"Llegadas/s por escenario ({', '.join(SCENARIOS)})")
+    parser.add_argument("--target", action="append", metavar="SERVICIO=URL", help="Usar un servicio ya desplegado")
+    parser.add_argument("--stub", action="append", default=[], metavar="SERVICIO",
+                        help="Sustituir un servicio real por un stand-in en proceso")
+    parser.add_argument("--stub-median-ms", type=float, default=5.0)
+    parser.add_argument("--stub-sigma", type=float, default=0.5)
+    parser.add_argument("--api-key", action="append", metavar="TENANT=KEY",
+                        help="Claves para un maverick-backend externo (interactive, bulk)")
+    parser.add_argument("--seed", type=int, default=42)
+    parser.add_argument("--tolerance", type=float, default=0.25, help="Regresión relativa permitida")
+    parser.add_argument("--json", help="Guardar el informe en este fichero")
+    parser.add_argument("--update-baseline", action="store_true")
+    args = parser.parse_args(argv)
+
+    rates = {name: default for name, (_, default) in SCENARIOS.items()}
+    rates.update(parse_pairs(args.rate, float))
+    targets = parse_pairs(args.target)
+    needed = {SCENARIOS[name][0] for name, rate in rates.items() if rate > 0} - {None}
+    if rates.get("stubs", 0) > 0:
+        needed |= set(MISSING_SERVICES)
+
+    procs: List[subprocess.Popen] = []
+    stand_ins: List[StandIn] = []
+    urls: Dict[str, str] = {}
+    api_keys = parse_pairs(args.api_key)
+    with tempfile.TemporaryDirectory() as scratch:
+        env = dict(os.environ, DATABASE_URL=f"sqlite:///{scratch}/load.db",
+                   MODEL_REGISTRY_DIR=os.path.join(scratch, "model_registry"),
+                   TRACE_SAMPLE_RATIO=os.getenv("TRACE_SAMPLE_RATIO", "0"))
+        try:
+            for k, service in enumerate(sorted(needed)):
+                if service in targets:
+                    urls[service] = targets[service].rstrip("/")
+                elif service in MISSING_SERVICES or service in args.stub:
+                    stand_in = StandIn(service, args.stub_median_ms, args.stub_sigma, args.seed + k)
+                    urls[service] = stand_in.start()
+                    stand_ins.append(stand_in)
+                else:
+                    proc, urls[service] = launch_service(service, env)
+                    procs.append(proc)
+                    if service == "maverick-backend":
+                        api_keys = {**seed_tenants(os.path.join(scratch, "load.db"), urls[service]), **api_keys}
+            print("Servicios: " + ", ".join(f"{s}={'stand-in' if s in {x.name for x in stand_ins} else u}"
+                                            for s, u in sorted(urls.items())))
+
+            start = time.perf_counter()
+            recorder = asyncio.run(drive(rates, args.duration, urls, args.seed, api_keys))
+            elapsed = max(time.perf_counter() - start, args.duration)
+        finally:
+            for proc in procs:
+                proc.terminate()
+                try:
+                    proc.wait(timeout=10)
+                except subprocess.TimeoutExpired:
+                    proc.kill()  # uvicorn sigue drenando peticiones encoladas
+                    proc.wait()
+            for stand_in in stand_ins:
+                stand_in.stop()
+
+    rows = recorder.report(elapsed)
+    print(f"\n{'escenario/paso':<28} {'n':>7} {'err':>5} {'429':>6} {'p50':>8} {'p90':>8} {'p99':>8} {'max':>8} {'rps':>8}")
+    for key, r in rows.items():
+        print(f"{key:<28} {r['n']:>7} {r['errors']:>5} {r['rejected']:>6} {r['p50_ms']:>8.1f} {r['p90_ms']:>8.1f} "
+              f"{r['p99_ms']:>8.1f} {r['max_ms']:>8.1f} {r['rps']:>8.2f}"
+              + (f"  (ofrecido {r['offered_rps']}/s)" if "offered_rps" in r else ""))
+
+    for (scenario, step), error in sorted(recorder.last_error.items()):
+        print(f"  último error {scenario}/{step}: {error}")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(rows, f, indent=2)
+
+    if args.update_baseline:
+        with open(BASELINE_PATH, "w") as f:
+            json.dump({k: {"p99_ms": r["p99_ms"], "rps": r["rps"]} for k, r in rows.items()}, f,
+                      indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Línea base actualizada: {BASELINE_PATH}")
+        return 0
+
+    baseline = {}
+    if os.path.exists(BASELINE_PATH):
+        with open(BASELINE_PATH) as f:
+            baseline = json.load(f)
+    regressions = check_regressions(rows, baseline, args.tolerance)
+    for line in regressions:
+        print(f"REGRESIÓN  {line}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
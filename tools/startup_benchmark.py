@@ -0,0 +1,189 @@
+"""
+Benchmark de arranque en frío: tiempo hasta la primera respuesta por servicio.
+
+Para cada servicio lanza uvicorn en un proceso nuevo (como un contenedor que
+escala desde cero) y mide dos cosas:
+
+- ready: desde el spawn hasta el primer 200 del endpoint de salud.
+- first_request: latencia de la primera petición real (inferencia, scoring...)
+  justo después. /health no carga los motores perezosos, así que es aquí donde
+  aparece el coste de imports y modelos que el arranque ha diferido.
+
+Los milisegundos absolutos dependen de la máquina: la línea base se guarda
+relativa al `ready` de founder-risk-api (REFERENCE, el servicio más ligero:
+solo intérprete, uvicorn y FastAPI), medido en la misma ejecución e
+intercalado con los demás para que la carga de la máquina afecte a todos por
+igual. Sale con código 1 si alguna métrica relativa empeora más que la
+tolerancia y, a la vez, más que --min-delta-ms una vez pasada a ms con la
+referencia de esta ejecución (si no, el ruido de una petición de 5 ms sería
+"regresión").
+
+Uso:
+    python tools/startup_benchmark.py                      # medir y comparar
+    python tools/startup_benchmark.py --update-baseline    # fijar nueva línea base
+    python tools/startup_benchmark.py --only geo-causal-engine --runs 10
+"""
+
+import argparse
+import json
+import os
+import socket
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.error
+import urllib.request
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINE_PATH = os.path.join(REPO_ROOT, "tools", "startup_baseline.json")
+
+# Primera petición real por servicio: pasos (método, ruta, cuerpo). La ruta se
+# formatea con el JSON de la respuesta anterior; se cronometra el último paso.
+FIRST_REQUESTS = {
+    "maverick-backend": [
+        ("POST", "/api/v1/assessments/create", {"candidate_email": "bench@example.com", "candidate_name": "Bench"}),
+        ("POST", "/api/v1/assessments/{assessment_id}/submit",
+         [{"question_id": q, "answer_value": 4} for q in ("NARC_01", "MACH_01", "PSYC_01", "SAD_01")]),
+    ],
+    "founder-risk-ai": [("GET", "/api/v1/demo/maria-garcia", None)],
+    "founder-risk-api": [("GET", "/", None)],
+    "strategy-engine": [("POST", "/optimize-bid", {"valuation": 1000.0, "competitors": 3})],
+    "geo-causal-engine": [
+        ("POST", "/infer-political-structure",
+         {"ndvi_mean": 0.3, "lst_mean_celsius": 30.0, "extraversion_agg": 0.6, "conscientiousness_agg": 0.4}),
+    ],
+}
+
+# servicio -> (directorio con el paquete app/, ruta de salud)
+SERVICES = {
+    "maverick-backend": ("maverick-hunter/backend", "/health"),
+    "founder-risk-ai": ("founder-risk-ai/backend", "/health"),
+    "founder-risk-api": ("founder-risk-api/backend", "/"),
+    "strategy-engine": ("strategy-engine", "/health"),
+    "geo-causal-engine": ("geo-causal-engine", "/health"),
+}
+
+METRICS = ("ready", "first_request")
+REFERENCE = ("founder-risk-api", "ready")
+
+STARTUP_TIMEOUT = 30.0
+
+
+def free_port() -> int:
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def first_request(base: str, steps: list) -> float:
+    """Ejecuta los pasos en orden y devuelve la latencia del último"""
+    prev = {}
+    for method, path, body in steps:
+        data = None if body is None else json.dumps(body).encode()
+        req = urllib.request.Request(base + path.format(**prev), data=data, method=method,
+                                     headers={"Content-Type": "application/json"})
+        start = time.perf_counter()
+        with urllib.request.urlopen(req, timeout=STARTUP_TIMEOUT) as resp:
+            prev = json.loads(resp.read() or b"{}")
+        elapsed = time.perf_counter() - start
+    return elapsed
+
+
+def measure(name: str, env: dict) -> dict:
+    """Segundos hasta el primer 200 de salud y latencia de la primera petición real"""
+    service_dir, health_path = SERVICES[name]
+    port = free_port()
+    base = f"http://127.0.0.1:{port}"
+    url = base + health_path
+    start = time.perf_counter()
+    proc = subprocess.Popen(
+        [sys.executable, "-m", "uvicorn", "app.main:app", "--host", "127.0.0.1", "--port", str(port),
+         "--log-level", "warning"],
+        cwd=os.path.join(REPO_ROOT, service_dir), env=env,
+        stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+    )
+    try:
+        ready = None
+        while ready is None:
+            if time.perf_counter() - start > STARTUP_TIMEOUT:
+                raise TimeoutError(f"{service_dir} no respondió en {STARTUP_TIMEOUT}s")
+            if proc.poll() is not None:
+                raise RuntimeError(f"{service_dir} terminó al arrancar:\n{proc.stderr.read().decode()}")
+            try:
+                with urllib.request.urlopen(url, timeout=1.0) as resp:
+                    if resp.status == 200:
+                        ready = time.perf_counter() - start
+            except (urllib.error.URLError, ConnectionError, socket.timeout):
+                time.sleep(0.005)
+        # Fuera del sondeo: un error de la petición real debe abortar, no reintentarse
+        return {"ready": ready, "first_request": first_request(base, FIRST_REQUESTS[name])}
+    finally:
+        proc.terminate()
+        proc.wait(timeout=10)
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description="Tiempo hasta la primera respuesta por servicio")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--tolerance", type=float, default=0.25, help="Regresión relativa permitida")
+    parser.add_argument("--min-delta-ms", type=float, default=10.0,
+                        help="Diferencia absoluta mínima para contar como regresión (ruido en métricas de pocos ms)")
+    parser.add_argument("--only", action="append", choices=sorted(SERVICES))
+    parser.add_argument("--update-baseline", action="store_true")
+    args = parser.parse_args(argv)
+
+    baseline = {}
+    if os.path.exists(BASELINE_PATH):
+        with open(BASELINE_PATH) as f:
+            baseline = json.load(f)
+
+    with tempfile.TemporaryDirectory() as scratch:
+        # SQLite desechable: el benchmark nunca toca maverick.db. Sin admisión: mide
+        # el motor, no el alta de tenants (X-API-Key).
+        env = dict(os.environ, DATABASE_URL=f"sqlite:///{scratch}/bench.db", ADMISSION_CONTROL="0")
+
+        # La referencia se mide siempre (también con --only), una vez por ronda
+        names = list(dict.fromkeys([REFERENCE[0]] + (args.only or list(SERVICES))))
+        samples = {name: [] for name in names}
+        for _ in range(args.runs):
+            for name in names:
+                samples[name].append(measure(name, env))
+        medians = {name: {m: statistics.median(s[m] for s in runs) * 1000 for m in METRICS}
+                   for name, runs in samples.items()}
+
+    reference_ms = medians[REFERENCE[0]][REFERENCE[1]]
+    results = {name: {m: round(ms / reference_ms, 4) for m, ms in measured.items()}
+               for name, measured in medians.items() if name in (args.only or SERVICES)}
+
+    regressions = []
+    print(f"referencia {'.'.join(REFERENCE)}: {reference_ms:.1f} ms")
+    print(f"{'servicio':<20} {'métrica':<14} {'mediana ms':>10} {'relativa':>9} {'base':>9} {'base ms':>9}")
+    for name, relative in results.items():
+        for metric in METRICS:
+            ms, rel = medians[name][metric], relative[metric]
+            base = baseline.get(name, {}).get(metric)
+            base_ms = base * reference_ms if base is not None else None
+            flag = ""
+            if (name, metric) == REFERENCE:
+                flag = "  (referencia)"
+            elif base is not None and rel > base * (1 + args.tolerance) and ms > base_ms + args.min_delta_ms:
+                flag = "  << REGRESIÓN"
+                regressions.append(f"{name}.{metric}")
+            print(f"{name:<20} {metric:<14} {ms:>10.1f} {rel:>9.4f} {base if base is not None else '-':>9} "
+                  f"{f'{base_ms:.1f}' if base_ms is not None else '-':>9}{flag}")
+
+    if args.update_baseline:
+        baseline.update(results)
+        with open(BASELINE_PATH, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Línea base actualizada: {BASELINE_PATH}")
+        return 0
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,297 @@
+"""
+Generador sintético de poblaciones para pruebas de carga y capacidad.
+
+Produce poblaciones correlacionadas (factor de Cholesky) coherentes con los
+motores de la suite:
+  - candidates: Dark Tetrad + VEE + PsyCap + POPS y respuestas Likert 1-5 a
+    ALL_ITEMS (respetando reverse_scored del banco de ítems de Maverick Hunter)
+  - founders:   perfil psicométrico + contexto de mercado (founder-risk-ai)
+  - regions:    NDVI / LST y agregados Big Five (geo-causal-engine)
+
+Escribe directamente en formato COPY binario de PostgreSQL (cada bloque se
+serializa con copias vectorizadas de NumPy, sin bucles por fila) o en
+Parquet (si pyarrow está instalado).
+
+Uso:
+    python tools/synthetic_population.py candidates --rows 5000000 --format pgcopy --out /tmp/candidates.pgcopy
+    psql -c "\\copy synthetic_candidates FROM '/tmp/candidates.pgcopy' WITH (FORMAT binary)"
+"""
+
+import argparse
+import importlib.util
+import os
+import struct
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+from typing import Dict, Iterator
+
+import numpy as np
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+ASSESSMENT_MODULE = os.path.join(REPO_ROOT, "maverick-hunter", "backend", "app", "core", "assessment.py")
+
+CHUNK_ROWS = 250_000
+
+# Constructos latentes (orden de la matriz de correlación)
+TRAITS = ["narcissism", "machiavellianism", "psychopathy", "sadism", "vigilance", "psycap", "pops"]
+
+# Correlaciones plausibles: núcleo antagonista (psicopatía-sadismo) fuerte,
+# VEE ligada a maquiavelismo y PsyCap a narcisismo
+TRAIT_CORRELATION = np.array([
+    # narc  mach  psyc  sad   vee   psycap pops
+    [1.00, 0.40, 0.30, 0.20, 0.20, 0.35, 0.15],
+    [0.40, 1.00, 0.45, 0.40, 0.35, 0.10, 0.30],
+    [0.30, 0.45, 1.00, 0.60, 0.10, 0.00, 0.10],
+    [0.20, 0.40, 0.60, 1.00, 0.05, -0.05, 0.05],
+    [0.20, 0.35, 0.10, 0.05, 1.00, 0.30, 0.35],
+    [0.35, 0.10, 0.00, -0.05, 0.30, 1.00, 0.20],
+    [0.15, 0.30, 0.10, 0.05, 0.35, 0.20, 1.00],
+])
+
+# Índices de caos por mercado (mismos valores que GET /api/v1/markets)
+MARKETS = {
+    "latam": 0.70,
+    "africa": 0.80,
+    "sea": 0.65,
+    "mena": 0.60,
+    "india": 0.55,
+    "developed": 0.35,
+}
+
+# Carga de cada ítem sobre su constructo y ruido de respuesta
+ITEM_LOADING = 0.75
+LIKERT_CUTS = np.array([-1.2, -0.4, 0.4, 1.2])
+
+
+def load_item_bank():
+    """Carga ALL_ITEMS de Maverick Hunter sin importar el paquete `app` del servicio."""
+    spec = importlib.util.spec_from_file_location("maverick_assessment", ASSESSMENT_MODULE)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module.ALL_ITEMS
+
+
+def make_rng(kind: str, chunk: int, seed: int) -> np.random.Generator:
+    """Flujo Philox por (tabla, bloque): cada bloque es reproducible por separado."""
+    key = np.array([seed, sum(ord(c) << (8 * i) for i, c in enumerate(kind[:8]))], dtype=np.uint64)
+    return np.random.Generator(np.random.Philox(key=key, counter=[0, 0, 0, chunk]))
+
+
+def to_unit(z: np.ndarray) -> np.ndarray:
+    """Aproximación logística de Φ(z): lleva el latente normal a la escala 0-1."""
+    return 1.0 / (1.0 + np.exp(-1.702 * z))
+
+
+class PopulationGenerator:
+    def __init__(self, seed: int = 42):
+        self.seed = seed
+        self.cholesky = np.linalg.cholesky(TRAIT_CORRELATION)
+        self.items = load_item_bank()
+        self.item_trait = np.array([TRAITS.index(i.construct.value) for i in self.items])
+        # ALL_ITEMS viene agrupado por constructo: un tramo contiguo de columnas por rasgo
+        self.item_spans = [
+            (k, int(np.argmax(self.item_trait == k)), int((self.item_trait == k).sum()))
+            for k in np.unique(self.item_trait)
+        ]
+        self.item_reverse = np.array([i.reverse_scored for i in self.items])
+
+    def latent_traits(self, rng: np.random.Generator, n: int) -> np.ndarray:
+        return rng.standard_normal((n, len(TRAITS))) @ self.cholesky.T
+
+    def candidates(self, rng: np.random.Generator, n: int) -> Dict[str, np.ndarray]:
+        z = self.latent_traits(rng, n)
+        columns = {name: to_unit(z[:, k]) for k, name in enumerate(TRAITS)}
+
+        # Respuesta Likert: latente del constructo + ruido, cortado en 5 categorías
+        item_latent = rng.standard_normal((n, len(self.items)), dtype=np.float32)
+        item_latent *= np.float32(np.sqrt(1.0 - ITEM_LOADING ** 2))
+        z_items = (z * ITEM_LOADING).astype(np.float32)
+        for k, first, count in self.item_spans:
+            item_latent[:, first:first + count] += z_items[:, k:k + 1]
+        likert = np.ones(item_latent.shape, dtype=np.int16)
+        for cut in LIKERT_CUTS:
+            likert += item_latent > cut
+        likert[:, self.item_reverse] = 6 - likert[:, self.item_reverse]
+        for j, item in enumerate(self.items):
+            columns[item.code.lower()] = likert[:, j]
+        return columns
+
+    def founders(self, rng: np.random.Generator, n: int) -> Dict[str, np.ndarray]:
+        z = self.latent_traits(rng, n)
+        columns = {name: to_unit(z[:, k]) for k, name in enumerate(TRAITS)}
+
+        market_index = rng.integers(0, len(MARKETS), n).astype(np.int16)
+        chaos = np.array(list(MARKETS.values()))[market_index]
+        columns["market_id"] = market_index
+        columns["market_chaos"] = chaos
+        columns["regulatory_burden"] = np.clip(chaos * 0.8 + rng.normal(0, 0.05, n), 0, 1)
+        columns["corruption_index"] = np.clip(chaos * 0.7 + rng.normal(0, 0.05, n), 0, 1)
+        return columns
+
+    def regions(self, rng: np.random.Generator, n: int) -> Dict[str, np.ndarray]:
+        # Vegetación y temperatura fuertemente anticorrelacionadas
+        aridity = rng.standard_normal(n)
+        ndvi = np.clip(0.45 - 0.25 * aridity + rng.normal(0, 0.08, n), -1.0, 1.0)
+        lst = 24.0 + 7.0 * aridity + rng.normal(0, 2.0, n)
+        return {
+            "ndvi_mean": ndvi,
+            "lst_mean_celsius": lst,
+            "extraversion_agg": to_unit(0.3 * aridity + rng.standard_normal(n)),
+            "conscientiousness_agg": to_unit(-0.3 * aridity + rng.standard_normal(n)),
+        }
+
+    def chunks(self, kind: str, rows: int, workers: int = None) -> Iterator[Dict[str, np.ndarray]]:
+        """
+        Genera los bloques en paralelo (cada bloque tiene su propio flujo, así
+        que el resultado no depende del número de hilos) y los entrega en orden.
+        """
+        build = getattr(self, kind)
+        starts = list(range(0, rows, CHUNK_ROWS))
+        workers = workers or os.cpu_count() or 1
+
+        def run(chunk: int) -> Dict[str, np.ndarray]:
+            start = starts[chunk]
+            return build(make_rng(kind, chunk, self.seed), min(CHUNK_ROWS, rows - start))
+
+        with ThreadPoolExecutor(max_workers=workers) as executor:
+            pending = []
+            for chunk in range(len(starts)):
+                pending.append(executor.submit(run, chunk))
+                # Ventana acotada: memoria constante aunque se pidan miles de millones de filas
+                if len(pending) > workers:
+                    yield pending.pop(0).result()
+            for future in pending:
+                yield future.result()
+
+
+# ---------------------------------------------------------------------
+# Escritores
+# ---------------------------------------------------------------------
+PG_TYPES = {np.dtype(np.float64): (">f8", "double precision"), np.dtype(np.int16): (">i2", "smallint")}
+PGCOPY_HEADER = b"PGCOPY\n\xff\r\n\x00" + struct.pack(">ii", 0, 0)
+PGCOPY_TRAILER = struct.pack(">h", -1)
+
+
+def pg_ddl(table: str, columns: Dict[str, np.ndarray]) -> str:
+    cols = ",\n  ".join(f"{name} {PG_TYPES[arr.dtype][1]}" for name, arr in columns.items())
+    return f"CREATE TABLE IF NOT EXISTS {table} (\n  {cols}\n);"
+
+
+def pgcopy_block(columns: Dict[str, np.ndarray]) -> np.ndarray:
+    """
+    Serializa un bloque entero como tuplas COPY binarias.
+
+    Cada tupla es: int16 nº de campos + (int32 longitud, valor big-endian) por
+    campo. Las columnas consecutivas del mismo tipo se copian juntas como una
+    sola región (n, k, 4 + tamaño): sin bucles por fila.
+    """
+    names = list(columns)
+    n = len(columns[names[0]])
+
+    # Fila plantilla con nº de campos y longitudes; después solo se copian valores
+    template = [struct.pack(">h", len(names))]
+    for c in names:
+        size = columns[c].dtype.itemsize
+        template.append(struct.pack(">i", size) + bytes(size))
+    template = np.frombuffer(b"".join(template), dtype=np.uint8)
+    block = np.empty((n, template.size), dtype=np.uint8)
+    block[:] = template
+
+    offset = 2
+    start = 0
+    while start < len(names):
+        dtype = columns[names[start]].dtype
+        stop = start
+        while stop < len(names) and columns[names[stop]].dtype == dtype:
+            stop += 1
+        k, size = stop - start, dtype.itemsize
+
+        values = np.empty((n, k), dtype=PG_TYPES[dtype][0])
+        for j, c in enumerate(names[start:stop]):
+            values[:, j] = columns[c]
+        region = block[:, offset:offset + k * (4 + size)].reshape(n, k, 4 + size)
+        region[:, :, 4:] = values.view(np.uint8).reshape(n, k, size)
+
+        offset += k * (4 + size)
+        start = stop
+    return block
+
+
+def write_pgcopy(chunks: Iterator[Dict[str, np.ndarray]], out, ddl_table: str = None) -> int:
+    rows = 0
+    out.write(PGCOPY_HEADER)
+    for columns in chunks:
+        if ddl_table and rows == 0:
+            print(pg_ddl(ddl_table, columns), file=sys.stderr)
+        out.write(memoryview(pgcopy_block(columns)))
+        rows += len(next(iter(columns.values())))
+    out.write(PGCOPY_TRAILER)
+    return rows
+
+
+def write_parquet(chunks: Iterator[Dict[str, np.ndarray]], path: str) -> int:
+    import pyarrow as pa
+    import pyarrow.parquet as pq
+
+    rows = 0
+    writer = None
+    try:
+        for columns in chunks:
+            table = pa.table(columns)
+            if writer is None:
+                writer = pq.ParquetWriter(path, table.schema, compression="zstd")
+            writer.write_table(table)
+            rows += table.num_rows
+    finally:
+        if writer is not None:
+            writer.close()
+    return rows
+
+
+def copy_to_postgres(chunks: Iterator[Dict[str, np.ndarray]], dsn: str, table: str) -> int:
+    """COPY binario directo a Postgres: el DDL se crea con el primer bloque."""
+    import io
+    import psycopg2
+
+    rows = 0
+    with psycopg2.connect(dsn) as conn, conn.cursor() as cur:
+        for columns in chunks:
+            if rows == 0:
+                cur.execute(pg_ddl(table, columns))
+            payload = PGCOPY_HEADER + pgcopy_block(columns).tobytes() + PGCOPY_TRAILER
+            cur.copy_expert(f"COPY {table} FROM STDIN WITH (FORMAT binary)", io.BytesIO(payload))
+            rows += len(next(iter(columns.values())))
+    return rows
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description="Poblaciones sintéticas para pruebas de carga")
+    parser.add_argument("kind", choices=["candidates", "founders", "regions"])
+    parser.add_argument("--rows", type=int, default=1_000_000)
+    parser.add_argument("--seed", type=int, default=42)
+    parser.add_argument("--format", choices=["pgcopy", "parquet", "postgres"], default="pgcopy")
+    parser.add_argument("--out", help="Fichero de salida (pgcopy/parquet)")
+    parser.add_argument("--dsn", default=os.getenv("DATABASE_URL"), help="DSN para --format postgres")
+    parser.add_argument("--table", help="Tabla destino (por defecto synthetic_<kind>)")
+    args = parser.parse_args(argv)
+
+    table = args.table or f"synthetic_{args.kind}"
+    chunks = PopulationGenerator(args.seed).chunks(args.kind, args.rows)
+
+    start = time.perf_counter()
+    if args.format == "postgres":
+        rows = copy_to_postgres(chunks, args.dsn, table)
+    elif args.format == "parquet":
+        rows = write_parquet(chunks, args.out or f"{table}.parquet")
+    else:
+        with open(args.out or f"{table}.pgcopy", "wb") as out:
+            rows = write_pgcopy(chunks, out, ddl_table=table)
+    elapsed = time.perf_counter() - start
+
+    print(f"{rows:,} filas en {elapsed:.2f}s ({rows / elapsed:,.0f} filas/s)", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,101 @@
+"""
+Colector de trazas local (stand-in de un colector OTLP) para desarrollo y
+pruebas de carga.
+
+    python tools/trace_collector.py --port 4318
+    TRACE_COLLECTOR_URL=http://localhost:4318/v1/spans TRACE_SAMPLE_RATIO=1 uvicorn app.main:app
+
+POST /v1/spans      lote {"spans": [...]} exportado por app/core/tracing.py
+GET  /traces/<id>   árbol de spans de una traza (todos los servicios)
+GET  /summary       p50/p95 por (servicio, span) para atribuir la latencia
+"""
+
+import argparse
+import json
+import statistics
+import threading
+from collections import OrderedDict, defaultdict
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+MAX_TRACES = 10_000
+
+
+class SpanStore:
+    def __init__(self):
+        self.traces: "OrderedDict[str, list]" = OrderedDict()
+        self.durations = defaultdict(list)
+        self.lock = threading.Lock()
+
+    def add(self, spans):
+        with self.lock:
+            for s in spans:
+                self.traces.setdefault(s["trace_id"], []).append(s)
+                self.traces.move_to_end(s["trace_id"])
+                samples = self.durations[(s["service"], s["name"])]
+                samples.append(s["duration_us"])
+                if len(samples) > 5000:
+                    del samples[:1000]
+            while len(self.traces) > MAX_TRACES:
+                self.traces.popitem(last=False)
+
+    def trace(self, trace_id):
+        with self.lock:
+            return sorted(self.traces.get(trace_id, []), key=lambda s: s["start_ns"])
+
+    def summary(self):
+        with self.lock:
+            rows = []
+            for (service, name), samples in self.durations.items():
+                ordered = sorted(samples)
+                rows.append({
+                    "service": service,
+                    "span": name,
+                    "count": len(ordered),
+                    "p50_us": statistics.median(ordered),
+                    "p95_us": ordered[int(0.95 * (len(ordered) - 1))],
+                })
+            return sorted(rows, key=lambda r: -r["p95_us"])
+
+
+STORE = SpanStore()
+
+
+class Handler(BaseHTTPRequestHandler):
+    def _json(self, status, payload):
+        body = json.dumps(payload, indent=2).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_POST(self):
+        if self.path != "/v1/spans":
+            return self._json(404, {"error": "not found"})
+        length = int(self.headers.get("Content-Length", 0))
+        STORE.add(json.loads(self.rfile.read(length)).get("spans", []))
+        self._json(202, {"accepted": True})
+
+    def do_GET(self):
+        if self.path.startswith("/traces/"):
+            return self._json(200, STORE.trace(self.path.rsplit("/", 1)[-1]))
+        if self.path == "/summary":
+            return self._json(200, STORE.summary())
+        self._json(404, {"error": "not found"})
+
+    def log_message(self, *args):
+        pass
+
+
+def serve(port: int) -> ThreadingHTTPServer:
+    server = ThreadingHTTPServer(("0.0.0.0", port), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Colector de trazas local")
+    parser.add_argument("--port", type=int, default=4318)
+    args = parser.parse_args()
+    print(f"Colector de trazas en http://0.0.0.0:{args.port}/v1/spans")
+    serve(args.port).serve_forever()